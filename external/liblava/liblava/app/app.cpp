@@ -121,9 +121,21 @@ bool app::create_block() {
     return true;
 }
 
+//-----------------------------------------------------------------------------
+string app::get_pipeline_cache_file() const {
+    auto const& properties = device->get_properties();
+
+    string uuid;
+    for (auto byte : properties.pipelineCacheUUID)
+        uuid += fmt::format("{:02x}", byte);
+
+    // a driver update invalidates the cache even when it keeps the uuid
+    return fmt::format("{}{}_{:08x}_{}", _cache_path_, uuid, properties.driverVersion, _pipeline_cache_file_);
+}
+
 //-----------------------------------------------------------------------------
 bool app::create_pipeline_cache() {
-    file_data const pipeline_cache_data(string(_cache_path_) + _pipeline_cache_file_);
+    file_data const pipeline_cache_data(get_pipeline_cache_file());
 
     VkPipelineCacheCreateInfo create_info = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
@@ -156,8 +168,8 @@ void app::destroy_pipeline_cache() {
         u_data pipeline_cache_data(size);
 
         if (check(vkGetPipelineCacheData(device->get(), pipeline_cache, &size, pipeline_cache_data.addr))) {
-            if (!fs.create_folder(_cache_path_)) {
-                file file(string(_cache_path_) + _pipeline_cache_file_, file_mode::write);
+            if (fs.create_folder(_cache_path_)) {
+                file file(get_pipeline_cache_file(), file_mode::write);
                 if (file.opened())
                     if (!file.write(pipeline_cache_data.addr, pipeline_cache_data.size))
                         logger()->warn("app pipeline cache not saved: {}", file.get_path());
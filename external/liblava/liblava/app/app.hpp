@@ -314,6 +314,12 @@ private:
      */
     bool create_block();
 
+    /**
+     * @brief Get the pipeline cache file of the device and driver
+     * @return string    Path in the preferences folder
+     */
+    string get_pipeline_cache_file() const;
+
     /**
      * @brief Create a pipeline cache
      * @return Create was successful or failed
@@ -7,6 +7,7 @@
 
 #include "liblava/frame/renderer.hpp"
 #include "liblava/core/misc.hpp"
+#include <algorithm>
 #include <array>
 
 namespace lava {
@@ -174,8 +175,41 @@ bool renderer::end_frame(VkCommandBuffers const& cmd_buffers) {
 
     LAVA_ASSERT(user_frame_wait_semaphores.size() == user_frame_wait_stages.size());
 
+    // timeline values are only chained when the user semaphores carry any,
+    // the entries of the binary frame semaphores are ignored
+    std::vector<ui64> wait_values;
+    std::vector<ui64> signal_values;
+    VkTimelineSemaphoreSubmitInfo timeline_info{
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+    };
+
+    bool const has_timeline_values = !user_frame_wait_values.empty()
+                                     || !user_frame_signal_values.empty();
+    if (has_timeline_values) {
+        LAVA_ASSERT(user_frame_wait_values.empty()
+                    || (user_frame_wait_values.size() == user_frame_wait_semaphores.size()));
+        LAVA_ASSERT(user_frame_signal_values.empty()
+                    || (user_frame_signal_values.size() == user_frame_signal_semaphores.size()));
+
+        wait_values.assign(wait_semaphores.size(), 0);
+        std::copy(user_frame_wait_values.begin(),
+                  user_frame_wait_values.end(),
+                  wait_values.end() - user_frame_wait_values.size());
+
+        signal_values.assign(signal_semaphores.size(), 0);
+        std::copy(user_frame_signal_values.begin(),
+                  user_frame_signal_values.end(),
+                  signal_values.end() - user_frame_signal_values.size());
+
+        timeline_info.waitSemaphoreValueCount = to_ui32(wait_values.size());
+        timeline_info.pWaitSemaphoreValues = wait_values.data();
+        timeline_info.signalSemaphoreValueCount = to_ui32(signal_values.size());
+        timeline_info.pSignalSemaphoreValues = signal_values.data();
+    }
+
     VkSubmitInfo const submit_info{
         .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = has_timeline_values ? &timeline_info : nullptr,
         .waitSemaphoreCount = to_ui32(wait_semaphores.size()),
         .pWaitSemaphores = wait_semaphores.data(),
         .pWaitDstStageMask = wait_stages.data(),
@@ -84,6 +84,12 @@ struct renderer : entity {
     /// The frame additionally signals these semaphores (Usefully for additional CommandBuffers)
     VkSemaphores user_frame_signal_semaphores;
 
+    /// Values of timeline semaphores in user_frame_wait_semaphores (ignored for binary semaphores)
+    std::vector<ui64> user_frame_wait_values;
+
+    /// Values of timeline semaphores in user_frame_signal_semaphores (ignored for binary semaphores)
+    std::vector<ui64> user_frame_signal_values;
+
     /// Destroy function
     using destroy_func = std::function<void()>;
 
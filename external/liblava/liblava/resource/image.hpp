@@ -324,6 +324,45 @@ struct image : entity {
         m_stage = dst_stage;
     }
 
+    /**
+     * @brief Get the layout of the last transition
+     * @return VkImageLayout    Image layout
+     */
+    VkImageLayout get_layout() const {
+        return m_info.initialLayout;
+    }
+
+    /**
+     * @brief Get the access mask of the last transition
+     * @return VkAccessFlags    Access mask
+     */
+    VkAccessFlags get_access_mask() const {
+        return m_accessMask;
+    }
+
+    /**
+     * @brief Get the pipeline stage of the last transition
+     * @return VkPipelineStageFlags    Pipeline stage
+     */
+    VkPipelineStageFlags get_stage() const {
+        return m_stage;
+    }
+
+    /**
+     * @brief Record a transition that was issued outside of transition_layout
+     *
+     * @param layout         The image layout after the transition
+     * @param access_mask    The access mask after the transition
+     * @param stage          The pipeline stage after the transition
+     */
+    void set_transition_state(VkImageLayout layout,
+                              VkAccessFlags access_mask,
+                              VkPipelineStageFlags stage) {
+        m_info.initialLayout = layout;
+        m_accessMask = access_mask;
+        m_stage = stage;
+    }
+
 private:
     /// Vulkan device
     device::ptr m_device = nullptr;
@@ -0,0 +1,92 @@
+#pragma once
+#ifndef ACTIVE_TILE_PASS_HPP
+#define ACTIVE_TILE_PASS_HPP
+
+#include "ComputePass.hpp"
+#include "ResourceManager.hpp"
+#include <liblava/lava.hpp>
+
+namespace FluidSimulation
+{
+
+// Keeps the tiles where the flow or the dye moves, grown by one tile, as interior and boundary lists in the layout
+// of the tile classification (active_tiles). Advection, divergence, velocity update and color update dispatch from
+// them and skip quiescent regions. While disabled the lists are a copy of the classification
+class ActiveTilePass : public ComputePass
+{
+  public:
+    using s_ptr = std::shared_ptr<ActiveTilePass>;
+
+    ActiveTilePass(lava::engine &app, lava::descriptor::pool::s_ptr pool);
+    ~ActiveTilePass() override;
+
+    void CreateDescriptorSets() override;
+    void UpdateDescriptorSets() override;
+    void CreatePipeline() override;
+
+    // Runs before every simulation step
+    void Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants) override;
+
+    // One workgroup per tile of the list, tile_class must be Interior or Boundary
+    void Dispatch(VkCommandBuffer cmd_buffer, TileClass tile_class) const;
+
+    // One workgroup per tile of both lists, for kernels that treat every tile alike
+    void DispatchCombined(VkCommandBuffer cmd_buffer) const;
+
+    void SetEnabled(bool enabled)
+    {
+        enabled_ = enabled;
+    }
+    [[nodiscard]] bool GetEnabled() const
+    {
+        return enabled_;
+    }
+
+    // Set whenever the tile classification was rebuilt, the next step activates every tile
+    void SetNeedsUpdate(bool value)
+    {
+        needs_update_ = value;
+    }
+    bool GetNeedsUpdate() const
+    {
+        return needs_update_;
+    }
+
+    // Execute records the same commands on every step until the lists are rebuilt from the classification, see
+    // Simulation::SetStepReplay
+    [[nodiscard]] bool IsSteady() const
+    {
+        return !needs_update_ && lists_copied_ != enabled_;
+    }
+
+    static s_ptr Make(lava::engine &app, lava::descriptor::pool::s_ptr pool)
+    {
+        return std::make_shared<ActiveTilePass>(app, pool);
+    }
+
+  private:
+    void CopyTileClassification(VkCommandBuffer cmd_buffer);
+    void TransitionImages(VkCommandBuffer cmd_buffer);
+
+    lava::descriptor::s_ptr descriptor_set_layout_;
+    VkDescriptorSet measure_descriptor_set_{}; // Visits the active lists of the last step
+    VkDescriptorSet compact_descriptor_set_{}; // Visits every classified tile and rebuilds the active lists
+
+    lava::texture::s_ptr velocity_field_;
+    lava::texture::s_ptr advected_velocity_field_;
+    lava::texture::s_ptr divergence_field_;
+    lava::texture::s_ptr color_field_;
+    lava::texture::s_ptr tile_motion_;
+    lava::texture::s_ptr tile_active_;
+    lava::buffer::s_ptr tile_classification_buffer_;
+    lava::buffer::s_ptr active_tile_buffer_;
+    lava::buffer::s_ptr step_time_buffer_;
+
+    bool enabled_ = false;
+    bool needs_update_ = true;
+    bool lists_copied_ = false; // The active lists hold the classification, the tile state is stale
+};
+
+} // namespace FluidSimulation
+
+#endif // ACTIVE_TILE_PASS_HPP
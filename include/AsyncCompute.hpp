@@ -0,0 +1,90 @@
+#pragma once
+#ifndef ASYNC_COMPUTE_HPP
+#define ASYNC_COMPUTE_HPP
+
+#include "BarrierBatch.hpp"
+#include "ResourceManager.hpp"
+#include "Simulation.hpp"
+#include <array>
+#include <liblava/lava.hpp>
+
+namespace FluidSimulation
+{
+
+// Submits the simulation to the compute queue instead of the frame's command buffer. Every step ends by copying the
+// dye and the obstacle mask into its display slot and the frame samples the slot of the previous step, so a step runs
+// alongside the blit and the UI of the frame showing its predecessor. Timeline semaphores order the two queues, a
+// device without a second compute queue submits both to its graphics queue
+class AsyncCompute
+{
+  public:
+    using s_ptr = std::shared_ptr<AsyncCompute>;
+
+    AsyncCompute(lava::engine &app, Simulation::s_ptr simulation);
+    AsyncCompute(const AsyncCompute &) = delete;
+    AsyncCompute &operator=(const AsyncCompute &) = delete;
+    AsyncCompute(AsyncCompute &&other) = delete;
+    AsyncCompute &operator=(AsyncCompute &&other) = delete;
+
+    ~AsyncCompute();
+
+    void Destroy();
+
+    // Called while the frame is recorded, cmd_buffer is the frame's graphics command buffer
+    void Process(VkCommandBuffer cmd_buffer, const FrameTimeInfo &frame_context);
+
+    // Slot the frame recorded last samples
+    [[nodiscard]] uint32_t GetDisplaySlot() const
+    {
+        return display_slot_;
+    }
+
+    [[nodiscard]] bool HasDedicatedQueue() const
+    {
+        return compute_queue_.family != graphics_queue_family_;
+    }
+
+    static s_ptr Make(lava::engine &app, Simulation::s_ptr simulation)
+    {
+        return std::make_shared<AsyncCompute>(app, simulation);
+    }
+
+  private:
+    void CreateCommandBuffers();
+    VkSemaphore CreateTimelineSemaphore();
+    void WaitForStep(uint64_t step);
+
+    void RecordDisplayCopy(VkCommandBuffer cmd_buffer, uint32_t slot);
+    void RecordDisplayAcquire(VkCommandBuffer cmd_buffer, uint32_t slot);
+
+    // Barrier moving a display slot between the copy and the fragment shader, across queue families when they differ
+    VkImageMemoryBarrier2 DisplayBarrier(const lava::texture::s_ptr &texture, VkImageLayout old_layout,
+                                         VkImageLayout new_layout) const;
+
+    lava::engine &app_;
+    Simulation::s_ptr simulation_;
+
+    lava::queue compute_queue_;
+    uint32_t graphics_queue_family_ = 0;
+
+    VkCommandPool command_pool_ = VK_NULL_HANDLE;
+    std::array<VkCommandBuffer, DISPLAY_SLOT_COUNT> command_buffers_{};
+
+    VkSemaphore compute_timeline_ = VK_NULL_HANDLE; // Reaches n once step n finished
+    VkSemaphore render_timeline_ = VK_NULL_HANDLE;  // Reaches n once the frame recorded alongside step n finished
+
+    uint64_t step_count_ = 0;
+    uint64_t acquired_step_ = 0; // Last step whose display slot the graphics queue took ownership of
+    uint32_t display_slot_ = 0;
+
+    lava::texture::s_ptr color_field_;
+    lava::texture::s_ptr obstacle_mask_;
+    std::array<lava::texture::s_ptr, DISPLAY_SLOT_COUNT> display_color_;
+    std::array<lava::texture::s_ptr, DISPLAY_SLOT_COUNT> display_obstacle_;
+
+    BarrierBatch source_barriers_;
+};
+
+} // namespace FluidSimulation
+
+#endif // ASYNC_COMPUTE_HPP
@@ -0,0 +1,36 @@
+#pragma once
+#ifndef BARRIER_BATCH_HPP
+#define BARRIER_BATCH_HPP
+
+#include <liblava/lava.hpp>
+#include <vector>
+
+namespace FluidSimulation
+{
+
+// Collects the image transitions a dispatch depends on and records them as one vkCmdPipelineBarrier2. The images
+// keep the layout, access and stage of their last barrier, a read in the same layout that the last barrier already
+// covers is dropped
+class BarrierBatch
+{
+  public:
+    // Next use of the image, replaces image->transition_layout
+    void Transition(const lava::image::s_ptr &image, VkImageLayout layout, VkAccessFlags access,
+                    VkPipelineStageFlags stage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    void Transition(const lava::texture::s_ptr &texture, VkImageLayout layout, VkAccessFlags access,
+                    VkPipelineStageFlags stage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT)
+    {
+        Transition(texture->get_image(), layout, access, stage);
+    }
+
+    // Records the collected barriers, nothing if every use was dropped
+    void Flush(VkCommandBuffer cmd_buffer);
+
+  private:
+    std::vector<VkImageMemoryBarrier2> image_barriers_;
+};
+
+} // namespace FluidSimulation
+
+#endif // BARRIER_BATCH_HPP
@@ -0,0 +1,57 @@
+#pragma once
+#ifndef BOUNDARY_MAP_PASS_HPP
+#define BOUNDARY_MAP_PASS_HPP
+
+#include "ComputePass.hpp"
+#include "ResourceManager.hpp"
+#include <liblava/lava.hpp>
+#include <vector>
+
+namespace FluidSimulation
+{
+
+// Precomputes where every pressure stencil read of every multigrid level resolves to (boundary_map, boundary_map_L*),
+// so the solvers no longer mirror walls and reflect off obstacles per iteration. Rebuilt only after the mask changed
+class BoundaryMapPass : public ComputePass
+{
+  public:
+    using s_ptr = std::shared_ptr<BoundaryMapPass>;
+
+    BoundaryMapPass(lava::engine &app, lava::descriptor::pool::s_ptr pool, uint32_t max_levels);
+    ~BoundaryMapPass() override;
+
+    void CreateDescriptorSets() override;
+    void UpdateDescriptorSets() override;
+    void CreatePipeline() override;
+    void Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants) override;
+
+    void SetNeedsUpdate(bool value)
+    {
+        needs_update_ = value;
+    }
+    bool GetNeedsUpdate() const
+    {
+        return needs_update_;
+    }
+
+    static s_ptr Make(lava::engine &app, lava::descriptor::pool::s_ptr pool, uint32_t max_levels)
+    {
+        return std::make_shared<BoundaryMapPass>(app, pool, max_levels);
+    }
+
+  private:
+    lava::descriptor::s_ptr descriptor_set_layout_;
+    std::vector<VkDescriptorSet> descriptor_sets_;
+
+    // Level 0 is built from the obstacle distance field, coarser levels from their solid fractions
+    lava::compute_pipeline::s_ptr distance_field_pipeline_;
+
+    std::vector<lava::texture::s_ptr> obstacle_textures_;
+    std::vector<lava::texture::s_ptr> boundary_maps_;
+    uint32_t max_levels_ = 8;
+    bool needs_update_ = true;
+};
+
+} // namespace FluidSimulation
+
+#endif // BOUNDARY_MAP_PASS_HPP
@@ -5,6 +5,7 @@
 #include "ComputePass.hpp"
 #include "ResourceManager.hpp"
 #include <liblava/lava.hpp>
+#include <map>
 
 namespace FluidSimulation
 {
@@ -21,19 +22,60 @@ class ColorAdvectPass : public ComputePass
     void CreatePipeline() override;
     void Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants) override;
 
+    void SetAdvectionScheme(AdvectionScheme scheme)
+    {
+        advection_scheme_ = scheme;
+    }
+    AdvectionScheme GetAdvectionScheme() const
+    {
+        return advection_scheme_;
+    }
+
+    // Each variant is compiled once and kept, the MacCormack corrector follows the same one
+    void SetBacktrace(const BacktraceVariant &backtrace);
+    [[nodiscard]] BacktraceVariant GetBacktrace() const
+    {
+        return backtrace_;
+    }
+
     static s_ptr Make(lava::engine &app, lava::descriptor::pool::s_ptr pool)
     {
         return std::make_shared<ColorAdvectPass>(app, pool);
     }
 
   private:
+    // Kernels of one backtrace variant
+    struct AdvectionPipelines
+    {
+        lava::compute_pipeline::s_ptr advection;
+        lava::compute_pipeline::s_ptr correction;
+    };
+
+    const AdvectionPipelines &GetBacktracePipelines(const BacktraceVariant &backtrace);
+    void ExecuteMacCormack(VkCommandBuffer cmd_buffer, const SimulationConstants &constants);
+    void DispatchTiles(VkCommandBuffer cmd_buffer);
+
     lava::descriptor::s_ptr descriptor_set_layout_;
     VkDescriptorSet descriptor_set_{};
 
+    // MacCormack resources, the predictor is the plain kernel writing to its own texture
+    VkDescriptorSet predictor_descriptor_set_{};
+    lava::descriptor::s_ptr correction_descriptor_set_layout_;
+    VkDescriptorSet correction_descriptor_set_{};
+    lava::pipeline_layout::s_ptr correction_pipeline_layout_;
+
+    std::map<BacktraceVariant, AdvectionPipelines> backtrace_pipelines_;
+    BacktraceVariant backtrace_{};
+
     lava::texture::s_ptr velocity_field_;
     lava::texture::s_ptr color_field_A_;
     lava::texture::s_ptr color_field_B_;
-    lava::texture::s_ptr obstacle_mask_;
+    lava::texture::s_ptr predicted_color_field_;
+    lava::texture::s_ptr obstacle_distance_;
+    lava::buffer::s_ptr tile_buffer_;
+    lava::buffer::s_ptr step_time_buffer_;
+
+    AdvectionScheme advection_scheme_ = AdvectionScheme::Semi_Lagrangian;
 };
 
 } // namespace FluidSimulation
@@ -32,7 +32,9 @@ class ColorUpdatePass : public ComputePass
 
     lava::texture::s_ptr color_field_B_;
     lava::texture::s_ptr color_field_A_;
-    lava::texture::s_ptr obstacle_mask_;
+    lava::texture::s_ptr obstacle_distance_;
+    lava::buffer::s_ptr tile_buffer_;
+    lava::buffer::s_ptr step_time_buffer_;
 };
 
 } // namespace FluidSimulation
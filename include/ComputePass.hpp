@@ -2,6 +2,7 @@
 #ifndef COMPUTE_PASS_HPP
 #define COMPUTE_PASS_HPP
 
+#include "BarrierBatch.hpp"
 #include "FluidConstants.hpp"
 #include <liblava/lava.hpp>
 
@@ -32,11 +33,35 @@ class ComputePass
     lava::compute_pipeline::s_ptr pipeline_;
     lava::pipeline_layout::s_ptr pipeline_layout_;
 
+    // Transitions ahead of the next dispatch, flushed right before it
+    BarrierBatch barriers_;
+
     void CreateBasePipeline(const char *shader_name, lava::descriptor::s_ptr descriptor_set_layout,
                             size_t push_constant_size = 0);
 
+    // Passes running several kernels keep one pipeline and layout per kernel
+    void CreateBasePipeline(lava::compute_pipeline::s_ptr &pipeline, const char *shader_name,
+                            lava::descriptor::s_ptr descriptor_set_layout,
+                            lava::pipeline_layout::s_ptr &existing_pipeline_layout, size_t push_constant_size = 0);
+
+    lava::pipeline_layout::s_ptr CreatePipelineLayout(lava::descriptor::s_ptr descriptor_set_layout,
+                                                      size_t push_constant_size = 0);
+
+    // Variants of one kernel share a layout and differ only in their specialization constants
+    lava::compute_pipeline::s_ptr CreateSpecializedPipeline(
+        const char *shader_name, lava::pipeline_layout::s_ptr pipeline_layout,
+        const std::vector<VkSpecializationMapEntry> &specialization_entries, lava::c_data specialization_data);
+
+    // Variant of a kernel including TileClassification.glsl that runs on one of the tile lists
+    lava::compute_pipeline::s_ptr CreateTilePipeline(const char *shader_name,
+                                                     lava::pipeline_layout::s_ptr pipeline_layout,
+                                                     TileClass tile_class);
+
     void UpdateDescriptorSets(VkDescriptorSet descriptor_set, const std::vector<VkDescriptorImageInfo> &image_infos,
                               const std::vector<VkDescriptorType> &descriptor_types);
+
+    void UpdateDescriptorSets(VkDescriptorSet descriptor_set, const std::vector<VkDescriptorBufferInfo> &buffer_infos,
+                              const std::vector<VkDescriptorType> &descriptor_types, uint32_t first_binding);
 };
 
 } // namespace FluidSimulation
@@ -0,0 +1,106 @@
+#pragma once
+#ifndef CONJUGATE_GRADIENT_PRESSURE_PASS_HPP
+#define CONJUGATE_GRADIENT_PRESSURE_PASS_HPP
+
+#include "ComputePass.hpp"
+#include "ConvergenceControlPass.hpp"
+#include "ResourceManager.hpp"
+#include "VCyclePressurePass.hpp"
+#include <liblava/lava.hpp>
+
+namespace FluidSimulation
+{
+
+// Preconditioned conjugate gradient with one V-cycle as the preconditioner, dot products are reduced on the
+// device so a whole solve is recorded without readbacks
+class ConjugateGradientPressurePass : public ComputePass
+{
+  public:
+    using s_ptr = std::shared_ptr<ConjugateGradientPressurePass>;
+
+    ConjugateGradientPressurePass(lava::engine &app, lava::descriptor::pool::s_ptr pool, uint32_t multigrid_levels);
+    ~ConjugateGradientPressurePass() override;
+
+    void CreateDescriptorSets() override;
+    void UpdateDescriptorSets() override;
+    void CreatePipeline() override;
+    void Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants) override;
+
+    void SetIterations(uint32_t iterations)
+    {
+        iterations_ = iterations;
+    }
+    uint32_t GetIterations() const
+    {
+        return iterations_;
+    }
+    // Iterations after convergence turn into empty dispatches, the preconditioner is gated the same way
+    void SetConvergenceControl(ConvergenceControlPass::s_ptr convergence_control)
+    {
+        convergence_control_ = convergence_control;
+        preconditioner_->SetConvergenceControl(convergence_control, false);
+    }
+
+    static s_ptr Make(lava::engine &app, lava::descriptor::pool::s_ptr pool, uint32_t multigrid_levels)
+    {
+        return std::make_shared<ConjugateGradientPressurePass>(app, pool, multigrid_levels);
+    }
+
+  private:
+    // Matches the dot product modes of ConjugateGradient.glsl
+    static constexpr int DOT_PRODUCT_RESIDUAL = 0;
+    static constexpr int DOT_PRODUCT_DIRECTION = 1;
+    static constexpr int DOT_PRODUCT_STALE_RESIDUAL = 2;
+
+    enum class DispatchShape
+    {
+        Grid,
+        Single_Group,
+        Ungated_Grid // Runs even after convergence
+    };
+
+    void Dispatch(VkCommandBuffer cmd_buffer, lava::compute_pipeline::s_ptr &pipeline,
+                  const ConjugateGradientConstants &constants, DispatchShape shape);
+    void DotProduct(VkCommandBuffer cmd_buffer, ConjugateGradientConstants constants, int dot_product_mode);
+    void Precondition(VkCommandBuffer cmd_buffer, const SimulationConstants &constants);
+    void InsertComputeBarrier(VkCommandBuffer cmd_buffer);
+
+    lava::descriptor::s_ptr descriptor_set_layout_;
+    VkDescriptorSet descriptor_set_{};
+
+    lava::pipeline_layout::s_ptr initialize_pipeline_layout_;
+    lava::compute_pipeline::s_ptr initialize_pipeline_;
+    lava::pipeline_layout::s_ptr dot_product_pipeline_layout_;
+    lava::compute_pipeline::s_ptr dot_product_pipeline_;
+    lava::pipeline_layout::s_ptr reduce_pipeline_layout_;
+    lava::compute_pipeline::s_ptr reduce_pipeline_;
+    lava::pipeline_layout::s_ptr update_direction_pipeline_layout_;
+    lava::compute_pipeline::s_ptr update_direction_pipeline_;
+    lava::pipeline_layout::s_ptr apply_operator_pipeline_layout_;
+    lava::compute_pipeline::s_ptr apply_operator_pipeline_;
+    lava::pipeline_layout::s_ptr update_solution_pipeline_layout_;
+    lava::compute_pipeline::s_ptr update_solution_pipeline_;
+    lava::pipeline_layout::s_ptr finalize_pipeline_layout_;
+    lava::compute_pipeline::s_ptr finalize_pipeline_;
+
+    // Runs on the preconditioner fields so it never disturbs the pressure of the plain multigrid solver
+    VCyclePressurePass::s_ptr preconditioner_;
+    ConvergenceControlPass::s_ptr convergence_control_;
+
+    lava::texture::s_ptr divergence_field_;
+    lava::texture::s_ptr pressure_field_;
+    lava::texture::s_ptr solution_;
+    lava::texture::s_ptr residual_;
+    lava::texture::s_ptr search_direction_;
+    lava::texture::s_ptr operator_result_;
+    lava::texture::s_ptr preconditioner_rhs_;
+    lava::texture::s_ptr preconditioned_residual_;
+    lava::texture::s_ptr obstacle_mask_;
+    lava::buffer::s_ptr reduction_buffer_;
+
+    uint32_t iterations_ = DEFAULT_CONJUGATE_GRADIENT_ITERATIONS;
+};
+
+} // namespace FluidSimulation
+
+#endif // CONJUGATE_GRADIENT_PRESSURE_PASS_HPP
@@ -0,0 +1,87 @@
+#pragma once
+#ifndef CONVERGENCE_CONTROL_PASS_HPP
+#define CONVERGENCE_CONTROL_PASS_HPP
+
+#include "ComputePass.hpp"
+#include "ResourceManager.hpp"
+#include <liblava/lava.hpp>
+
+namespace FluidSimulation
+{
+
+enum class ResidualSource
+{
+    Pressure = 0,          // Residual of pressure_field_A against the divergence
+    Conjugate_Gradient = 1 // Residual already maintained by the conjugate gradient solver
+};
+
+// Keeps the pressure solve on the device until it converges: solvers dispatch through indirect arguments that the
+// residual reduction zeroes once the relative residual drops below the tolerance, the host never waits on it
+class ConvergenceControlPass : public ComputePass
+{
+  public:
+    using s_ptr = std::shared_ptr<ConvergenceControlPass>;
+
+    ConvergenceControlPass(lava::engine &app, lava::descriptor::pool::s_ptr pool, uint32_t multigrid_levels);
+    ~ConvergenceControlPass() override;
+
+    void CreateDescriptorSets() override;
+    void UpdateDescriptorSets() override;
+    void CreatePipeline() override;
+
+    // Checks the residual of pressure_field_A
+    void Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants) override;
+    void CheckResidual(VkCommandBuffer cmd_buffer, const SimulationConstants &constants, ResidualSource source);
+
+    // Restores the full dispatch arguments, recorded once per frame before the pressure solve
+    void Reset(VkCommandBuffer cmd_buffer);
+
+    void DispatchLevel(VkCommandBuffer cmd_buffer, uint32_t level) const;
+    void DispatchRedBlack(VkCommandBuffer cmd_buffer, uint32_t level) const;
+    // Same lists as TileClassificationPass::Dispatch, emptied like the others once the solve converged
+    void DispatchTiles(VkCommandBuffer cmd_buffer, TileClass tile_class) const;
+    void DispatchSingleGroup(VkCommandBuffer cmd_buffer) const;
+
+    void SetTolerance(float tolerance)
+    {
+        tolerance_ = tolerance;
+    }
+    float GetTolerance() const
+    {
+        return tolerance_;
+    }
+
+    // A zero tolerance disables the checks, the dispatch arguments then always stay at their full size
+    bool IsEnabled() const
+    {
+        return tolerance_ > 0.0f;
+    }
+
+    static s_ptr Make(lava::engine &app, lava::descriptor::pool::s_ptr pool, uint32_t multigrid_levels)
+    {
+        return std::make_shared<ConvergenceControlPass>(app, pool, multigrid_levels);
+    }
+
+  private:
+    void InsertIndirectBarrier(VkCommandBuffer cmd_buffer);
+
+    lava::descriptor::s_ptr descriptor_set_layout_;
+    VkDescriptorSet descriptor_set_{};
+
+    lava::pipeline_layout::s_ptr final_reduction_pipeline_layout_;
+    lava::compute_pipeline::s_ptr final_reduction_pipeline_;
+
+    lava::texture::s_ptr divergence_field_;
+    lava::texture::s_ptr pressure_field_;
+    lava::texture::s_ptr conjugate_gradient_residual_;
+    lava::texture::s_ptr boundary_map_;
+    lava::buffer::s_ptr control_buffer_;
+    lava::buffer::s_ptr tile_buffer_;
+
+    ConvergenceControlHeader reset_header_{};
+    float tolerance_ = DEFAULT_PRESSURE_TOLERANCE;
+};
+
+} // namespace FluidSimulation
+
+#endif // CONVERGENCE_CONTROL_PASS_HPP
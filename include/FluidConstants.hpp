@@ -2,7 +2,13 @@
 #ifndef FLUID_CONSTANTS_HPP
 #define FLUID_CONSTANTS_HPP
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <compare>
 #include <cstdint>
+#include <numbers>
+#include <vector>
 
 namespace FluidSimulation
 {
@@ -13,10 +19,9 @@ struct FrameTimeInfo
     float delta_time{};
 };
 
+// The time and the step length live in StepTimeConstants, so a step recorded once replays with every new frame time
 struct SimulationConstants
 {
-    float current_time;
-    float delta_time;
     int texture_width;
     int texture_height;
     int divergence_width;
@@ -24,23 +29,359 @@ struct SimulationConstants
     float fluid_density;
     float vorticity_strength;
     int reset_color;
+    int substep; // Step of the frame, the step starts substep step lengths after the frame time
+};
+
+// Uniform buffer read by the kernels that depend on the time, see StepTime.glsl. Written into the command buffer
+// ahead of every frame
+struct StepTimeConstants
+{
+    float frame_time;
+    float delta_time;
+};
+
+struct RedBlackRelaxationConstants
+{
+    SimulationConstants simulation;
+    int parity;
+    float relaxation_omega;
+};
+
+struct BottomSolveConstants
+{
+    SimulationConstants simulation;
+    int sweeps;
+    float relaxation_omega;
+};
+
+// Largest multigrid level side solved in shared memory by a single workgroup, PressureBottomSolve.comp matches it
+constexpr uint32_t MULTIGRID_BOTTOM_SOLVER_SIZE = 32;
+
+struct ConjugateGradientConstants
+{
+    SimulationConstants simulation;
+    int iteration;
+    int dot_product_mode;
+    int partial_sum_count;
+};
+
+// Filter orders PoissonFilter.glsl has coefficients for, an order n filter has 2n - 1 taps
+constexpr std::array<int32_t, 12> POISSON_FILTER_ORDERS{1, 2, 3, 4, 5, 6, 7, 8, 10, 16, 24, 32};
+constexpr int32_t MAX_POISSON_FILTER_RANKS = 8;
+
+// Specialization constants of the Poisson filter kernels, constant_id 0 and 1
+struct PoissonFilterVariant
+{
+    int32_t order = 32;
+    int32_t ranks = 4;
+
+    auto operator<=>(const PoissonFilterVariant &) const = default;
+};
+
+inline bool IsSupportedPoissonFilter(const PoissonFilterVariant &variant)
+{
+    bool supported_order = false;
+    for (int32_t order : POISSON_FILTER_ORDERS)
+    {
+        supported_order |= (order == variant.order);
+    }
+
+    return supported_order && variant.ranks >= 1 && variant.ranks <= MAX_POISSON_FILTER_RANKS;
+}
+
+// Largest supported order up to the requested one whose kernel still fits into a level of the given size
+inline int32_t FitPoissonFilterOrder(int32_t order, uint32_t size)
+{
+    int32_t fitted_order = POISSON_FILTER_ORDERS.front();
+    for (int32_t candidate : POISSON_FILTER_ORDERS)
+    {
+        if (candidate <= order && static_cast<uint32_t>(2 * candidate - 1) <= size)
+        {
+            fitted_order = candidate;
+        }
+    }
+
+    return fitted_order;
+}
+
+struct TiledJacobiConstants
+{
+    SimulationConstants simulation;
+    int sweeps;
+};
+
+// Upper bound of the tiled Jacobi halo, PressureProjectionJacobiTiled.comp sizes its registers for it
+constexpr uint32_t MAX_JACOBI_SWEEPS_PER_DISPATCH = 8;
+
+struct ChebyshevConstants
+{
+    SimulationConstants simulation;
+    float previous_weight; // Weight of the step from the second to last to the last iterate
+    float jacobi_weight;   // Weight of the Jacobi correction of the last iterate
+};
+
+// Gershgorin bound on the eigenvalues of the Jacobi preconditioned 5-point Laplacian, reflected obstacles included
+constexpr float CHEBYSHEV_SPECTRUM_UPPER_BOUND = 2.0f;
+// The smoother only damps the upper part of the spectrum, the modes a coarser grid cannot represent
+constexpr float CHEBYSHEV_SMOOTHING_RANGE = 4.0f;
+
+// Smallest non-zero eigenvalue of the Jacobi preconditioned Neumann Laplacian, set by the longest grid side
+inline float ChebyshevSpectrumLowerBound(int32_t width, int32_t height)
+{
+    const float longest_side = static_cast<float>(std::max(std::max(width, height), 2));
+    return 0.5f * (1.0f - std::cos(std::numbers::pi_v<float> / longest_side));
+}
+
+// Weights of the three-term Chebyshev recurrence for a spectrum in [lower, upper], the polynomial after every
+// iteration is the optimal one of its degree, so stopping early on convergence keeps the guarantee
+inline std::vector<std::array<float, 2>> CalculateChebyshevWeights(float lower, float upper, uint32_t iterations)
+{
+    std::vector<std::array<float, 2>> weights(iterations);
+
+    const float center = 0.5f * (upper + lower);
+    const float half_width = 0.5f * (upper - lower);
+    const float sigma = center / half_width;
+
+    float rho = 1.0f / sigma;
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        if (i == 0)
+        {
+            weights[i] = {0.0f, 1.0f / center};
+            continue;
+        }
+
+        const float next_rho = 1.0f / (2.0f * sigma - rho);
+        weights[i] = {next_rho * rho, 2.0f * next_rho / half_width};
+        rho = next_rho;
+    }
+
+    return weights;
+}
+
+struct SpectralConstants
+{
+    SimulationConstants simulation;
+    int stage;
+    int periodic;
+};
+
+struct ConvergenceConstants
+{
+    SimulationConstants simulation;
+    float tolerance;
+    int residual_source;
+    int partial_sum_count;
+};
+
+// Matches ConvergenceControl.glsl, dispatch arguments are padded to the std430 array stride
+constexpr uint32_t MAX_CONVERGENCE_LEVELS = 16;
+
+struct IndirectDispatch
+{
+    uint32_t x;
+    uint32_t y;
+    uint32_t z;
+    uint32_t padding;
+};
+
+struct ConvergenceControlHeader
+{
+    IndirectDispatch level_dispatch[MAX_CONVERGENCE_LEVELS];
+    IndirectDispatch red_black_dispatch[MAX_CONVERGENCE_LEVELS];
+    IndirectDispatch single_group_dispatch;
+    float residual_norm;
+    float rhs_norm;
+    uint32_t converged;
+    uint32_t checks;
+    // Copied from the tile classification every frame, they follow the obstacles rather than the grid size
+    IndirectDispatch interior_tile_dispatch;
+    IndirectDispatch boundary_tile_dispatch;
 };
 
+// Selects the cells a kernel including TileClassification.glsl runs on, passed as its specialization constant
+enum class TileClass : int32_t
+{
+    All,      // Plain grid dispatch, every cell takes the boundary checks
+    Interior, // Tiles clear of walls and obstacles, dispatched from the interior list
+    Boundary  // Every other tile, dispatched from the boundary list
+};
+
+// Matches TileClassification.glsl, the interior list starts right after the header and the boundary list one full
+// tile count later. The combined dispatch runs both lists at once, interior tiles first
+struct TileClassificationHeader
+{
+    IndirectDispatch interior_dispatch;
+    IndirectDispatch boundary_dispatch;
+    IndirectDispatch combined_dispatch;
+};
+
+struct ActiveTileConstants
+{
+    SimulationConstants simulation;
+    int stage;
+    int activate_all;
+    float velocity_threshold; // Speed in domain lengths per second below which a cell is at rest
+    float dye_threshold;      // Dye change over one step, speed times the dye gradient, below which it is at rest
+};
+
+constexpr float ACTIVE_TILE_VELOCITY_THRESHOLD = 1e-3f;
+// Half a step of the 8 bit color fields, smaller changes round away
+constexpr float ACTIVE_TILE_DYE_THRESHOLD = 0.5f / 255.0f;
+
 struct MultigridConstants
 {
     int fine_width;
     int fine_height;
     int coarse_width;
     int coarse_height;
+    int replace_fine_values; // Prolongation only, overwrites the fine level instead of adding the correction
+};
+
+// Semi-Lagrangian tracing is first order and diffusive, MacCormack adds a limited error correction in a second
+// dispatch
+enum class AdvectionScheme : uint32_t
+{
+    Semi_Lagrangian,
+    MacCormack
+};
+
+// Integrator following the velocity field back along a particle path, the higher orders reach the same accuracy in
+// fewer substeps and velocity fetches
+enum class BacktraceIntegrator : int32_t
+{
+    Euler,
+    RK2,
+    RK3
+};
+
+constexpr int32_t MAX_BACKTRACE_SUBSTEPS = 16;
+
+// Specialization constants of the advection kernels, constant_id 1 and 2
+struct BacktraceVariant
+{
+    BacktraceIntegrator integrator = BacktraceIntegrator::Euler;
+    int32_t substeps = 10;
+
+    auto operator<=>(const BacktraceVariant &) const = default;
+};
+
+// Specialization data of the advection kernels, constant_id 0 is the kernel's own switch
+struct AdvectionSpecialization
+{
+    uint32_t kernel_switch; // VkBool32
+    BacktraceVariant backtrace;
+};
+
+inline bool IsSupportedBacktrace(const BacktraceVariant &variant)
+{
+    return variant.integrator >= BacktraceIntegrator::Euler && variant.integrator <= BacktraceIntegrator::RK3 &&
+           variant.substeps >= 1 && variant.substeps <= MAX_BACKTRACE_SUBSTEPS;
+}
+
+struct ObstacleDistanceConstants
+{
+    SimulationConstants simulation;
+    int stage;
+    int step_size;
+};
+
+struct MaxVelocityConstants
+{
+    SimulationConstants simulation;
+    int readback_slot;
 };
 
+// Frames a max velocity reduction stays in its readback slot, must exceed the frames in flight so the slot being
+// read has always finished on the device
+constexpr uint32_t MAX_VELOCITY_READBACK_FRAMES = 4;
+
+// Upper bound of the steps per frame the CFL condition may ask for, bounds the cost of a violent frame
+constexpr uint32_t MAX_CFL_SUBSTEPS = 8;
+
+// Longest time one simulation step covers, longer frames are clamped to it
+constexpr float MAX_STEP_DELTA_TIME = 1.0f / 30.0f;
+
+// Fixed steps one frame may run to catch up, the time a slower frame leaves over is dropped instead of queueing ever
+// more steps
+constexpr uint32_t MAX_FIXED_STEPS_PER_FRAME = 8;
+
+// Copies of the dye and the obstacle mask the window samples, the step being simulated writes one while the frame
+// shows the previous step from the other
+constexpr uint32_t DISPLAY_SLOT_COUNT = 2;
+
+// Distance in cells one backtrace substep may cover before the trace is subdivided further
+constexpr float BACKTRACE_CELLS_PER_SUBSTEP = 1.0f;
+
+struct TimestepPlan
+{
+    float delta_time;           // Per step
+    uint32_t steps;             // Per frame
+    int32_t backtrace_substeps; // Per advection
+};
+
+// Splits a frame so the fastest particle crosses at most target_cfl cells per step, the CFL number being the cells
+// covered in one step. Backtrace substeps are rounded up to powers of two to bound the compiled variants
+inline TimestepPlan PlanTimestep(float frame_delta_time, float max_velocity, uint32_t shortest_side, float target_cfl,
+                                 uint32_t max_steps, int32_t max_backtrace_substeps)
+{
+    const float frame_cfl = max_velocity * frame_delta_time * static_cast<float>(shortest_side);
+    const float steps = std::ceil(frame_cfl / std::max(target_cfl, 1e-3f));
+
+    TimestepPlan plan{};
+    plan.steps = std::clamp(static_cast<uint32_t>(std::min(steps, static_cast<float>(max_steps))), 1u, max_steps);
+    plan.delta_time = frame_delta_time / static_cast<float>(plan.steps);
+
+    const float step_cfl = frame_cfl / static_cast<float>(plan.steps);
+    int32_t backtrace_substeps = 1;
+    while (backtrace_substeps < max_backtrace_substeps &&
+           static_cast<float>(backtrace_substeps) * BACKTRACE_CELLS_PER_SUBSTEP < step_cfl)
+    {
+        backtrace_substeps *= 2;
+    }
+    plan.backtrace_substeps = std::min(backtrace_substeps, max_backtrace_substeps);
+
+    return plan;
+}
+
 enum class PressureProjectionMethod : uint32_t
 {
     None = 0,
     Jacobi = 1 << 0,
     Poisson_Filter = 1 << 1,
     Multigrid = 1 << 2,
-    Multigrid_Poisson = 1 << 3
+    Multigrid_Poisson = 1 << 3,
+    Multigrid_Red_Black = 1 << 4,
+    Multigrid_PCG = 1 << 5,
+    Spectral_DCT = 1 << 6,
+    Spectral_FFT = 1 << 7
+};
+
+// Order in which the multigrid levels are visited on every Execute
+enum class MultigridCycleType
+{
+    V_Cycle,
+    W_Cycle,
+    F_Cycle,
+    Full_Multigrid
+};
+
+// Storage precision of a family of scalar fields, every shader reading them is format-less so both share one path
+enum class FieldPrecision : uint32_t
+{
+    FP16,
+    FP32
+};
+
+// Chosen at startup, the pressure and divergence families are the full resolution solver fields and the multigrid
+// family covers the coarse levels and the preconditioner
+struct PrecisionPolicy
+{
+    FieldPrecision pressure = FieldPrecision::FP16;
+    FieldPrecision divergence = FieldPrecision::FP16;
+    FieldPrecision multigrid = FieldPrecision::FP16;
+    // Multigrid solves for fp16 corrections of the residual while pressure and divergence stay in fp32
+    bool mixed_precision = false;
 };
 
 inline bool HasMethod(PressureProjectionMethod method, PressureProjectionMethod flag)
@@ -48,6 +389,28 @@ inline bool HasMethod(PressureProjectionMethod method, PressureProjectionMethod
     return (static_cast<uint32_t>(method) & static_cast<uint32_t>(flag)) != 0;
 }
 
+// Settings a new simulation starts with, the headless runner uses them for everything its arguments leave out
+constexpr PressureProjectionMethod DEFAULT_PRESSURE_PROJECTION_METHOD = PressureProjectionMethod::Jacobi;
+constexpr AdvectionScheme DEFAULT_ADVECTION_SCHEME = AdvectionScheme::Semi_Lagrangian;
+constexpr float DEFAULT_FIXED_TIMESTEP = 1.0f / 60.0f;
+constexpr bool DEFAULT_ADAPTIVE_TIMESTEP = false;
+constexpr float DEFAULT_TARGET_CFL = 2.0f;
+constexpr uint32_t DEFAULT_MAX_SUBSTEPS = 4;
+constexpr uint32_t DEFAULT_PRESSURE_JACOBI_ITERATIONS = 32;
+constexpr uint32_t DEFAULT_JACOBI_SWEEPS_PER_DISPATCH = 4;
+constexpr bool DEFAULT_CHEBYSHEV_ACCELERATION = false;
+constexpr bool DEFAULT_TILE_CLASSIFICATION = true;
+constexpr bool DEFAULT_SPARSE_SIMULATION = false;
+constexpr bool DEFAULT_STEP_REPLAY = false;
+constexpr float DEFAULT_RELAXATION_OMEGA = 1.0f;
+constexpr uint32_t DEFAULT_CONJUGATE_GRADIENT_ITERATIONS = 8;
+constexpr MultigridCycleType DEFAULT_MULTIGRID_CYCLE_TYPE = MultigridCycleType::V_Cycle;
+constexpr uint32_t DEFAULT_MULTIGRID_CYCLES = 3;
+constexpr bool DEFAULT_MULTIGRID_BOTTOM_SOLVER = true;
+constexpr float DEFAULT_PRESSURE_TOLERANCE = 1e-3f;
+constexpr PoissonFilterVariant DEFAULT_POISSON_FILTER{32, 4};
+constexpr PoissonFilterVariant DEFAULT_MULTIGRID_POISSON_FILTER{7, 4};
+
 } // namespace FluidSimulation
 
 #endif // FLUID_CONSTANTS_HPP
\ No newline at end of file
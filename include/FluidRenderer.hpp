@@ -2,8 +2,10 @@
 #ifndef FLUID_RENDERER_HPP
 #define FLUID_RENDERER_HPP
 
+#include "AsyncCompute.hpp"
 #include "ResourceManager.hpp"
 #include "Simulation.hpp"
+#include <array>
 #include <liblava/lava.hpp>
 
 namespace FluidSimulation
@@ -23,6 +25,7 @@ class FluidRenderer
 
     void Destroy();
 
+    // Submits the next simulation step to the compute queue, see AsyncCompute
     void OnCompute(VkCommandBuffer cmd_buffer, const FrameTimeInfo &frame_context);
     void OnRender(uint32_t frame, VkCommandBuffer cmd_buffer);
 
@@ -42,6 +45,7 @@ class FluidRenderer
     }
 
     Simulation::s_ptr simulation_;
+    AsyncCompute::s_ptr async_compute_;
 
     static s_ptr Make(lava::engine &app)
     {
@@ -64,7 +68,7 @@ class FluidRenderer
     lava::descriptor::pool::s_ptr descriptor_pool_;
 
     lava::descriptor::s_ptr render_descriptor_set_layout_;
-    VkDescriptorSet render_descriptor_set_{};
+    std::array<VkDescriptorSet, DISPLAY_SLOT_COUNT> render_descriptor_sets_{}; // One per display slot
 
     lava::pipeline_layout::s_ptr render_pipeline_layout_;
     lava::render_pipeline::s_ptr render_pipeline_;
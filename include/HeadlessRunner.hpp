@@ -0,0 +1,80 @@
+#pragma once
+#ifndef HEADLESS_RUNNER_HPP
+#define HEADLESS_RUNNER_HPP
+
+#include "FluidConstants.hpp"
+#include "Simulation.hpp"
+#include <liblava/lava.hpp>
+#include <optional>
+
+namespace FluidSimulation
+{
+
+struct HeadlessRunConfig
+{
+    glm::uvec2 grid_size{1024, 1024};
+    uint32_t steps = 1000;
+    float delta_time = DEFAULT_FIXED_TIMESTEP;
+    uint32_t steps_per_submit = 16;
+
+    // The simulation settings start from the defaults of the windowed app
+    PressureProjectionMethod pressure_projection_method = DEFAULT_PRESSURE_PROJECTION_METHOD;
+    AdvectionScheme advection_scheme = DEFAULT_ADVECTION_SCHEME;
+    BacktraceVariant backtrace;
+    bool adaptive_timestep = DEFAULT_ADAPTIVE_TIMESTEP;
+    float target_cfl = DEFAULT_TARGET_CFL;
+    uint32_t max_substeps = DEFAULT_MAX_SUBSTEPS;
+    uint32_t pressure_jacobi_iterations = DEFAULT_PRESSURE_JACOBI_ITERATIONS;
+    uint32_t jacobi_sweeps_per_dispatch = DEFAULT_JACOBI_SWEEPS_PER_DISPATCH;
+    bool chebyshev_acceleration = DEFAULT_CHEBYSHEV_ACCELERATION;
+    bool tile_classification = DEFAULT_TILE_CLASSIFICATION;
+    bool sparse_simulation = DEFAULT_SPARSE_SIMULATION;
+    bool step_replay = DEFAULT_STEP_REPLAY;
+    float relaxation_omega = DEFAULT_RELAXATION_OMEGA;
+    uint32_t conjugate_gradient_iterations = DEFAULT_CONJUGATE_GRADIENT_ITERATIONS;
+    MultigridCycleType multigrid_cycle_type = DEFAULT_MULTIGRID_CYCLE_TYPE;
+    uint32_t multigrid_cycles = DEFAULT_MULTIGRID_CYCLES;
+    bool multigrid_bottom_solver = DEFAULT_MULTIGRID_BOTTOM_SOLVER;
+    float pressure_tolerance = DEFAULT_PRESSURE_TOLERANCE;
+    PoissonFilterVariant poisson_filter = DEFAULT_POISSON_FILTER;
+    PoissonFilterVariant multigrid_poisson_filter = DEFAULT_MULTIGRID_POISSON_FILTER;
+    PrecisionPolicy precision_policy;
+};
+
+// Steps the simulation offline on a compute-only device, without a window or swapchain
+class HeadlessRunner
+{
+  public:
+    using s_ptr = std::shared_ptr<HeadlessRunner>;
+
+    HeadlessRunner(lava::engine &app, const HeadlessRunConfig &config);
+    HeadlessRunner(const HeadlessRunner &) = delete;
+    HeadlessRunner &operator=(const HeadlessRunner &) = delete;
+    HeadlessRunner(HeadlessRunner &&other) = delete;
+    HeadlessRunner &operator=(HeadlessRunner &&other) = delete;
+
+    ~HeadlessRunner() = default;
+
+    bool Run();
+
+    // Creates a device exposing a single compute queue, must be called before app.setup()
+    static bool CreateComputeDevice(lava::engine &app);
+
+    // Reads an optional JSON scenario (--scenario=file.json), command line arguments override its values. Empty when
+    // a value is invalid, the reason is logged
+    static std::optional<HeadlessRunConfig> ParseConfig(lava::cmd_line cmd_line);
+
+    // Null when the simulation cannot be built for the configuration, the reason is logged
+    static s_ptr Make(lava::engine &app, const HeadlessRunConfig &config);
+
+  private:
+    static HeadlessRunConfig ReadConfig(lava::cmd_line cmd_line);
+
+    lava::engine &app_;
+    HeadlessRunConfig config_;
+    Simulation::s_ptr simulation_;
+};
+
+} // namespace FluidSimulation
+
+#endif // HEADLESS_RUNNER_HPP
@@ -3,8 +3,11 @@
 #define JACOBI_PRESSURE_PASS_HPP
 
 #include "ComputePass.hpp"
+#include "ConvergenceControlPass.hpp"
 #include "ResourceManager.hpp"
+#include "TileClassificationPass.hpp"
 #include <liblava/lava.hpp>
+#include <map>
 
 namespace FluidSimulation
 {
@@ -21,14 +24,50 @@ class JacobiPressurePass : public ComputePass
     void CreatePipeline() override;
     void Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants) override;
 
+    // Must be even so the ping-pong ends in texture A, which the descriptor sets of the other passes read
     void SetIterations(uint32_t iterations)
     {
+        if (iterations % 2 != 0)
+        {
+            lava::logger()->error("Jacobi pressure solve needs an even iteration count, got {}", iterations);
+            throw std::invalid_argument("Jacobi pressure solve needs an even iteration count");
+        }
         pressure_jacobi_iterations_ = iterations;
     }
     uint32_t GetIterations() const
     {
         return pressure_jacobi_iterations_;
     }
+    // The residual is checked every check_interval iterations, an even interval keeps the result in texture A
+    void SetConvergenceControl(ConvergenceControlPass::s_ptr convergence_control, uint32_t check_interval)
+    {
+        convergence_control_ = convergence_control;
+        convergence_check_interval_ = std::max(2u, check_interval & ~1u);
+    }
+
+    // Above one, tiles with a halo of this width run that many sweeps in shared memory per dispatch
+    void SetSweepsPerDispatch(uint32_t sweeps_per_dispatch);
+    uint32_t GetSweepsPerDispatch() const
+    {
+        return sweeps_per_dispatch_;
+    }
+
+    // Chebyshev semi-iteration on the single sweep path, weights follow from the spectrum bounds of the grid
+    void SetChebyshevAcceleration(bool enabled)
+    {
+        chebyshev_acceleration_ = enabled;
+    }
+    bool GetChebyshevAcceleration() const
+    {
+        return chebyshev_acceleration_;
+    }
+
+    // Splits the single sweep dispatches into the interior and the boundary tile list, the tiled and Chebyshev
+    // sweeps keep dispatching the whole grid
+    void SetTileClassification(TileClassificationPass::s_ptr tile_classification)
+    {
+        tile_classification_ = tile_classification;
+    }
 
     static s_ptr Make(lava::engine &app, lava::descriptor::pool::s_ptr pool)
     {
@@ -36,6 +75,12 @@ class JacobiPressurePass : public ComputePass
     }
 
   private:
+    void ExecuteTiled(VkCommandBuffer cmd_buffer, const SimulationConstants &constants);
+    void ExecuteChebyshev(VkCommandBuffer cmd_buffer, const SimulationConstants &constants);
+    void DispatchGrid(VkCommandBuffer cmd_buffer, const SimulationConstants &constants);
+    void DispatchTiles(VkCommandBuffer cmd_buffer, TileClass tile_class);
+    lava::compute_pipeline::s_ptr GetTiledPipeline(uint32_t halo);
+
     lava::descriptor::s_ptr descriptor_set_layout_;
     VkDescriptorSet descriptor_set_A_{};
     VkDescriptorSet descriptor_set_B_{};
@@ -43,9 +88,25 @@ class JacobiPressurePass : public ComputePass
     lava::texture::s_ptr divergence_field_;
     lava::texture::s_ptr pressure_field_A_;
     lava::texture::s_ptr pressure_field_B_;
-    lava::texture::s_ptr obstacle_mask_;
+    lava::texture::s_ptr boundary_map_;
+    lava::buffer::s_ptr tile_buffer_;
+
+    TileClassificationPass::s_ptr tile_classification_;
+    lava::compute_pipeline::s_ptr interior_pipeline_;
+    lava::compute_pipeline::s_ptr boundary_pipeline_;
+
+    ConvergenceControlPass::s_ptr convergence_control_;
+    uint32_t convergence_check_interval_ = 8;
+
+    lava::pipeline_layout::s_ptr tiled_pipeline_layout_;
+    std::map<uint32_t, lava::compute_pipeline::s_ptr> tiled_pipelines_;
+
+    lava::pipeline_layout::s_ptr chebyshev_pipeline_layout_;
+    lava::compute_pipeline::s_ptr chebyshev_pipeline_;
 
-    uint32_t pressure_jacobi_iterations_ = 32;
+    uint32_t pressure_jacobi_iterations_ = DEFAULT_PRESSURE_JACOBI_ITERATIONS;
+    uint32_t sweeps_per_dispatch_ = 1;
+    bool chebyshev_acceleration_ = false;
 };
 
 } // namespace FluidSimulation
@@ -0,0 +1,68 @@
+#pragma once
+#ifndef MAX_VELOCITY_PASS_HPP
+#define MAX_VELOCITY_PASS_HPP
+
+#include "ComputePass.hpp"
+#include "ResourceManager.hpp"
+#include <array>
+#include <liblava/lava.hpp>
+#include <optional>
+
+namespace FluidSimulation
+{
+
+// Reduces max |u| over the velocity field into a host visible ring, the host reads the newest slot a finished
+// submission wrote so the result arrives a few frames late without ever waiting on the device
+class MaxVelocityPass : public ComputePass
+{
+  public:
+    using s_ptr = std::shared_ptr<MaxVelocityPass>;
+
+    MaxVelocityPass(lava::engine &app, lava::descriptor::pool::s_ptr pool);
+    ~MaxVelocityPass() override;
+
+    void CreateDescriptorSets() override;
+    void UpdateDescriptorSets() override;
+    void CreatePipeline() override;
+
+    // Records the reduction into the next readback slot, once per submission
+    void Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants) override;
+
+    // Submissions are numbered from 1, a slot is only read once the submission that last wrote it has finished
+    void BeginSubmission(uint64_t submission, uint64_t completed_submission)
+    {
+        submission_ = submission;
+        completed_submission_ = completed_submission;
+    }
+
+    // Newest reading of a finished submission, the previous one while none is newer. False until a finished
+    // submission produced a finite, non-negative speed
+    bool ReadMaxVelocity(float &max_velocity);
+
+    static s_ptr Make(lava::engine &app, lava::descriptor::pool::s_ptr pool)
+    {
+        return std::make_shared<MaxVelocityPass>(app, pool);
+    }
+
+  private:
+    lava::descriptor::s_ptr descriptor_set_layout_;
+    VkDescriptorSet descriptor_set_{};
+
+    lava::texture::s_ptr velocity_field_;
+    lava::buffer::s_ptr readback_buffer_;
+
+    uint64_t recorded_frames_ = 0;
+    uint64_t submission_ = 0;
+    uint64_t completed_submission_ = 0;
+
+    // Per slot, the submission that last wrote it (0 before the first) and the recorded frame count after the write
+    std::array<uint64_t, MAX_VELOCITY_READBACK_FRAMES> slot_submissions_{};
+    std::array<uint64_t, MAX_VELOCITY_READBACK_FRAMES> slot_frames_{};
+
+    uint64_t read_frame_ = 0; // Recorded frame count of the last reading taken
+    std::optional<float> max_velocity_;
+};
+
+} // namespace FluidSimulation
+
+#endif // MAX_VELOCITY_PASS_HPP
@@ -0,0 +1,80 @@
+#pragma once
+#ifndef MIXED_PRECISION_REFINEMENT_PASS_HPP
+#define MIXED_PRECISION_REFINEMENT_PASS_HPP
+
+#include "ComputePass.hpp"
+#include "ConvergenceControlPass.hpp"
+#include "ResourceManager.hpp"
+#include "VCyclePressurePass.hpp"
+#include <liblava/lava.hpp>
+
+namespace FluidSimulation
+{
+
+// Iterative refinement around the multigrid cycle: the residual of the full precision pressure is solved for a
+// correction on half precision fields, which is then accumulated back at full precision
+class MixedPrecisionRefinementPass : public ComputePass
+{
+  public:
+    using s_ptr = std::shared_ptr<MixedPrecisionRefinementPass>;
+
+    MixedPrecisionRefinementPass(lava::engine &app, lava::descriptor::pool::s_ptr pool, uint32_t multigrid_levels);
+    ~MixedPrecisionRefinementPass() override;
+
+    void CreateDescriptorSets() override;
+    void UpdateDescriptorSets() override;
+    void CreatePipeline() override;
+    void Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants) override;
+
+    // One cycle of the correction solve per refinement step
+    void SetRefinementSteps(uint32_t steps)
+    {
+        refinement_steps_ = steps;
+    }
+    // Residuals are checked between steps, the correction cycle is gated but never checks by itself
+    void SetConvergenceControl(ConvergenceControlPass::s_ptr convergence_control)
+    {
+        convergence_control_ = convergence_control;
+        correction_solver_->SetConvergenceControl(convergence_control, false);
+    }
+    // Configured like the plain multigrid solver, relaxation type, cycle shape and smoother settings
+    VCyclePressurePass::s_ptr GetCorrectionSolver() const
+    {
+        return correction_solver_;
+    }
+
+    static s_ptr Make(lava::engine &app, lava::descriptor::pool::s_ptr pool, uint32_t multigrid_levels)
+    {
+        return std::make_shared<MixedPrecisionRefinementPass>(app, pool, multigrid_levels);
+    }
+
+  private:
+    void CalculateResidual(VkCommandBuffer cmd_buffer, const SimulationConstants &constants);
+    void ApplyCorrection(VkCommandBuffer cmd_buffer, const SimulationConstants &constants);
+    void DispatchGrid(VkCommandBuffer cmd_buffer, const SimulationConstants &constants);
+
+    lava::descriptor::s_ptr residual_descriptor_set_layout_;
+    VkDescriptorSet residual_descriptor_set_{};
+    lava::pipeline_layout::s_ptr residual_pipeline_layout_;
+    lava::compute_pipeline::s_ptr residual_pipeline_;
+
+    lava::descriptor::s_ptr correction_descriptor_set_layout_;
+    VkDescriptorSet correction_descriptor_set_{};
+    lava::pipeline_layout::s_ptr correction_pipeline_layout_;
+    lava::compute_pipeline::s_ptr correction_pipeline_;
+
+    VCyclePressurePass::s_ptr correction_solver_;
+    ConvergenceControlPass::s_ptr convergence_control_;
+
+    lava::texture::s_ptr divergence_field_;
+    lava::texture::s_ptr pressure_field_;
+    lava::texture::s_ptr refinement_residual_;
+    lava::texture::s_ptr refinement_correction_;
+    lava::texture::s_ptr boundary_map_;
+
+    uint32_t refinement_steps_ = 3;
+};
+
+} // namespace FluidSimulation
+
+#endif // MIXED_PRECISION_REFINEMENT_PASS_HPP
@@ -0,0 +1,58 @@
+#pragma once
+#ifndef OBSTACLE_DISTANCE_PASS_HPP
+#define OBSTACLE_DISTANCE_PASS_HPP
+
+#include "ComputePass.hpp"
+#include "ResourceManager.hpp"
+#include <liblava/lava.hpp>
+
+namespace FluidSimulation
+{
+
+// Jump floods the obstacle mask into a signed distance field with normals (obstacle_distance), so boundary queries
+// take a single filtered fetch. Rebuilt only after the mask changed
+class ObstacleDistancePass : public ComputePass
+{
+  public:
+    using s_ptr = std::shared_ptr<ObstacleDistancePass>;
+
+    ObstacleDistancePass(lava::engine &app, lava::descriptor::pool::s_ptr pool);
+    ~ObstacleDistancePass() override;
+
+    void CreateDescriptorSets() override;
+    void UpdateDescriptorSets() override;
+    void CreatePipeline() override;
+    void Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants) override;
+
+    void SetNeedsUpdate(bool value)
+    {
+        needs_update_ = value;
+    }
+    bool GetNeedsUpdate() const
+    {
+        return needs_update_;
+    }
+
+    static s_ptr Make(lava::engine &app, lava::descriptor::pool::s_ptr pool)
+    {
+        return std::make_shared<ObstacleDistancePass>(app, pool);
+    }
+
+  private:
+    void TransitionSeeds(VkCommandBuffer cmd_buffer);
+
+    lava::descriptor::s_ptr descriptor_set_layout_;
+    VkDescriptorSet descriptor_set_A_{}; // Reads seeds A, writes seeds B
+    VkDescriptorSet descriptor_set_B_{}; // Reads seeds B, writes seeds A
+
+    lava::texture::s_ptr obstacle_mask_;
+    lava::texture::s_ptr obstacle_seeds_A_;
+    lava::texture::s_ptr obstacle_seeds_B_;
+    lava::texture::s_ptr obstacle_distance_;
+
+    bool needs_update_ = true;
+};
+
+} // namespace FluidSimulation
+
+#endif // OBSTACLE_DISTANCE_PASS_HPP
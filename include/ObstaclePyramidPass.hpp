@@ -0,0 +1,54 @@
+#pragma once
+#ifndef OBSTACLE_PYRAMID_PASS_HPP
+#define OBSTACLE_PYRAMID_PASS_HPP
+
+#include "ComputePass.hpp"
+#include "ResourceManager.hpp"
+#include <liblava/lava.hpp>
+#include <vector>
+
+namespace FluidSimulation
+{
+
+// Averages the obstacle mask into the solid fractions of every multigrid level (obstacle_mask_L*), rebuilt only
+// after the mask changed
+class ObstaclePyramidPass : public ComputePass
+{
+  public:
+    using s_ptr = std::shared_ptr<ObstaclePyramidPass>;
+
+    ObstaclePyramidPass(lava::engine &app, lava::descriptor::pool::s_ptr pool, uint32_t max_levels);
+    ~ObstaclePyramidPass() override;
+
+    void CreateDescriptorSets() override;
+    void UpdateDescriptorSets() override;
+    void CreatePipeline() override;
+    void Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants) override;
+
+    void SetNeedsUpdate(bool value)
+    {
+        needs_update_ = value;
+    }
+    bool GetNeedsUpdate() const
+    {
+        return needs_update_;
+    }
+
+    static s_ptr Make(lava::engine &app, lava::descriptor::pool::s_ptr pool, uint32_t max_levels)
+    {
+        return std::make_shared<ObstaclePyramidPass>(app, pool, max_levels);
+    }
+
+  private:
+    lava::descriptor::s_ptr descriptor_set_layout_;
+    std::vector<VkDescriptorSet> descriptor_sets_;
+
+    // Level 0 is the obstacle mask itself
+    std::vector<lava::texture::s_ptr> obstacle_masks_;
+    uint32_t max_levels_ = 8;
+    bool needs_update_ = true;
+};
+
+} // namespace FluidSimulation
+
+#endif // OBSTACLE_PYRAMID_PASS_HPP
@@ -5,6 +5,7 @@
 #include "ComputePass.hpp"
 #include "ResourceManager.hpp"
 #include <liblava/lava.hpp>
+#include <map>
 
 namespace FluidSimulation
 {
@@ -21,20 +22,30 @@ class PoissonPressurePass : public ComputePass
     void CreatePipeline() override;
     void Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants) override;
 
+    // Lower orders and fewer ranks trade accuracy for speed, each variant is compiled once and kept
+    void SetFilter(const PoissonFilterVariant &filter);
+    [[nodiscard]] PoissonFilterVariant GetFilter() const
+    {
+        return filter_;
+    }
+
     static s_ptr Make(lava::engine &app, lava::descriptor::pool::s_ptr pool)
     {
         return std::make_shared<PoissonPressurePass>(app, pool);
     }
 
   private:
+    lava::compute_pipeline::s_ptr GetFilterPipeline(const PoissonFilterVariant &filter);
+
     lava::descriptor::s_ptr descriptor_set_layout_;
     VkDescriptorSet descriptor_set_{};
 
     lava::texture::s_ptr divergence_field_;
     lava::texture::s_ptr pressure_field_;
-    lava::texture::s_ptr temp_texture_;
-    lava::texture::s_ptr temp_texture1_;
-    lava::texture::s_ptr obstacle_mask_;
+    lava::texture::s_ptr boundary_map_;
+
+    std::map<PoissonFilterVariant, lava::compute_pipeline::s_ptr> filter_pipelines_;
+    PoissonFilterVariant filter_{};
 };
 
 } // namespace FluidSimulation
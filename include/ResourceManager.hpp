@@ -6,6 +6,7 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace FluidSimulation
 {
@@ -50,6 +51,7 @@ class ResourceManager
     lava::texture::s_ptr GetTexture(const std::string &name);
     void DestroyTexture(const std::string &name);
     bool HasTexture(const std::string &name) const;
+    std::vector<lava::texture::s_ptr> GetAllTextures() const;
 
     void CreateBuffer(const std::string &name, VkDeviceSize size, VkBufferUsageFlags usage,
                       VmaMemoryUsage memory_usage);
@@ -3,20 +3,31 @@
 #ifndef SIMULATION_HPP
 #define SIMULATION_HPP
 
+#include "ActiveTilePass.hpp"
+#include "BoundaryMapPass.hpp"
 #include "ColorAdvectPass.hpp"
 #include "ColorUpdatePass.hpp"
 #include "ComputePass.hpp"
+#include "ConjugateGradientPressurePass.hpp"
+#include "ConvergenceControlPass.hpp"
 #include "DivergenceCalculationPass.hpp"
 #include "JacobiPressurePass.hpp"
+#include "MaxVelocityPass.hpp"
+#include "MixedPrecisionRefinementPass.hpp"
+#include "ObstacleDistancePass.hpp"
 #include "ObstacleFillingPass.hpp"
+#include "ObstaclePyramidPass.hpp"
 #include "PoissonPressurePass.hpp"
-#include "ResidualCalculationPass.hpp"
 #include "ResourceManager.hpp"
+#include "SpectralPressurePass.hpp"
+#include "TileClassificationPass.hpp"
 #include "VCyclePressurePass.hpp"
 #include "VelocityAdvectionPass.hpp"
 #include "VelocityUpdatePass.hpp"
 #include "imgui.h"
 #include "liblava/lava.hpp"
+#include <map>
+#include <optional>
 
 namespace FluidSimulation
 {
@@ -27,6 +38,7 @@ class Simulation
     using s_ptr = std::shared_ptr<Simulation>;
 
     explicit Simulation(lava::engine &app);
+    Simulation(lava::engine &app, glm::uvec2 grid_size, const PrecisionPolicy &precision_policy = {});
     Simulation(const Simulation &) = delete;
     Simulation &operator=(const Simulation &) = delete;
     Simulation(Simulation &&other) = delete;
@@ -34,18 +46,53 @@ class Simulation
 
     ~Simulation();
 
+    // Records the steps the frame's time calls for into cmd_buffer, which is submitted once for all of them
     void OnUpdate(VkCommandBuffer cmd_buffer, const FrameTimeInfo &frame_context);
 
-    [[nodiscard]] PressureProjectionMethod GetPressureProjectionMethod() const
+    // Called before recording into the command buffer of submission, every submission up to completed_submission has
+    // finished executing. Recordings replaced by a settings change are freed once their last submission finished
+    void BeginSubmission(uint64_t submission, uint64_t completed_submission);
+
+    // Records one step of exactly delta_time, neither the accumulator nor the frame time clamp apply
+    void StepFixed(VkCommandBuffer cmd_buffer, double current_time, float delta_time);
+
+    [[nodiscard]] float GetFixedTimestep() const
     {
-        return pressure_projection_method_;
+        return fixed_timestep_;
     }
 
-    void SetPressureProjectionMethod(const PressureProjectionMethod &method)
+    // Advances in steps of this length, as many per frame as the accumulated time holds up to the maximum. Zero runs
+    // one step over the delta time of each frame
+    void SetFixedTimestep(float timestep)
     {
-        pressure_projection_method_ = method;
+        fixed_timestep_ = std::clamp(timestep, 0.0f, MAX_STEP_DELTA_TIME);
+        accumulated_time_ = 0.0;
     }
 
+    [[nodiscard]] uint32_t GetMaxFixedSteps() const
+    {
+        return max_fixed_steps_;
+    }
+
+    void SetMaxFixedSteps(uint32_t max_steps)
+    {
+        max_fixed_steps_ = std::clamp(max_steps, 1u, MAX_FIXED_STEPS_PER_FRAME);
+    }
+
+    // Fixed steps the last frame ran
+    [[nodiscard]] uint32_t GetFixedSteps() const
+    {
+        return fixed_steps_;
+    }
+
+    [[nodiscard]] PressureProjectionMethod GetPressureProjectionMethod() const
+    {
+        return pressure_projection_method_;
+    }
+
+    // Returns false and keeps the current method when the grid cannot use the requested one
+    bool SetPressureProjectionMethod(const PressureProjectionMethod &method);
+
     [[nodiscard]] uint32_t GetPressureJacobiIterations() const
     {
         return pressure_jacobi_iterations_;
@@ -56,6 +103,228 @@ class Simulation
         pressure_jacobi_iterations_ = iterations;
     }
 
+    [[nodiscard]] uint32_t GetJacobiSweepsPerDispatch() const
+    {
+        return jacobi_sweeps_per_dispatch_;
+    }
+
+    void SetJacobiSweepsPerDispatch(uint32_t sweeps_per_dispatch)
+    {
+        jacobi_sweeps_per_dispatch_ = sweeps_per_dispatch;
+    }
+
+    [[nodiscard]] AdvectionScheme GetAdvectionScheme() const
+    {
+        return advection_scheme_;
+    }
+
+    // Applies to both the velocity and the dye advection
+    void SetAdvectionScheme(AdvectionScheme scheme)
+    {
+        advection_scheme_ = scheme;
+    }
+
+    [[nodiscard]] BacktraceVariant GetBacktrace() const
+    {
+        return backtrace_;
+    }
+
+    // Integrator and substeps tracing particles back for the velocity and the dye advection
+    void SetBacktrace(const BacktraceVariant &backtrace)
+    {
+        backtrace_ = backtrace;
+    }
+
+    [[nodiscard]] bool GetAdaptiveTimestep() const
+    {
+        return adaptive_timestep_;
+    }
+
+    // Splits each frame into steps and backtrace substeps that keep the CFL number at the target, the backtrace
+    // substeps then act as an upper bound
+    void SetAdaptiveTimestep(bool enabled)
+    {
+        adaptive_timestep_ = enabled;
+    }
+
+    [[nodiscard]] float GetTargetCFL() const
+    {
+        return target_cfl_;
+    }
+
+    void SetTargetCFL(float target_cfl)
+    {
+        target_cfl_ = target_cfl;
+    }
+
+    [[nodiscard]] uint32_t GetMaxSubsteps() const
+    {
+        return max_substeps_;
+    }
+
+    void SetMaxSubsteps(uint32_t max_substeps)
+    {
+        max_substeps_ = std::clamp(max_substeps, 1u, MAX_CFL_SUBSTEPS);
+    }
+
+    // Latest max |u| read back from the device and the steps the last frame was split into
+    [[nodiscard]] float GetMaxVelocity() const
+    {
+        return max_velocity_;
+    }
+
+    [[nodiscard]] uint32_t GetSubsteps() const
+    {
+        return substeps_;
+    }
+
+    [[nodiscard]] bool GetChebyshevAcceleration() const
+    {
+        return chebyshev_acceleration_;
+    }
+
+    // Jacobi solver and multigrid Jacobi smoother run as Chebyshev semi-iterations
+    void SetChebyshevAcceleration(bool enabled)
+    {
+        chebyshev_acceleration_ = enabled;
+    }
+
+    [[nodiscard]] bool GetTileClassification() const
+    {
+        return tile_classification_;
+    }
+
+    // Divergence, single sweep Jacobi and velocity update run a branch-free kernel on the tiles clear of walls and
+    // obstacles and the full kernel on the rest
+    void SetTileClassification(bool enabled)
+    {
+        tile_classification_ = enabled;
+    }
+
+    [[nodiscard]] bool GetSparseSimulation() const
+    {
+        return sparse_simulation_;
+    }
+
+    // Advection, divergence, velocity update and color update only run on the tiles where the flow or the dye moves,
+    // the flow elsewhere is brought to rest
+    void SetSparseSimulation(bool enabled)
+    {
+        sparse_simulation_ = enabled;
+    }
+
+    [[nodiscard]] float GetRelaxationOmega() const
+    {
+        return relaxation_omega_;
+    }
+
+    void SetRelaxationOmega(float omega)
+    {
+        relaxation_omega_ = omega;
+    }
+
+    [[nodiscard]] PoissonFilterVariant GetPoissonFilter() const
+    {
+        return poisson_filter_;
+    }
+
+    void SetPoissonFilter(const PoissonFilterVariant &filter)
+    {
+        poisson_filter_ = filter;
+    }
+
+    [[nodiscard]] PoissonFilterVariant GetMultigridPoissonFilter() const
+    {
+        return multigrid_poisson_filter_;
+    }
+
+    void SetMultigridPoissonFilter(const PoissonFilterVariant &filter)
+    {
+        multigrid_poisson_filter_ = filter;
+    }
+
+    [[nodiscard]] float GetPressureTolerance() const
+    {
+        return pressure_tolerance_;
+    }
+
+    // Relative residual at which the pressure solvers stop early, zero always runs the full iteration count
+    void SetPressureTolerance(float tolerance)
+    {
+        pressure_tolerance_ = tolerance;
+    }
+
+    [[nodiscard]] MultigridCycleType GetMultigridCycleType() const
+    {
+        return multigrid_cycle_type_;
+    }
+
+    void SetMultigridCycleType(MultigridCycleType type)
+    {
+        multigrid_cycle_type_ = type;
+    }
+
+    [[nodiscard]] uint32_t GetMultigridCycles() const
+    {
+        return vcycle_iterations_;
+    }
+
+    void SetMultigridCycles(uint32_t cycles)
+    {
+        vcycle_iterations_ = cycles;
+    }
+
+    [[nodiscard]] bool GetMultigridBottomSolver() const
+    {
+        return multigrid_bottom_solver_;
+    }
+
+    void SetMultigridBottomSolver(bool enabled)
+    {
+        multigrid_bottom_solver_ = enabled;
+    }
+
+    [[nodiscard]] uint32_t GetConjugateGradientIterations() const
+    {
+        return conjugate_gradient_iterations_;
+    }
+
+    void SetConjugateGradientIterations(uint32_t iterations)
+    {
+        conjugate_gradient_iterations_ = iterations;
+    }
+
+    [[nodiscard]] bool GetStepReplay() const
+    {
+        return step_replay_;
+    }
+
+    // Records the steps of a frame once into a secondary command buffer per timestep plan and replays it while the
+    // settings stay the same, only the time is written each frame. Frames after a reset, new obstacles or a settings
+    // change are recorded directly
+    void SetStepReplay(bool enabled)
+    {
+        step_replay_ = enabled;
+    }
+
+    [[nodiscard]] glm::uvec2 GetGridSize() const
+    {
+        return grid_size_;
+    }
+
+    // Fixed at construction, the field textures are created with these formats
+    [[nodiscard]] const PrecisionPolicy &GetPrecisionPolicy() const
+    {
+        return precision_policy_;
+    }
+
+    // Presets fp16, fp32 and mixed (fp32 pressure and divergence with fp16 multigrid corrections)
+    static PrecisionPolicy ParsePrecisionPolicy(const std::string &name);
+    static FieldPrecision ParseFieldPrecision(const std::string &name);
+
+    // Format-less storage image access lets one shader serve every precision policy, called before device creation
+    static bool EnableDeviceFeatures(lava::device::create_param &param);
+
     void Reset()
     {
         reset_flag_ = true;
@@ -66,6 +335,11 @@ class Simulation
         return std::make_shared<Simulation>(app);
     }
 
+    static s_ptr Make(lava::engine &app, glm::uvec2 grid_size, const PrecisionPolicy &precision_policy = {})
+    {
+        return std::make_shared<Simulation>(app, grid_size, precision_policy);
+    }
+
     friend class FluidRenderer;
 
   private:
@@ -76,35 +350,142 @@ class Simulation
     void CreateDescriptorPool();
     void CreateComputePasses();
 
+    SimulationConstants GetSimulationConstants() const;
+
+    // One simulation step starting at current_time, split into several when the CFL condition asks for it
+    void Advance(VkCommandBuffer cmd_buffer, double current_time, float delta_time);
+
+    // One full advection, projection and dye update over the step length of the frame
+    void Step(VkCommandBuffer cmd_buffer, const SimulationConstants &constants, const BacktraceVariant &backtrace);
+
+    // Every step of the frame, recorded directly or replayed
+    void RecordSteps(VkCommandBuffer cmd_buffer, SimulationConstants constants, const TimestepPlan &plan);
+    void ReplaySteps(VkCommandBuffer cmd_buffer, const SimulationConstants &constants, const TimestepPlan &plan);
+
+    void UpdateStepTime(VkCommandBuffer cmd_buffer, const StepTimeConstants &step_time);
+
+    // Everything Step records besides the time, recorded steps are dropped once it changes
+    struct StepSettings
+    {
+        PressureProjectionMethod pressure_projection_method;
+        AdvectionScheme advection_scheme;
+        BacktraceIntegrator backtrace_integrator; // The substeps are part of the recording's key
+        uint32_t pressure_jacobi_iterations;
+        uint32_t jacobi_sweeps_per_dispatch;
+        bool chebyshev_acceleration;
+        bool tile_classification;
+        bool sparse_simulation;
+        uint32_t vcycle_iterations;
+        MultigridCycleType multigrid_cycle_type;
+        bool multigrid_bottom_solver;
+        float relaxation_omega;
+        uint32_t conjugate_gradient_iterations;
+        float pressure_tolerance;
+        PoissonFilterVariant poisson_filter;
+        PoissonFilterVariant multigrid_poisson_filter;
+
+        auto operator<=>(const StepSettings &) const = default;
+    };
+
+    [[nodiscard]] StepSettings GetStepSettings() const;
+
+    // Layout, access and stage of the last barrier of a texture
+    struct TextureState
+    {
+        lava::image::s_ptr image;
+        VkImageLayout layout;
+        VkAccessFlags access;
+        VkPipelineStageFlags stage;
+    };
+
+    // A recording ends with every texture back in the state it started from, so it can follow itself
+    struct RecordedSteps
+    {
+        VkCommandBuffer cmd_buffer = VK_NULL_HANDLE;
+        std::vector<TextureState> texture_states;
+    };
+
+    // Barriers moving every texture that left its recorded state back into it
+    static void RestoreTextureStates(VkCommandBuffer cmd_buffer, const std::vector<TextureState> &texture_states);
+
+    RecordedSteps RecordReplayableSteps(const SimulationConstants &constants, const TimestepPlan &plan);
+
+    // Submissions in flight may still replay the recordings, they are freed by BeginSubmission
+    void RetireRecordedSteps();
+
     lava::engine &app_;
 
+    // Simulation grid resolution, decoupled from the window so headless runs can pick any size
+    glm::uvec2 grid_size_;
+
+    PrecisionPolicy precision_policy_;
+
     lava::descriptor::pool::s_ptr descriptor_pool_;
 
     bool reset_flag_ = true;
-    bool calculate_residual_error_ = false;
     bool upload_obstacle_mask_ = false;
 
-    const uint32_t PRESSURE_CONVERGENCE_CHECK_FRAME = 1000;
-    uint32_t frame_count_ = 0;
-    std::vector<float> residual_host_data_;
+    const uint32_t PRESSURE_CONVERGENCE_CHECK_INTERVAL = 8;
+
+    PressureProjectionMethod pressure_projection_method_ = DEFAULT_PRESSURE_PROJECTION_METHOD;
+    AdvectionScheme advection_scheme_ = DEFAULT_ADVECTION_SCHEME;
+    BacktraceVariant backtrace_{};
 
-    PressureProjectionMethod pressure_projection_method_ = PressureProjectionMethod::Jacobi;
+    float fixed_timestep_ = DEFAULT_FIXED_TIMESTEP;
+    uint32_t max_fixed_steps_ = 4;
+    uint32_t fixed_steps_ = 0;
+    double accumulated_time_ = 0.0; // Frame time not yet simulated, less than one fixed step
+    double simulation_time_ = 0.0;
 
-    uint32_t pressure_jacobi_iterations_ = 32;
+    bool adaptive_timestep_ = DEFAULT_ADAPTIVE_TIMESTEP;
+    float target_cfl_ = DEFAULT_TARGET_CFL;
+    uint32_t max_substeps_ = DEFAULT_MAX_SUBSTEPS;
+    float max_velocity_ = 0.0f;
+    uint32_t substeps_ = 1;
+
+    uint32_t pressure_jacobi_iterations_ = DEFAULT_PRESSURE_JACOBI_ITERATIONS;
+    uint32_t jacobi_sweeps_per_dispatch_ = DEFAULT_JACOBI_SWEEPS_PER_DISPATCH;
+    bool chebyshev_acceleration_ = DEFAULT_CHEBYSHEV_ACCELERATION;
+    bool tile_classification_ = DEFAULT_TILE_CLASSIFICATION;
+    bool sparse_simulation_ = DEFAULT_SPARSE_SIMULATION;
     uint32_t multigrid_levels_ = 8;
     uint32_t relaxation_iterations_ = 2;
-    uint32_t vcycle_iterations_ = 3;
+    uint32_t vcycle_iterations_ = DEFAULT_MULTIGRID_CYCLES;
+    MultigridCycleType multigrid_cycle_type_ = DEFAULT_MULTIGRID_CYCLE_TYPE;
+    bool multigrid_bottom_solver_ = DEFAULT_MULTIGRID_BOTTOM_SOLVER;
+    float relaxation_omega_ = DEFAULT_RELAXATION_OMEGA;
+    uint32_t conjugate_gradient_iterations_ = DEFAULT_CONJUGATE_GRADIENT_ITERATIONS;
+    float pressure_tolerance_ = DEFAULT_PRESSURE_TOLERANCE;
+    PoissonFilterVariant poisson_filter_ = DEFAULT_POISSON_FILTER;
+    PoissonFilterVariant multigrid_poisson_filter_ = DEFAULT_MULTIGRID_POISSON_FILTER;
+
+    bool step_replay_ = DEFAULT_STEP_REPLAY;
+    std::optional<StepSettings> last_step_settings_; // Settings of the previous frame
+    StepSettings recorded_step_settings_{};
+    VkCommandPool recorded_step_pool_ = VK_NULL_HANDLE;
+    std::map<std::pair<uint32_t, int32_t>, RecordedSteps> recorded_steps_; // By steps and backtrace substeps
+    std::vector<std::pair<VkCommandBuffer, uint64_t>> retired_steps_;      // With the last submission replaying them
+    uint64_t submission_ = 0;
 
     ObstacleFillingPass::s_ptr obstacle_filling_pass_;
+    ObstaclePyramidPass::s_ptr obstacle_pyramid_pass_;
+    ObstacleDistancePass::s_ptr obstacle_distance_pass_;
+    BoundaryMapPass::s_ptr boundary_map_pass_;
+    TileClassificationPass::s_ptr tile_classification_pass_;
+    ActiveTilePass::s_ptr active_tile_pass_;
     VelocityAdvectionPass::s_ptr velocity_advect_pass_;
     DivergenceCalculationPass::s_ptr divergence_calculation_pass_;
+    ConvergenceControlPass::s_ptr convergence_control_pass_;
     JacobiPressurePass::s_ptr jacobi_pressure_projection_pass_;
     PoissonPressurePass::s_ptr poisson_pressure_projection_pass_;
     VCyclePressurePass::s_ptr v_cycle_pressure_projection_pass_;
+    MixedPrecisionRefinementPass::s_ptr mixed_precision_refinement_pass_;
+    ConjugateGradientPressurePass::s_ptr conjugate_gradient_pressure_projection_pass_;
+    SpectralPressurePass::s_ptr spectral_pressure_projection_pass_;
     VelocityUpdatePass::s_ptr velocity_update_pass_;
     ColorAdvectPass::s_ptr color_advect_pass_;
     ColorUpdatePass::s_ptr color_update_pass_;
-    ResidualCalculationPass::s_ptr residual_calculation_pass_;
+    MaxVelocityPass::s_ptr max_velocity_pass_;
 };
 } // namespace FluidSimulation
 
@@ -0,0 +1,65 @@
+#pragma once
+#ifndef SPECTRAL_PRESSURE_PASS_HPP
+#define SPECTRAL_PRESSURE_PASS_HPP
+
+#include "ComputePass.hpp"
+#include "ResourceManager.hpp"
+#include <liblava/lava.hpp>
+
+namespace FluidSimulation
+{
+
+enum class SpectralBoundary
+{
+    Neumann, // Closed walls, solved with a discrete cosine transform
+    Periodic // Wrapping domain, solved with a complex FFT
+};
+
+// Exact pressure solve by diagonalising the five point Laplacian, interior obstacles are ignored
+class SpectralPressurePass : public ComputePass
+{
+  public:
+    using s_ptr = std::shared_ptr<SpectralPressurePass>;
+
+    SpectralPressurePass(lava::engine &app, lava::descriptor::pool::s_ptr pool);
+    ~SpectralPressurePass() override;
+
+    void CreateDescriptorSets() override;
+    void UpdateDescriptorSets() override;
+    void CreatePipeline() override;
+    void Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants) override;
+
+    void SetBoundary(SpectralBoundary boundary)
+    {
+        boundary_ = boundary;
+    }
+    SpectralBoundary GetBoundary() const
+    {
+        return boundary_;
+    }
+
+    // Every line is transformed in shared memory, so both sides must factor into 2, 3 and 5 and fit MAX_LINE_LENGTH
+    static bool IsSupportedGridSize(glm::uvec2 grid_size);
+
+    static s_ptr Make(lava::engine &app, lava::descriptor::pool::s_ptr pool)
+    {
+        return std::make_shared<SpectralPressurePass>(app, pool);
+    }
+
+    static constexpr uint32_t MAX_LINE_LENGTH = 2048;
+
+  private:
+    lava::descriptor::s_ptr descriptor_set_layout_;
+    VkDescriptorSet descriptor_set_{};
+
+    lava::texture::s_ptr divergence_field_;
+    lava::texture::s_ptr pressure_field_;
+    lava::texture::s_ptr spectral_field_A_;
+    lava::texture::s_ptr spectral_field_B_;
+
+    SpectralBoundary boundary_ = SpectralBoundary::Neumann;
+};
+
+} // namespace FluidSimulation
+
+#endif // SPECTRAL_PRESSURE_PASS_HPP
@@ -0,0 +1,57 @@
+#pragma once
+#ifndef TILE_CLASSIFICATION_PASS_HPP
+#define TILE_CLASSIFICATION_PASS_HPP
+
+#include "ComputePass.hpp"
+#include "ResourceManager.hpp"
+#include <liblava/lava.hpp>
+
+namespace FluidSimulation
+{
+
+// Sorts the 16x16 tiles of the grid into an interior list, clear of walls and obstacles, and a boundary list with
+// indirect dispatch arguments for each (tile_classification), so kernels run a branch-free variant on most of the
+// grid. Rebuilt only after the mask changed
+class TileClassificationPass : public ComputePass
+{
+  public:
+    using s_ptr = std::shared_ptr<TileClassificationPass>;
+
+    TileClassificationPass(lava::engine &app, lava::descriptor::pool::s_ptr pool);
+    ~TileClassificationPass() override;
+
+    void CreateDescriptorSets() override;
+    void UpdateDescriptorSets() override;
+    void CreatePipeline() override;
+    void Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants) override;
+
+    // One workgroup per tile of the list, tile_class must be Interior or Boundary
+    void Dispatch(VkCommandBuffer cmd_buffer, TileClass tile_class) const;
+
+    void SetNeedsUpdate(bool value)
+    {
+        needs_update_ = value;
+    }
+    bool GetNeedsUpdate() const
+    {
+        return needs_update_;
+    }
+
+    static s_ptr Make(lava::engine &app, lava::descriptor::pool::s_ptr pool)
+    {
+        return std::make_shared<TileClassificationPass>(app, pool);
+    }
+
+  private:
+    lava::descriptor::s_ptr descriptor_set_layout_;
+    VkDescriptorSet descriptor_set_{};
+
+    lava::texture::s_ptr boundary_map_;
+    lava::buffer::s_ptr tile_buffer_;
+
+    bool needs_update_ = true;
+};
+
+} // namespace FluidSimulation
+
+#endif // TILE_CLASSIFICATION_PASS_HPP
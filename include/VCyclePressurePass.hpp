@@ -3,8 +3,11 @@
 #define VCYCLE_PRESSURE_PASS_HPP
 
 #include "ComputePass.hpp"
+#include "ConvergenceControlPass.hpp"
 #include "ResourceManager.hpp"
 #include <liblava/lava.hpp>
+#include <map>
+#include <string>
 #include <vector>
 
 namespace FluidSimulation
@@ -13,7 +16,16 @@ namespace FluidSimulation
 enum class VCycleRelaxationType
 {
     Standard,
-    Poisson_Filter
+    Poisson_Filter,
+    Red_Black_Gauss_Seidel
+};
+
+// Finest level fields the cycle solves on, a cycle used as a preconditioner runs on its own pair
+struct VCycleFineLevelTextures
+{
+    std::string divergence = "divergence_field";
+    std::string pressure_A = "pressure_field_A";
+    std::string pressure_B = "pressure_field_B";
 };
 
 class VCyclePressurePass : public ComputePass
@@ -21,7 +33,8 @@ class VCyclePressurePass : public ComputePass
   public:
     using s_ptr = std::shared_ptr<VCyclePressurePass>;
 
-    VCyclePressurePass(lava::engine &app, lava::descriptor::pool::s_ptr pool, uint32_t max_levels = 5);
+    VCyclePressurePass(lava::engine &app, lava::descriptor::pool::s_ptr pool, uint32_t max_levels = 5,
+                       const VCycleFineLevelTextures &fine_level_textures = {});
     ~VCyclePressurePass() override;
 
     void CreateDescriptorSets() override;
@@ -37,38 +50,96 @@ class VCyclePressurePass : public ComputePass
     {
         max_levels_ = levels;
     }
+    // Must be even, the ping-ponged sweeps then end in texture A where every other descriptor set expects the level's
+    // pressure
     void SetRelaxationIterations(uint32_t iterations)
     {
+        if (iterations % 2 != 0)
+        {
+            lava::logger()->error("Multigrid relaxation needs an even sweep count, got {}", iterations);
+            throw std::invalid_argument("Multigrid relaxation needs an even sweep count");
+        }
         relaxation_iterations_ = iterations;
     }
     void SetVCycleIterations(uint32_t iterations)
     {
         vcycle_iterations_ = iterations;
     }
+    void SetCycleType(MultigridCycleType type)
+    {
+        cycle_type_ = type;
+    }
+    void SetRelaxationOmega(float omega)
+    {
+        relaxation_omega_ = omega;
+    }
+    // The Jacobi smoother runs as a Chebyshev semi-iteration over the upper part of each level's spectrum
+    void SetChebyshevSmoothing(bool enabled)
+    {
+        chebyshev_smoothing_ = enabled;
+    }
+    // Dispatches go through the control buffer, with check_between_cycles the residual is tested after every cycle
+    void SetConvergenceControl(ConvergenceControlPass::s_ptr convergence_control, bool check_between_cycles)
+    {
+        convergence_control_ = convergence_control;
+        check_between_cycles_ = check_between_cycles;
+    }
+    // Filter used by the Poisson smoother on the finest level, coarser levels clamp the order to their size
+    void SetPoissonFilter(const PoissonFilterVariant &filter);
+    [[nodiscard]] PoissonFilterVariant GetPoissonFilter() const
+    {
+        return poisson_filter_;
+    }
+    // Solves the first level fitting in shared memory directly and skips the levels below it
+    void SetBottomSolver(bool enabled);
+    [[nodiscard]] uint32_t GetCoarsestLevel() const
+    {
+        return coarsest_level_;
+    }
+    // Start from zero instead of the previous solution, required when the cycle approximates an inverse
+    void SetZeroInitialGuess(bool zero_initial_guess)
+    {
+        zero_initial_guess_ = zero_initial_guess;
+    }
 
-    static s_ptr Make(lava::engine &app, lava::descriptor::pool::s_ptr pool, uint32_t max_levels = 5)
+    static s_ptr Make(lava::engine &app, lava::descriptor::pool::s_ptr pool, uint32_t max_levels = 5,
+                      const VCycleFineLevelTextures &fine_level_textures = {})
     {
-        return std::make_shared<VCyclePressurePass>(app, pool, max_levels);
+        return std::make_shared<VCyclePressurePass>(app, pool, max_levels, fine_level_textures);
     }
 
   private:
-    void CreateBasePipeline(lava::compute_pipeline::s_ptr &pipeline, const char *shader_name,
-                            lava::descriptor::s_ptr descriptor_set_layout,
-                            lava::pipeline_layout::s_ptr &existing_pipeline_layout, size_t push_constant_size = 0);
     void CreateRelaxationPipeline();
+    void CreateChebyshevRelaxationPipeline();
     void CreateResidualPipeline();
     void CreateRestrictionPipeline();
     void CreateProlongationPipeline();
     void CreatePoissonRelaxationPipeline();
+    void CreateRedBlackRelaxationPipeline();
+    void CreateBottomSolvePipeline();
+    lava::compute_pipeline::s_ptr GetPoissonRelaxationPipeline(uint32_t level);
+
+    void PerformCycle(VkCommandBuffer cmd_buffer, const SimulationConstants &constants, uint32_t level,
+                      uint32_t coarse_visits);
+    void PerformFCycle(VkCommandBuffer cmd_buffer, const SimulationConstants &constants, uint32_t level);
+    void PerformFullMultigrid(VkCommandBuffer cmd_buffer, const SimulationConstants &constants);
 
+    void PerformSmoothing(VkCommandBuffer cmd_buffer, const SimulationConstants &constants, uint32_t level);
     void PerformRelaxation(VkCommandBuffer cmd_buffer, const SimulationConstants &constants, uint32_t level);
     void PerformPoissonFilterRelaxation(VkCommandBuffer cmd_buffer, const SimulationConstants &constants,
                                         uint32_t level);
+    void PerformRedBlackRelaxation(VkCommandBuffer cmd_buffer, const SimulationConstants &constants, uint32_t level);
+    void PerformCoarsestSolve(VkCommandBuffer cmd_buffer, const SimulationConstants &constants);
+    void PerformBottomSolve(VkCommandBuffer cmd_buffer, const SimulationConstants &constants, uint32_t level);
+    void ClearPressure(VkCommandBuffer cmd_buffer, uint32_t level);
     void CalculateResidual(VkCommandBuffer cmd_buffer, const MultigridConstants &constants, uint32_t level);
     void PerformRestriction(VkCommandBuffer cmd_buffer, const MultigridConstants &constants, uint32_t level);
     void PerformProlongation(VkCommandBuffer cmd_buffer, const MultigridConstants &constants, uint32_t level);
 
+    void DispatchLevel(VkCommandBuffer cmd_buffer, uint32_t level, uint32_t width, uint32_t height);
+
     MultigridConstants CalculateMultigridConstants(uint32_t level) const;
+    SimulationConstants CalculateLevelConstants(const SimulationConstants &constants, uint32_t level) const;
 
     // Relaxation resources
     lava::descriptor::s_ptr relaxation_descriptor_set_layout_;
@@ -77,11 +148,25 @@ class VCyclePressurePass : public ComputePass
     lava::pipeline_layout::s_ptr relaxation_pipeline_layout_;
     lava::compute_pipeline::s_ptr relaxation_pipeline_;
 
+    // Chebyshev relaxation resources, shares the relaxation descriptor sets
+    lava::pipeline_layout::s_ptr chebyshev_relaxation_pipeline_layout_;
+    lava::compute_pipeline::s_ptr chebyshev_relaxation_pipeline_;
+
     // Poisson relaxation resources
     lava::descriptor::s_ptr poisson_relaxation_descriptor_set_layout_;
     std::vector<VkDescriptorSet> poisson_relaxation_descriptor_sets_;
     lava::pipeline_layout::s_ptr poisson_relaxation_pipeline_layout_;
-    lava::compute_pipeline::s_ptr poisson_relaxation_pipeline_;
+    std::map<PoissonFilterVariant, lava::compute_pipeline::s_ptr> poisson_relaxation_pipelines_;
+
+    // Red-black Gauss-Seidel relaxation resources
+    lava::descriptor::s_ptr red_black_relaxation_descriptor_set_layout_;
+    std::vector<VkDescriptorSet> red_black_relaxation_descriptor_sets_;
+    lava::pipeline_layout::s_ptr red_black_relaxation_pipeline_layout_;
+    lava::compute_pipeline::s_ptr red_black_relaxation_pipeline_;
+
+    // Bottom solver resources, shares the red-black descriptor sets
+    lava::pipeline_layout::s_ptr bottom_solve_pipeline_layout_;
+    lava::compute_pipeline::s_ptr bottom_solve_pipeline_;
 
     // Residual calculation resources
     lava::descriptor::s_ptr residual_descriptor_set_layout_;
@@ -103,15 +188,26 @@ class VCyclePressurePass : public ComputePass
 
     std::vector<lava::texture::s_ptr> pressure_multigrid_texture_A_;
     std::vector<lava::texture::s_ptr> pressure_multigrid_texture_B_;
-    std::vector<lava::texture::s_ptr> multigrid_temp_textures_;
-    std::vector<lava::texture::s_ptr> multigrid_temp_textures1_;
     std::vector<lava::texture::s_ptr> divergence_fields_;
-    lava::texture::s_ptr obstacle_mask_;
+    // Level 0 is the obstacle mask, coarser levels hold the solid fractions built by ObstaclePyramidPass
+    std::vector<lava::texture::s_ptr> obstacle_masks_;
+    // Per-level pressure boundary conditions built by BoundaryMapPass
+    std::vector<lava::texture::s_ptr> boundary_maps_;
+
+    ConvergenceControlPass::s_ptr convergence_control_;
+    bool check_between_cycles_ = false;
 
     VCycleRelaxationType relaxation_type_ = VCycleRelaxationType::Standard;
+    MultigridCycleType cycle_type_ = MultigridCycleType::V_Cycle;
     uint32_t max_levels_ = 8;
+    uint32_t coarsest_level_ = 7;
+    bool bottom_solver_ = false;
     uint32_t relaxation_iterations_ = 2;
     uint32_t vcycle_iterations_ = 3;
+    float relaxation_omega_ = 1.0f;
+    bool chebyshev_smoothing_ = false;
+    PoissonFilterVariant poisson_filter_ = DEFAULT_MULTIGRID_POISSON_FILTER;
+    bool zero_initial_guess_ = false;
 };
 
 } // namespace FluidSimulation
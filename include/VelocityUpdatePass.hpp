@@ -2,6 +2,7 @@
 #ifndef VELOCITY_UPDATE_PASS_HPP
 #define VELOCITY_UPDATE_PASS_HPP
 
+#include "ActiveTilePass.hpp"
 #include "ComputePass.hpp"
 #include "ResourceManager.hpp"
 #include <liblava/lava.hpp>
@@ -21,6 +22,12 @@ class VelocityUpdatePass : public ComputePass
     void CreatePipeline() override;
     void Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants) override;
 
+    // Splits the dispatch into the interior and the boundary list of the active tiles, null dispatches the whole grid
+    void SetTileLists(ActiveTilePass::s_ptr tile_lists)
+    {
+        tile_lists_ = tile_lists;
+    }
+
     static s_ptr Make(lava::engine &app, lava::descriptor::pool::s_ptr pool)
     {
         return std::make_shared<VelocityUpdatePass>(app, pool);
@@ -33,7 +40,12 @@ class VelocityUpdatePass : public ComputePass
     lava::texture::s_ptr pressure_field_;
     lava::texture::s_ptr advected_velocity_field_;
     lava::texture::s_ptr velocity_field_;
-    lava::texture::s_ptr obstacle_mask_;
+    lava::texture::s_ptr obstacle_distance_;
+    lava::buffer::s_ptr tile_buffer_;
+
+    ActiveTilePass::s_ptr tile_lists_;
+    lava::compute_pipeline::s_ptr interior_pipeline_;
+    lava::compute_pipeline::s_ptr boundary_pipeline_;
 };
 
 } // namespace FluidSimulation
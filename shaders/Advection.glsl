@@ -0,0 +1,95 @@
+// Shared by the advection kernels, expects velocity_texture, push_constants and Commons.glsl to be declared first
+
+// Matches BacktraceVariant, constant_id 0 is left to the including kernel and 3 to the tile class of the tile lists
+layout(constant_id = 1) const int BACKTRACE_INTEGRATOR = 0;
+layout(constant_id = 2) const int BACKTRACE_SUBSTEPS = 10;
+
+const int INTEGRATOR_EULER = 0;
+const int INTEGRATOR_RK2 = 1;
+const int INTEGRATOR_RK3 = 2;
+
+#include "Inflow.glsl"
+
+vec2 SampleVelocity(vec2 uv)
+{
+    vec2 velocity = texture(velocity_texture, uv).rg;
+    vec2 wrap = vec2(1.0);
+
+    if (uv.x < 0.0 || uv.x > 1.0) wrap.x = -1.0;
+    if (uv.y < 0.0 || uv.y > 1.0) wrap.y = -1.0;
+
+    return wrap * velocity;
+}
+
+vec2 ComputeVorticityForce(vec2 texel_uv, vec2 uv_scale, vec2 current_velocity, float grid_spacing)
+{
+    // Sample velocities for vorticity computation
+    vec2 velocity_ld = SampleVelocity(texel_uv - uv_scale);
+    vec2 velocity_rd = SampleVelocity(texel_uv + vec2(uv_scale.x, -uv_scale.y));
+    vec2 velocity_ru = SampleVelocity(texel_uv + uv_scale);
+    vec2 velocity_lu = SampleVelocity(texel_uv + vec2(-uv_scale.x, uv_scale.y));
+    vec2 velocity_ll = SampleVelocity(texel_uv + vec2(-2.0 * uv_scale.x, 0.0));
+    vec2 velocity_rr = SampleVelocity(texel_uv + vec2(2.0 * uv_scale.x, 0.0));
+    vec2 velocity_dd = SampleVelocity(texel_uv + vec2(0.0, -2.0 * uv_scale.y));
+    vec2 velocity_uu = SampleVelocity(texel_uv + vec2(0.0, 2.0 * uv_scale.y));
+
+    // Calculate curl at each direction
+    float curl_left = velocity_lu.x - velocity_ld.x + velocity_ll.y - current_velocity.y;
+    float curl_right = velocity_ru.x - velocity_rd.x + current_velocity.y - velocity_rr.y;
+    float curl_down = current_velocity.x - velocity_dd.x + velocity_ld.y - velocity_rd.y;
+    float curl_up = velocity_uu.x - current_velocity.x + velocity_lu.y - velocity_ru.y;
+
+    vec2 vorticity_force = vec2(curl_down - curl_up, curl_right - curl_left);
+    float vorticity_magnitude = length(vorticity_force);
+
+    if (vorticity_magnitude > 1e-6)
+    {
+        vorticity_force *= grid_spacing * push_constants.vorticity_strength / vorticity_magnitude;
+    }
+    else
+    {
+        vorticity_force = vec2(0.0);
+    }
+
+    return vorticity_force;
+}
+
+// Follows the velocity field for delta_time, a negative time traces backwards. The particle stops in front of an
+// obstacle, traced_velocity is the velocity at the end of the path
+vec2 TraceParticle(vec2 uv, float delta_time, out vec2 traced_velocity)
+{
+    vec2 uv_scale = vec2(1.0) / vec2(push_constants.texture_width, push_constants.texture_height);
+    vec2 velocity_to_uv = uv_scale / max(uv_scale.x, uv_scale.y);
+    float step_time = delta_time / float(BACKTRACE_SUBSTEPS);
+
+    vec2 traced_uv = uv;
+    traced_velocity = SampleVelocity(uv);
+
+    for (int i = 0; i < BACKTRACE_SUBSTEPS; i++)
+    {
+        // The velocity at the start of a substep is the one sampled at the end of the previous substep
+        vec2 step_velocity = traced_velocity;
+        if (BACKTRACE_INTEGRATOR == INTEGRATOR_RK2)
+        {
+            step_velocity = SampleVelocity(traced_uv + 0.5 * step_time * velocity_to_uv * traced_velocity);
+        }
+        else if (BACKTRACE_INTEGRATOR == INTEGRATOR_RK3)
+        {
+            // Ralston's third order method
+            vec2 midpoint_velocity = SampleVelocity(traced_uv + 0.5 * step_time * velocity_to_uv * traced_velocity);
+            vec2 late_velocity = SampleVelocity(traced_uv + 0.75 * step_time * velocity_to_uv * midpoint_velocity);
+            step_velocity = (2.0 * traced_velocity + 3.0 * midpoint_velocity + 4.0 * late_velocity) / 9.0;
+        }
+
+        vec2 next_uv = traced_uv + step_time * velocity_to_uv * step_velocity;
+        if (IsObstacle(next_uv))
+        {
+            break;
+        }
+
+        traced_uv = next_uv;
+        traced_velocity = SampleVelocity(traced_uv);
+    }
+
+    return traced_uv;
+}
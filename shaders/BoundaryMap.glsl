@@ -0,0 +1,32 @@
+// Per-cell boundary conditions of the pressure stencils, built by BoundaryMap.comp whenever the obstacles change.
+// Every slot holds the offset from the cell to the cell a read resolves to, after walls mirror and solids reflect
+// along their normal. Offsets stay within [-3, 3] and take 3 bits per axis, biased by 4.
+const int BOUNDARY_SELF = 0;
+const int BOUNDARY_RIGHT = 1;
+const int BOUNDARY_LEFT = 2;
+const int BOUNDARY_UP = 3;
+const int BOUNDARY_DOWN = 4;
+
+const uint BOUNDARY_SOLID_BIT = 1u << 30;
+
+// Fluid cell whose stencil reads its four neighbours unchanged, the biased offsets of every slot packed by hand
+const uint BOUNDARY_INTERIOR = 36u | (37u << 6) | (35u << 12) | (44u << 18) | (28u << 24);
+
+const ivec2 BOUNDARY_NEIGHBOURS[4] = ivec2[](ivec2(1, 0), ivec2(-1, 0), ivec2(0, 1), ivec2(0, -1));
+
+uint PackBoundaryOffset(ivec2 offset, int slot)
+{
+    uvec2 biased = uvec2(clamp(offset, ivec2(-4), ivec2(3)) + 4);
+    return (biased.x | (biased.y << 3)) << (6 * slot);
+}
+
+ivec2 BoundaryOffset(uint boundary, int slot)
+{
+    uint bits = boundary >> (6 * slot);
+    return ivec2(int(bits & 7u), int((bits >> 3) & 7u)) - 4;
+}
+
+bool IsSolidBoundary(uint boundary)
+{
+    return (boundary & BOUNDARY_SOLID_BIT) != 0u;
+}
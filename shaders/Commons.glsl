@@ -1,3 +1,25 @@
+#ifdef OBSTACLE_DISTANCE_FIELD
+// Shaders defining OBSTACLE_DISTANCE_FIELD bind the jump flooded obstacle_distance_texture instead of the mask, it
+// holds the signed distance to the obstacle surface in cells (negative inside) and the normal into the obstacle
+
+float ObstacleDistance(vec2 uv)
+{
+    return texture(obstacle_distance_texture, clamp(uv, 0.0, 1.0)).r;
+}
+
+bool IsObstacle(vec2 uv)
+{
+    return ObstacleDistance(uv) < 0.0;
+}
+
+vec2 CalculateNormal(vec2 uv)
+{
+    vec2 normal = texture(obstacle_distance_texture, clamp(uv, 0.0, 1.0)).gb;
+    float normal_length = length(normal);
+
+    return normal_length > 0.0 ? normal / normal_length : vec2(0.0);
+}
+#else
 bool IsObstacle(vec2 uv)
 {
     vec2 clamped_uv = clamp(uv, 0.0, 1.0);
@@ -15,6 +37,7 @@ vec2 CalculateNormal(vec2 uv)
 
     return normalize(vec2(dx, dy));
 }
+#endif
 
 vec2 ApplySlipperyBoundary(vec2 uv, vec2 velocity)
 {
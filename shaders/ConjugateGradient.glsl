@@ -0,0 +1,52 @@
+// Shared by the conjugate gradient kernels, every kernel binds the same descriptor set
+layout(push_constant) uniform ConjugateGradientPushConstants
+{
+    SIMULATION_PUSH_CONSTANTS
+    int iteration;
+    int dot_product_mode;
+    int partial_sum_count;
+} push_constants;
+
+const int DOT_PRODUCT_RESIDUAL = 0;
+const int DOT_PRODUCT_DIRECTION = 1;
+const int DOT_PRODUCT_STALE_RESIDUAL = 2;
+
+layout(set = 0, binding = 0) uniform readonly image2D divergence_texture;
+layout(set = 0, binding = 1) uniform image2D pressure_texture;
+layout(set = 0, binding = 2, r32f) uniform image2D solution_texture;
+layout(set = 0, binding = 3, r32f) uniform image2D residual_texture;
+layout(set = 0, binding = 4, r32f) uniform image2D search_direction_texture;
+layout(set = 0, binding = 5, r32f) uniform image2D operator_result_texture;
+layout(set = 0, binding = 6) uniform image2D preconditioner_rhs_texture;
+layout(set = 0, binding = 7) uniform image2D preconditioned_residual_texture;
+layout(set = 0, binding = 8) uniform sampler2D obstacle_mask_texture;
+
+// residual_dot alternates between iterations so beta can divide the new value by the previous one,
+// stale_residual_dot pairs the new residual with the previous preconditioned residual
+layout(set = 0, binding = 9, std430) buffer ReductionBuffer
+{
+    float residual_dot[2];
+    float direction_dot;
+    float stale_residual_dot;
+    float partial_sums[];
+} reduction;
+
+#include "Commons.glsl"
+
+bool IsInsideDomain(ivec2 coords)
+{
+    return coords.x >= 0 && coords.y >= 0 && coords.x < push_constants.texture_width &&
+           coords.y < push_constants.texture_height;
+}
+
+bool IsFluidCell(ivec2 coords)
+{
+    vec2 pixel_size = vec2(1.0) / vec2(push_constants.texture_width, push_constants.texture_height);
+    return IsInsideDomain(coords) && !IsObstacle((vec2(coords) + 0.5) * pixel_size);
+}
+
+float GridSpacingSquared()
+{
+    float grid_spacing = max(1.0 / push_constants.texture_width, 1.0 / push_constants.texture_height);
+    return grid_spacing * grid_spacing;
+}
@@ -0,0 +1,36 @@
+// Shared by the residual reduction kernels, the buffer layout matches ConvergenceControlHeader
+layout(push_constant) uniform ConvergencePushConstants
+{
+    SIMULATION_PUSH_CONSTANTS
+    float tolerance;
+    int residual_source;
+    int partial_sum_count;
+} push_constants;
+
+const int MAX_CONVERGENCE_LEVELS = 16;
+
+const int RESIDUAL_FROM_PRESSURE = 0;
+const int RESIDUAL_FROM_TEXTURE = 1;
+
+struct IndirectDispatch
+{
+    uint x;
+    uint y;
+    uint z;
+    uint padding;
+};
+
+// Solvers dispatch through these arguments, zeroing them turns every remaining iteration into an empty dispatch
+layout(set = 0, binding = 4, std430) buffer ConvergenceControl
+{
+    IndirectDispatch level_dispatch[MAX_CONVERGENCE_LEVELS];
+    IndirectDispatch red_black_dispatch[MAX_CONVERGENCE_LEVELS];
+    IndirectDispatch single_group_dispatch;
+    float residual_norm;
+    float rhs_norm;
+    uint converged;
+    uint checks;
+    IndirectDispatch interior_tile_dispatch;
+    IndirectDispatch boundary_tile_dispatch;
+    vec2 partial_sums[];
+} control;
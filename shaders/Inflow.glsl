@@ -0,0 +1,5 @@
+// Band at the left wall where the advection kernels push the flow to the right
+bool IsInflow(vec2 uv)
+{
+    return uv.x <= 0.01 && uv.y > 0.45 && uv.y < 0.55;
+}
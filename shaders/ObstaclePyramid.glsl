@@ -0,0 +1,18 @@
+// Obstacle lookups on a multigrid level, level 0 reads the binary obstacle mask and coarser levels the solid
+// fractions averaged by ObstacleMaskRestriction.comp. A level treats a cell as solid once it is mostly solid.
+float SolidFraction(sampler2D mask, ivec2 coords)
+{
+    return texelFetch(mask, clamp(coords, ivec2(0), textureSize(mask, 0) - 1), 0).r;
+}
+
+bool IsSolidCell(sampler2D mask, ivec2 coords)
+{
+    return SolidFraction(mask, coords) > 0.5;
+}
+
+// Volume a cell contributes to the transfer operators, solid cells are not unknowns of the level
+float FluidWeight(sampler2D mask, ivec2 coords)
+{
+    float solid = SolidFraction(mask, coords);
+    return (solid > 0.5) ? 0.0 : 1.0 - solid;
+}
@@ -269,7 +269,7 @@ const vec4 INVERSE_Itr_5_R58_Filters[] = vec4[](
 //------------------itr = 6------------------
 const int INVERSE_Itr_6_Filter_Size = 11;
 const int INVERSE_Itr_6_Half_Filter_Size = 5;
-vec4 INVERSE_Itr_6_R14_Filters[] = vec4[](
+const vec4 INVERSE_Itr_6_R14_Filters[] = vec4[](
     // Rank 1  //Rank 2   //Rank 3   //Rank 4
     vec4(-3.18e-04, 6.06e-04, 3.69e-04, -1.31e-04),  vec4(-2.48e-03, -3.96e-03, -6.93e-03, 7.81e-03),
     vec4(-1.76e-02, -6.22e-03, 1.29e-02, 1.44e-02),  vec4(-6.63e-02, -7.40e-02, -6.33e-02, 7.69e-04),
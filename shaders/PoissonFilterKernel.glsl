@@ -0,0 +1,169 @@
+// Separable Poisson filter shared by the projection kernel and the multigrid smoother, both passes run on a tile in
+// shared memory with a halo of the filter radius. The including shader declares divergence_texture and
+// pressure_texture and boundary_map_texture and includes BoundaryMap.glsl first.
+
+// Filter order and rank count are chosen per pipeline, the order must be one PoissonFilter.glsl has coefficients for
+layout(constant_id = 0) const int FILTER_ORDER = 32;
+layout(constant_id = 1) const int FILTER_RANKS = 4;
+
+const int ranks_per_table = 4;
+const int kernel_size = 2 * FILTER_ORDER - 1;
+const int TILE_SIZE_X = 16;
+const int TILE_SIZE_Y = 16;
+const int RADIUS = FILTER_ORDER - 1;
+
+shared float shared_data[TILE_SIZE_Y + 2 * RADIUS][TILE_SIZE_X + 2 * RADIUS];
+shared float vertical_data[TILE_SIZE_Y][TILE_SIZE_X + 2 * RADIUS];
+
+float grid_spacing = max(1.0 / push_constants.texture_width, 1.0 / push_constants.texture_height);
+
+// FILTER_ORDER is constant for the pipeline, so only one case survives compilation
+vec4 FilterTapR14(int i)
+{
+    switch (FILTER_ORDER)
+    {
+    case 1: return INVERSE_Itr_1_R14_Filters[i];
+    case 2: return INVERSE_Itr_2_R14_Filters[i];
+    case 3: return INVERSE_Itr_3_R14_Filters[i];
+    case 4: return INVERSE_Itr_4_R14_Filters[i];
+    case 5: return INVERSE_Itr_5_R14_Filters[i];
+    case 6: return INVERSE_Itr_6_R14_Filters[i];
+    case 7: return INVERSE_Itr_7_R14_Filters[i];
+    case 8: return INVERSE_Itr_8_R14_Filters[i];
+    case 10: return INVERSE_Itr_10_R14_Filters[i];
+    case 16: return INVERSE_Itr_16_R14_Filters[i];
+    case 24: return INVERSE_Itr_24_R14_Filters[i];
+    default: return INVERSE_Itr_32_R14_Filters[i];
+    }
+}
+
+vec4 FilterTapR58(int i)
+{
+    switch (FILTER_ORDER)
+    {
+    case 1: return INVERSE_Itr_1_R58_Filters[i];
+    case 2: return INVERSE_Itr_2_R58_Filters[i];
+    case 3: return INVERSE_Itr_3_R58_Filters[i];
+    case 4: return INVERSE_Itr_4_R58_Filters[i];
+    case 5: return INVERSE_Itr_5_R58_Filters[i];
+    case 6: return INVERSE_Itr_6_R58_Filters[i];
+    case 7: return INVERSE_Itr_7_R58_Filters[i];
+    case 8: return INVERSE_Itr_8_R58_Filters[i];
+    case 10: return INVERSE_Itr_10_R58_Filters[i];
+    case 16: return INVERSE_Itr_16_R58_Filters[i];
+    case 24: return INVERSE_Itr_24_R58_Filters[i];
+    default: return INVERSE_Itr_32_R58_Filters[i];
+    }
+}
+
+// Function to mirror coordinates for boundary handling
+ivec2 MirrorCoords(ivec2 coords, ivec2 texture_size)
+{
+    ivec2 mirrored_coords = coords;
+
+    if (mirrored_coords.x < 0)
+        mirrored_coords.x = -mirrored_coords.x;
+    else if (mirrored_coords.x >= texture_size.x)
+        mirrored_coords.x = 2 * (texture_size.x - 1) - mirrored_coords.x;
+
+    if (mirrored_coords.y < 0)
+        mirrored_coords.y = -mirrored_coords.y;
+    else if (mirrored_coords.y >= texture_size.y)
+        mirrored_coords.y = 2 * (texture_size.y - 1) - mirrored_coords.y;
+
+    // A filter wider than the level would mirror past the opposite edge
+    mirrored_coords = clamp(mirrored_coords, ivec2(0), texture_size - 1);
+
+    // Solid cells reflect along their own normal
+    uint boundary = texelFetch(boundary_map_texture, mirrored_coords, 0).r;
+    return mirrored_coords + BoundaryOffset(boundary, BOUNDARY_SELF);
+}
+
+// Tap i of a single rank, ranks 5-8 live in the second coefficient table
+float FilterTap(int rank, int i)
+{
+    return (rank < ranks_per_table) ? FilterTapR14(i)[rank] : FilterTapR58(i)[rank - ranks_per_table];
+}
+
+void LoadToSharedMemory(ivec2 texture_size)
+{
+    int local_x = int(gl_LocalInvocationID.x);
+    int local_y = int(gl_LocalInvocationID.y);
+
+    ivec2 tile_start = ivec2(gl_WorkGroupID.xy * uvec2(TILE_SIZE_X, TILE_SIZE_Y)) - ivec2(RADIUS);
+
+    for (int y = local_y; y < TILE_SIZE_Y + 2 * RADIUS; y += TILE_SIZE_Y)
+    {
+        for (int x = local_x; x < TILE_SIZE_X + 2 * RADIUS; x += TILE_SIZE_X)
+        {
+            ivec2 load_coords = tile_start + ivec2(x, y);
+            load_coords = MirrorCoords(load_coords, texture_size);
+            float value = imageLoad(divergence_texture, load_coords).r;
+            shared_data[y][x] = value;
+        }
+    }
+
+    barrier();
+}
+
+// Vertical pass of one rank over the tile rows and the full halo width, so the horizontal pass never leaves the tile
+void VerticalPass(int rank)
+{
+    int local_x = int(gl_LocalInvocationID.x);
+    int local_y = int(gl_LocalInvocationID.y);
+
+    for (int x = local_x; x < TILE_SIZE_X + 2 * RADIUS; x += TILE_SIZE_X)
+    {
+        float weighted_sum = 0.0;
+        for (int i = 0; i < kernel_size; i++)
+        {
+            weighted_sum += shared_data[local_y + i][x] * FilterTap(rank, i);
+        }
+
+        vertical_data[local_y][x] = weighted_sum;
+    }
+
+    barrier();
+}
+
+float HorizontalPass(int rank)
+{
+    int local_x = int(gl_LocalInvocationID.x);
+    int local_y = int(gl_LocalInvocationID.y);
+
+    float weighted_sum = 0.0;
+    for (int i = 0; i < kernel_size; i++)
+    {
+        weighted_sum -= vertical_data[local_y][local_x + i] * FilterTap(rank, i);
+    }
+
+    // The next rank overwrites vertical_data
+    barrier();
+
+    return weighted_sum;
+}
+
+void main()
+{
+    ivec2 pixel_coords = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 texture_size = ivec2(push_constants.texture_width, push_constants.texture_height);
+
+    // Invocations outside the texture still take part in the tile loads and barriers
+    bool inside = pixel_coords.x < texture_size.x && pixel_coords.y < texture_size.y;
+
+    LoadToSharedMemory(texture_size);
+
+    // One rank at a time keeps the intermediate at a single float per halo column
+    float final_pressure = 0.0;
+    for (int rank = 0; rank < FILTER_RANKS; rank++)
+    {
+        VerticalPass(rank);
+        final_pressure += HorizontalPass(rank);
+    }
+
+    if (inside)
+    {
+        final_pressure *= (grid_spacing * grid_spacing);
+        imageStore(pressure_texture, pixel_coords, vec4(final_pressure, 0.0, 0.0, 1.0));
+    }
+}
@@ -1,12 +1,19 @@
+// Members shared by every simulation push constant block, shaders that need extra
+// per-dispatch values define CUSTOM_PUSH_CONSTANTS and append them after these.
+// Kernels that need the time or the step length include StepTime.glsl
+#define SIMULATION_PUSH_CONSTANTS \
+    int texture_width;            \
+    int texture_height;           \
+    int divergence_width;         \
+    int divergence_height;        \
+    float fluid_density;          \
+    float vorticity_strength;     \
+    bool reset_flag;              \
+    int substep;
+
+#ifndef CUSTOM_PUSH_CONSTANTS
 layout(push_constant) uniform SimulationPushConstants
 {
-    float current_time;
-    float delta_time;
-    int texture_width;
-    int texture_height;
-    int divergence_width;
-    int divergence_height;
-    float fluid_density;
-    float vorticity_strength;
-    bool reset_flag;
-} push_constants;
\ No newline at end of file
+    SIMULATION_PUSH_CONSTANTS
+} push_constants;
+#endif
@@ -0,0 +1,18 @@
+// Frame time and step length, written ahead of every frame so a recorded step replays with the new values.
+// The including shader defines STEP_TIME_BINDING and includes PushConstants.glsl first
+layout(set = 0, binding = STEP_TIME_BINDING) uniform StepTime
+{
+    float frame_time;
+    float delta_time;
+} step_time;
+
+float StepDeltaTime()
+{
+    return step_time.delta_time;
+}
+
+// Time at the start of the step, a frame split into several steps advances by one step length per step
+float StepCurrentTime()
+{
+    return step_time.frame_time + float(push_constants.substep) * step_time.delta_time;
+}
@@ -0,0 +1,54 @@
+// Tile lists built by TileClassification.comp whenever the obstacles change, or the active subset of them kept by
+// ActiveTiles.comp, the buffer layout matches TileClassificationHeader. The including shader defines
+// TILE_LIST_BINDING and includes PushConstants.glsl first.
+// Interior kernels skip every wall and obstacle test, boundary kernels keep them.
+// Kernels that already use constant_id 0 move the tile class by defining TILE_CLASS_CONSTANT_ID
+#ifndef TILE_CLASS_CONSTANT_ID
+#define TILE_CLASS_CONSTANT_ID 0
+#endif
+layout(constant_id = TILE_CLASS_CONSTANT_ID) const int TILE_CLASS = 0;
+
+const int TILE_CLASS_ALL = 0;
+const int TILE_CLASS_INTERIOR = 1;
+const int TILE_CLASS_BOUNDARY = 2;
+
+const int TILE_SIZE = 16;
+
+layout(set = 0, binding = TILE_LIST_BINDING, std430) readonly buffer TileClassification
+{
+    uvec4 interior_dispatch;
+    uvec4 boundary_dispatch;
+    uvec4 combined_dispatch;
+    uint tiles[];
+} tile_classification;
+
+uint TileCount()
+{
+    return uint(((push_constants.texture_width + TILE_SIZE - 1) / TILE_SIZE) *
+                ((push_constants.texture_height + TILE_SIZE - 1) / TILE_SIZE));
+}
+
+ivec2 ListedTileCellCoords(uint index)
+{
+    uint tile = tile_classification.tiles[index];
+    return ivec2(tile & 0xffffu, tile >> 16) * TILE_SIZE + ivec2(gl_LocalInvocationID.xy);
+}
+
+// Cell of this invocation, a tile list dispatch is one dimensional and looks the tile up by workgroup
+ivec2 TileCellCoords()
+{
+    if (TILE_CLASS == TILE_CLASS_ALL)
+    {
+        return ivec2(gl_GlobalInvocationID.xy);
+    }
+
+    return ListedTileCellCoords(gl_WorkGroupID.x + (TILE_CLASS == TILE_CLASS_BOUNDARY ? TileCount() : 0u));
+}
+
+// Cell of this invocation in a combined dispatch, which covers the interior list and then the boundary list
+ivec2 CombinedTileCellCoords()
+{
+    uint interior_count = tile_classification.interior_dispatch.x;
+    return ListedTileCellCoords(gl_WorkGroupID.x < interior_count ? gl_WorkGroupID.x :
+                                                                    TileCount() + gl_WorkGroupID.x - interior_count);
+}
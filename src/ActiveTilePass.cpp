@@ -0,0 +1,242 @@
+#include "ActiveTilePass.hpp"
+#include <cstddef>
+
+namespace FluidSimulation
+{
+namespace
+{
+constexpr int STAGE_MEASURE = 0;
+constexpr int STAGE_COMPACT = 1;
+} // namespace
+
+ActiveTilePass::ActiveTilePass(lava::engine &app, lava::descriptor::pool::s_ptr pool) : ComputePass(app, pool)
+{
+    auto &resource_manager = ResourceManager::GetInstance();
+
+    velocity_field_ = resource_manager.GetTexture("velocity_field");
+    advected_velocity_field_ = resource_manager.GetTexture("advected_velocity_field");
+    divergence_field_ = resource_manager.GetTexture("divergence_field");
+    color_field_ = resource_manager.GetTexture("color_field_A");
+    tile_motion_ = resource_manager.GetTexture("tile_motion");
+    tile_active_ = resource_manager.GetTexture("tile_active");
+    tile_classification_buffer_ = resource_manager.GetBuffer("tile_classification");
+    active_tile_buffer_ = resource_manager.GetBuffer("active_tiles");
+    step_time_buffer_ = resource_manager.GetBuffer("step_time");
+
+    CreateDescriptorSets();
+    CreatePipeline();
+    UpdateDescriptorSets();
+}
+
+ActiveTilePass::~ActiveTilePass()
+{
+    if (descriptor_set_layout_)
+    {
+        descriptor_set_layout_->destroy();
+    }
+}
+
+void ActiveTilePass::CreateDescriptorSets()
+{
+    descriptor_set_layout_ = lava::descriptor::make();
+    descriptor_set_layout_->add_binding(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Velocity field
+    descriptor_set_layout_->add_binding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Advected velocity field
+    descriptor_set_layout_->add_binding(2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Divergence field
+    descriptor_set_layout_->add_binding(3, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Color field
+    descriptor_set_layout_->add_binding(4, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Tile motion
+    descriptor_set_layout_->add_binding(5, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Tile active
+    descriptor_set_layout_->add_binding(6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Visited tile lists
+    descriptor_set_layout_->add_binding(7, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Active tile lists
+    descriptor_set_layout_->add_binding(8, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Step time
+
+    if (!descriptor_set_layout_->create(app_.device))
+    {
+        lava::logger()->error("Failed to create active tile descriptor set layout");
+        throw std::runtime_error("Failed to create active tile descriptor set layout");
+    }
+
+    measure_descriptor_set_ = descriptor_set_layout_->allocate(descriptor_pool_->get());
+    compact_descriptor_set_ = descriptor_set_layout_->allocate(descriptor_pool_->get());
+    if (!measure_descriptor_set_ || !compact_descriptor_set_)
+    {
+        lava::logger()->error("Failed to allocate active tile descriptor sets");
+        throw std::runtime_error("Failed to allocate active tile descriptor sets");
+    }
+}
+
+void ActiveTilePass::UpdateDescriptorSets()
+{
+    std::vector<VkDescriptorImageInfo> image_infos;
+    for (const auto &texture :
+         {velocity_field_, advected_velocity_field_, divergence_field_, color_field_, tile_motion_, tile_active_})
+    {
+        image_infos.push_back({.sampler = VK_NULL_HANDLE,
+                               .imageView = texture->get_image()->get_view(),
+                               .imageLayout = VK_IMAGE_LAYOUT_GENERAL});
+    }
+
+    const std::vector<VkDescriptorType> image_types(image_infos.size(), VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+    const std::vector<VkDescriptorType> buffer_types = {
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER};
+    const uint32_t first_buffer_binding = static_cast<uint32_t>(image_infos.size());
+
+    ComputePass::UpdateDescriptorSets(measure_descriptor_set_, image_infos, image_types);
+    ComputePass::UpdateDescriptorSets(
+        measure_descriptor_set_,
+        {*active_tile_buffer_->get_descriptor_info(), *active_tile_buffer_->get_descriptor_info(),
+         *step_time_buffer_->get_descriptor_info()},
+        buffer_types, first_buffer_binding);
+
+    ComputePass::UpdateDescriptorSets(compact_descriptor_set_, image_infos, image_types);
+    ComputePass::UpdateDescriptorSets(
+        compact_descriptor_set_,
+        {*tile_classification_buffer_->get_descriptor_info(), *active_tile_buffer_->get_descriptor_info(),
+         *step_time_buffer_->get_descriptor_info()},
+        buffer_types, first_buffer_binding);
+}
+
+void ActiveTilePass::CreatePipeline()
+{
+    CreateBasePipeline("ActiveTiles.comp", descriptor_set_layout_, sizeof(ActiveTileConstants));
+}
+
+void ActiveTilePass::TransitionImages(VkCommandBuffer cmd_buffer)
+{
+    for (const auto &texture :
+         {velocity_field_, advected_velocity_field_, divergence_field_, color_field_, tile_motion_, tile_active_})
+    {
+        texture->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL,
+                                                VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                                                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
+}
+
+void ActiveTilePass::CopyTileClassification(VkCommandBuffer cmd_buffer)
+{
+    // The last step may still dispatch from the active lists
+    VkMemoryBarrier copy_barrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                 .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+                                 .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT};
+
+    vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &copy_barrier, 0, nullptr, 0, nullptr);
+
+    VkBufferCopy copy{.srcOffset = 0, .dstOffset = 0, .size = active_tile_buffer_->get_size()};
+    vkCmdCopyBuffer(cmd_buffer, tile_classification_buffer_->get(), active_tile_buffer_->get(), 1, &copy);
+
+    VkMemoryBarrier list_barrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                 .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                                 .dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT};
+
+    vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                         &list_barrier, 0, nullptr, 0, nullptr);
+}
+
+void ActiveTilePass::Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants)
+{
+    if (!enabled_)
+    {
+        if (needs_update_ || !lists_copied_)
+        {
+            CopyTileClassification(cmd_buffer);
+            lists_copied_ = true;
+            needs_update_ = false;
+        }
+        return;
+    }
+
+    // Without a measured state, after new obstacles and on a reset every tile takes one step
+    const bool activate_all = needs_update_ || lists_copied_ || constants.reset_color != 0;
+
+    ActiveTileConstants active_constants{};
+    active_constants.simulation = constants;
+    active_constants.activate_all = activate_all ? 1 : 0;
+    active_constants.velocity_threshold = ACTIVE_TILE_VELOCITY_THRESHOLD;
+    active_constants.dye_threshold = ACTIVE_TILE_DYE_THRESHOLD;
+
+    pipeline_->bind(cmd_buffer);
+
+    if (!activate_all)
+    {
+        TransitionImages(cmd_buffer);
+
+        active_constants.stage = STAGE_MEASURE;
+        vkCmdPushConstants(cmd_buffer, pipeline_layout_->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                           sizeof(ActiveTileConstants), &active_constants);
+
+        vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_->get(), 0, 1,
+                                &measure_descriptor_set_, 0, nullptr);
+
+        DispatchCombined(cmd_buffer);
+    }
+
+    // The measure stage and the kernels of the last step must be done with the lists before they are rebuilt
+    VkMemoryBarrier reset_barrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                  .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+                                  .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT};
+
+    vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &reset_barrier, 0, nullptr, 0, nullptr);
+
+    const TileClassificationHeader empty_lists{.interior_dispatch = {0, 1, 1, 0},
+                                               .boundary_dispatch = {0, 1, 1, 0},
+                                               .combined_dispatch = {0, 1, 1, 0}};
+    vkCmdUpdateBuffer(cmd_buffer, active_tile_buffer_->get(), 0, sizeof(TileClassificationHeader), &empty_lists);
+
+    VkMemoryBarrier update_barrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                   .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                                   .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
+
+    vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                         &update_barrier, 0, nullptr, 0, nullptr);
+
+    // Orders the motion written above before the dilation reads it
+    TransitionImages(cmd_buffer);
+
+    active_constants.stage = STAGE_COMPACT;
+    vkCmdPushConstants(cmd_buffer, pipeline_layout_->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(ActiveTileConstants), &active_constants);
+
+    vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_->get(), 0, 1,
+                            &compact_descriptor_set_, 0, nullptr);
+
+    vkCmdDispatchIndirect(cmd_buffer, tile_classification_buffer_->get(),
+                          offsetof(TileClassificationHeader, combined_dispatch));
+
+    VkMemoryBarrier list_barrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                 .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+                                 .dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT};
+
+    vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                         &list_barrier, 0, nullptr, 0, nullptr);
+
+    lists_copied_ = false;
+    needs_update_ = false;
+}
+
+void ActiveTilePass::Dispatch(VkCommandBuffer cmd_buffer, TileClass tile_class) const
+{
+    const VkDeviceSize offset = (tile_class == TileClass::Interior)
+                                    ? offsetof(TileClassificationHeader, interior_dispatch)
+                                    : offsetof(TileClassificationHeader, boundary_dispatch);
+
+    vkCmdDispatchIndirect(cmd_buffer, active_tile_buffer_->get(), offset);
+}
+
+void ActiveTilePass::DispatchCombined(VkCommandBuffer cmd_buffer) const
+{
+    vkCmdDispatchIndirect(cmd_buffer, active_tile_buffer_->get(), offsetof(TileClassificationHeader, combined_dispatch));
+}
+
+} // namespace FluidSimulation
@@ -0,0 +1,300 @@
+#include "AsyncCompute.hpp"
+#include <algorithm>
+
+namespace FluidSimulation
+{
+
+AsyncCompute::AsyncCompute(lava::engine &app, Simulation::s_ptr simulation)
+    : app_(app), simulation_(std::move(simulation)), compute_queue_(app.device->get_compute_queue()),
+      graphics_queue_family_(static_cast<uint32_t>(app.device->get_graphics_queue().family))
+{
+    auto &resource_manager = ResourceManager::GetInstance();
+
+    color_field_ = resource_manager.GetTexture("color_field_A");
+    obstacle_mask_ = resource_manager.GetTexture("obstacle_mask");
+    for (uint32_t slot = 0; slot < DISPLAY_SLOT_COUNT; slot++)
+    {
+        display_color_[slot] = resource_manager.GetTexture("display_color_" + std::to_string(slot));
+        display_obstacle_[slot] = resource_manager.GetTexture("display_obstacle_" + std::to_string(slot));
+    }
+
+    CreateCommandBuffers();
+    compute_timeline_ = CreateTimelineSemaphore();
+    render_timeline_ = CreateTimelineSemaphore();
+
+    // Every frame waits for the step it shows and signals once it no longer samples that step's slot, the values are
+    // set per frame
+    app_.renderer.user_frame_wait_semaphores = {compute_timeline_};
+    app_.renderer.user_frame_wait_stages = {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT};
+    app_.renderer.user_frame_wait_values = {0};
+    app_.renderer.user_frame_signal_semaphores = {render_timeline_};
+    app_.renderer.user_frame_signal_values = {0};
+
+    lava::logger()->info("Simulation submits to {} queue of family {}",
+                         HasDedicatedQueue() ? "a dedicated compute" : "the graphics", compute_queue_.family);
+}
+
+AsyncCompute::~AsyncCompute()
+{
+    Destroy();
+}
+
+void AsyncCompute::Destroy()
+{
+    if (!command_pool_)
+    {
+        return;
+    }
+
+    // Steps and frames still in flight use the command buffers and signal the semaphores
+    app_.device->wait_for_idle();
+
+    app_.renderer.user_frame_wait_semaphores.clear();
+    app_.renderer.user_frame_wait_stages.clear();
+    app_.renderer.user_frame_wait_values.clear();
+    app_.renderer.user_frame_signal_semaphores.clear();
+    app_.renderer.user_frame_signal_values.clear();
+
+    app_.device->vkDestroySemaphore(compute_timeline_);
+    app_.device->vkDestroySemaphore(render_timeline_);
+    compute_timeline_ = VK_NULL_HANDLE;
+    render_timeline_ = VK_NULL_HANDLE;
+
+    app_.device->vkDestroyCommandPool(command_pool_);
+    command_pool_ = VK_NULL_HANDLE;
+}
+
+void AsyncCompute::CreateCommandBuffers()
+{
+    VkCommandPoolCreateInfo pool_info{.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                                      .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+                                      .queueFamilyIndex = static_cast<uint32_t>(compute_queue_.family)};
+
+    if (!app_.device->vkCreateCommandPool(&pool_info, &command_pool_))
+    {
+        lava::logger()->error("Failed to create simulation command pool");
+        throw std::runtime_error("Failed to create simulation command pool");
+    }
+
+    if (!app_.device->vkAllocateCommandBuffers(command_pool_, DISPLAY_SLOT_COUNT, command_buffers_.data()))
+    {
+        lava::logger()->error("Failed to allocate simulation command buffers");
+        throw std::runtime_error("Failed to allocate simulation command buffers");
+    }
+}
+
+VkSemaphore AsyncCompute::CreateTimelineSemaphore()
+{
+    VkSemaphoreTypeCreateInfo type_info{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+                                        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+                                        .initialValue = 0};
+    VkSemaphoreCreateInfo create_info{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO, .pNext = &type_info};
+
+    VkSemaphore semaphore = VK_NULL_HANDLE;
+    if (!app_.device->vkCreateSemaphore(&create_info, &semaphore))
+    {
+        lava::logger()->error("Failed to create timeline semaphore");
+        throw std::runtime_error("Failed to create timeline semaphore");
+    }
+    return semaphore;
+}
+
+void AsyncCompute::WaitForStep(uint64_t step)
+{
+    VkSemaphoreWaitInfo wait_info{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+                                  .semaphoreCount = 1,
+                                  .pSemaphores = &compute_timeline_,
+                                  .pValues = &step};
+
+    if (!lava::check(app_.device->call().vkWaitSemaphores(app_.device->get(), &wait_info, UINT64_MAX)))
+    {
+        lava::logger()->error("Failed to wait for simulation step {}", step);
+        throw std::runtime_error("Failed to wait for simulation step");
+    }
+}
+
+void AsyncCompute::Process(VkCommandBuffer cmd_buffer, const FrameTimeInfo &frame_context)
+{
+    const uint64_t step = ++step_count_;
+    const uint32_t slot = static_cast<uint32_t>(step % DISPLAY_SLOT_COUNT);
+
+    // The slot's command buffer was last submitted DISPLAY_SLOT_COUNT steps ago
+    if (step > DISPLAY_SLOT_COUNT)
+    {
+        WaitForStep(step - DISPLAY_SLOT_COUNT);
+    }
+
+    VkCommandBuffer compute_cmd_buffer = command_buffers_[slot];
+
+    VkCommandBufferBeginInfo begin_info{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+    if (!lava::check(app_.device->call().vkBeginCommandBuffer(compute_cmd_buffer, &begin_info)))
+    {
+        lava::logger()->error("Failed to begin simulation command buffer");
+        throw std::runtime_error("Failed to begin simulation command buffer");
+    }
+
+    uint64_t completed_step = 0;
+    if (!lava::check(app_.device->call().vkGetSemaphoreCounterValue(app_.device->get(), compute_timeline_,
+                                                                    &completed_step)))
+    {
+        lava::logger()->error("Failed to read the simulation timeline");
+        throw std::runtime_error("Failed to read the simulation timeline");
+    }
+
+    simulation_->BeginSubmission(step, completed_step);
+    simulation_->OnUpdate(compute_cmd_buffer, frame_context);
+    RecordDisplayCopy(compute_cmd_buffer, slot);
+
+    if (!lava::check(app_.device->call().vkEndCommandBuffer(compute_cmd_buffer)))
+    {
+        lava::logger()->error("Failed to end simulation command buffer");
+        throw std::runtime_error("Failed to end simulation command buffer");
+    }
+
+    // Only the copy waits, the frame before this one showed the step that last wrote the slot
+    VkSemaphoreSubmitInfo wait_info{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                                    .semaphore = render_timeline_,
+                                    .value = step - 1,
+                                    .stageMask = VK_PIPELINE_STAGE_2_COPY_BIT};
+    VkCommandBufferSubmitInfo cmd_buffer_info{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+                                              .commandBuffer = compute_cmd_buffer};
+    VkSemaphoreSubmitInfo signal_info{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                                      .semaphore = compute_timeline_,
+                                      .value = step,
+                                      .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT};
+    VkSubmitInfo2 submit_info{.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+                              .waitSemaphoreInfoCount = 1,
+                              .pWaitSemaphoreInfos = &wait_info,
+                              .commandBufferInfoCount = 1,
+                              .pCommandBufferInfos = &cmd_buffer_info,
+                              .signalSemaphoreInfoCount = 1,
+                              .pSignalSemaphoreInfos = &signal_info};
+
+    if (!lava::check(app_.device->call().vkQueueSubmit2(compute_queue_.vk_queue, 1, &submit_info, VK_NULL_HANDLE)))
+    {
+        lava::logger()->error("Failed to submit simulation step {}", step);
+        throw std::runtime_error("Failed to submit simulation step");
+    }
+
+    // The frame shows the previous step so the one just submitted overlaps it, the first frame has no previous step
+    const uint64_t shown_step = std::max<uint64_t>(step - 1, 1);
+    display_slot_ = static_cast<uint32_t>(shown_step % DISPLAY_SLOT_COUNT);
+
+    // A slot released by the compute queue is acquired once, the first step is shown twice
+    if (shown_step != acquired_step_)
+    {
+        RecordDisplayAcquire(cmd_buffer, display_slot_);
+        acquired_step_ = shown_step;
+    }
+
+    app_.renderer.user_frame_wait_values = {shown_step};
+    app_.renderer.user_frame_signal_values = {step};
+}
+
+VkImageMemoryBarrier2 AsyncCompute::DisplayBarrier(const lava::texture::s_ptr &texture, VkImageLayout old_layout,
+                                                   VkImageLayout new_layout) const
+{
+    const bool transfer_ownership = HasDedicatedQueue() && new_layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    return {.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+            .oldLayout = old_layout,
+            .newLayout = new_layout,
+            .srcQueueFamilyIndex =
+                transfer_ownership ? static_cast<uint32_t>(compute_queue_.family) : VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = transfer_ownership ? graphics_queue_family_ : VK_QUEUE_FAMILY_IGNORED,
+            .image = texture->get_image()->get(),
+            .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}};
+}
+
+void AsyncCompute::RecordDisplayCopy(VkCommandBuffer cmd_buffer, uint32_t slot)
+{
+    auto color_image = color_field_->get_image();
+    auto obstacle_image = obstacle_mask_->get_image();
+
+    // The passes sampling the obstacle mask expect it to stay in the layout the simulation left it in
+    const VkImageLayout color_layout = color_image->get_layout();
+    const VkImageLayout obstacle_layout = obstacle_image->get_layout();
+
+    source_barriers_.Transition(color_field_, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT,
+                                VK_PIPELINE_STAGE_TRANSFER_BIT);
+    source_barriers_.Transition(obstacle_mask_, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT,
+                                VK_PIPELINE_STAGE_TRANSFER_BIT);
+    source_barriers_.Flush(cmd_buffer);
+
+    // The slot's previous contents are discarded, which needs no ownership transfer back to the compute queue
+    std::array<VkImageMemoryBarrier2, 2> copy_barriers{
+        DisplayBarrier(display_color_[slot], VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL),
+        DisplayBarrier(display_obstacle_[slot], VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)};
+    for (auto &barrier : copy_barriers)
+    {
+        barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+        barrier.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+        barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    }
+
+    VkDependencyInfo copy_dependency{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                                     .imageMemoryBarrierCount = static_cast<uint32_t>(copy_barriers.size()),
+                                     .pImageMemoryBarriers = copy_barriers.data()};
+    vkCmdPipelineBarrier2(cmd_buffer, &copy_dependency);
+
+    const VkExtent3D extent = color_image->get_info().extent;
+    VkImageCopy region{.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+                       .dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+                       .extent = extent};
+
+    vkCmdCopyImage(cmd_buffer, color_image->get(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                   display_color_[slot]->get_image()->get(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    vkCmdCopyImage(cmd_buffer, obstacle_image->get(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                   display_obstacle_[slot]->get_image()->get(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    // Released to the graphics queue family on devices with a dedicated compute queue, the frame's semaphore wait
+    // makes the copies visible to the fragment shader
+    std::array<VkImageMemoryBarrier2, 2> display_barriers{
+        DisplayBarrier(display_color_[slot], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),
+        DisplayBarrier(display_obstacle_[slot], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)};
+    for (auto &barrier : display_barriers)
+    {
+        barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+        barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        barrier.dstStageMask = HasDedicatedQueue() ? VK_PIPELINE_STAGE_2_NONE : VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    }
+
+    VkDependencyInfo display_dependency{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                                        .imageMemoryBarrierCount = static_cast<uint32_t>(display_barriers.size()),
+                                        .pImageMemoryBarriers = display_barriers.data()};
+    vkCmdPipelineBarrier2(cmd_buffer, &display_dependency);
+
+    source_barriers_.Transition(color_field_, color_layout, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    source_barriers_.Transition(obstacle_mask_, obstacle_layout, VK_ACCESS_SHADER_READ_BIT);
+    source_barriers_.Flush(cmd_buffer);
+}
+
+void AsyncCompute::RecordDisplayAcquire(VkCommandBuffer cmd_buffer, uint32_t slot)
+{
+    if (!HasDedicatedQueue())
+    {
+        return;
+    }
+
+    // Matches the release of RecordDisplayCopy, waits where the frame waits for the step
+    std::array<VkImageMemoryBarrier2, 2> acquire_barriers{
+        DisplayBarrier(display_color_[slot], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),
+        DisplayBarrier(display_obstacle_[slot], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)};
+    for (auto &barrier : acquire_barriers)
+    {
+        barrier.dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+        barrier.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+    }
+
+    VkDependencyInfo acquire_dependency{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                                        .imageMemoryBarrierCount = static_cast<uint32_t>(acquire_barriers.size()),
+                                        .pImageMemoryBarriers = acquire_barriers.data()};
+    vkCmdPipelineBarrier2(cmd_buffer, &acquire_dependency);
+}
+
+} // namespace FluidSimulation
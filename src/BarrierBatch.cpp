@@ -0,0 +1,83 @@
+#include "BarrierBatch.hpp"
+
+namespace FluidSimulation
+{
+
+namespace
+{
+
+constexpr VkAccessFlags WRITE_ACCESS = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                       VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT |
+                                       VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+} // namespace
+
+void BarrierBatch::Transition(const lava::image::s_ptr &image, VkImageLayout layout, VkAccessFlags access,
+                              VkPipelineStageFlags stage)
+{
+    const VkImage vk_image = image->get();
+
+    // A second use within the batch widens the barrier that is already pending
+    for (auto &barrier : image_barriers_)
+    {
+        if (barrier.image == vk_image && barrier.newLayout == layout)
+        {
+            barrier.dstAccessMask |= access;
+            barrier.dstStageMask |= stage;
+            image->set_transition_state(layout, static_cast<VkAccessFlags>(barrier.dstAccessMask),
+                                        static_cast<VkPipelineStageFlags>(barrier.dstStageMask));
+            return;
+        }
+    }
+
+    const VkImageLayout old_layout = image->get_layout();
+    const VkAccessFlags old_access = image->get_access_mask();
+    const VkPipelineStageFlags old_stage = image->get_stage();
+
+    // A read in the same layout needs no barrier once the last one made the image visible to its stage and access
+    const bool covered = !(old_access & WRITE_ACCESS) && !(access & WRITE_ACCESS) && (access & ~old_access) == 0 &&
+                         (stage & ~old_stage) == 0;
+    if (old_layout == layout && covered)
+    {
+        return;
+    }
+
+    const VkImageCreateInfo &info = image->get_info();
+
+    // The legacy access and stage bits have the same values in the 2 variants
+    image_barriers_.push_back({.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                               .srcStageMask = old_stage,
+                               .srcAccessMask = old_access,
+                               .dstStageMask = stage,
+                               .dstAccessMask = access,
+                               .oldLayout = old_layout,
+                               .newLayout = layout,
+                               .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                               .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                               .image = vk_image,
+                               .subresourceRange = {.aspectMask = image->get_subresource_range().aspectMask,
+                                                    .baseMipLevel = 0,
+                                                    .levelCount = info.mipLevels,
+                                                    .baseArrayLayer = 0,
+                                                    .layerCount = info.arrayLayers}});
+
+    image->set_transition_state(layout, access, stage);
+}
+
+void BarrierBatch::Flush(VkCommandBuffer cmd_buffer)
+{
+    if (image_barriers_.empty())
+    {
+        return;
+    }
+
+    VkDependencyInfo dependency_info{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                                     .imageMemoryBarrierCount = static_cast<uint32_t>(image_barriers_.size()),
+                                     .pImageMemoryBarriers = image_barriers_.data()};
+
+    vkCmdPipelineBarrier2(cmd_buffer, &dependency_info);
+
+    image_barriers_.clear();
+}
+
+} // namespace FluidSimulation
@@ -0,0 +1,124 @@
+#include "BoundaryMapPass.hpp"
+
+namespace FluidSimulation
+{
+
+BoundaryMapPass::BoundaryMapPass(lava::engine &app, lava::descriptor::pool::s_ptr pool, uint32_t max_levels)
+    : ComputePass(app, pool), max_levels_(max_levels)
+{
+    auto &resource_manager = ResourceManager::GetInstance();
+
+    obstacle_textures_.resize(max_levels_);
+    boundary_maps_.resize(max_levels_);
+    obstacle_textures_[0] = resource_manager.GetTexture("obstacle_distance");
+    boundary_maps_[0] = resource_manager.GetTexture("boundary_map");
+    for (uint32_t level = 1; level < max_levels_; level++)
+    {
+        obstacle_textures_[level] = resource_manager.GetTexture("obstacle_mask_L" + std::to_string(level));
+        boundary_maps_[level] = resource_manager.GetTexture("boundary_map_L" + std::to_string(level));
+    }
+
+    CreateDescriptorSets();
+    CreatePipeline();
+    UpdateDescriptorSets();
+}
+
+BoundaryMapPass::~BoundaryMapPass()
+{
+    if (distance_field_pipeline_)
+    {
+        distance_field_pipeline_->destroy();
+    }
+    if (descriptor_set_layout_)
+    {
+        descriptor_set_layout_->destroy();
+    }
+}
+
+void BoundaryMapPass::CreateDescriptorSets()
+{
+    descriptor_set_layout_ = lava::descriptor::make();
+    descriptor_set_layout_->add_binding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Obstacle distance or solid fraction
+    descriptor_set_layout_->add_binding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Boundary map
+
+    if (!descriptor_set_layout_->create(app_.device))
+    {
+        lava::logger()->error("Failed to create boundary map descriptor set layout");
+        throw std::runtime_error("Failed to create boundary map descriptor set layout");
+    }
+
+    descriptor_sets_.resize(max_levels_);
+    for (auto &descriptor_set : descriptor_sets_)
+    {
+        descriptor_set = descriptor_set_layout_->allocate(descriptor_pool_->get());
+        if (!descriptor_set)
+        {
+            lava::logger()->error("Failed to allocate boundary map descriptor set");
+            throw std::runtime_error("Failed to allocate boundary map descriptor set");
+        }
+    }
+}
+
+void BoundaryMapPass::UpdateDescriptorSets()
+{
+    std::vector<VkDescriptorType> descriptor_types = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                      VK_DESCRIPTOR_TYPE_STORAGE_IMAGE};
+
+    for (uint32_t level = 0; level < max_levels_; level++)
+    {
+        VkDescriptorImageInfo obstacle_info{.sampler = obstacle_textures_[level]->get_sampler(),
+                                            .imageView = obstacle_textures_[level]->get_image()->get_view(),
+                                            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+
+        VkDescriptorImageInfo boundary_map_info{.sampler = VK_NULL_HANDLE,
+                                                .imageView = boundary_maps_[level]->get_image()->get_view(),
+                                                .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+
+        ComputePass::UpdateDescriptorSets(descriptor_sets_[level], {obstacle_info, boundary_map_info},
+                                          descriptor_types);
+    }
+}
+
+void BoundaryMapPass::CreatePipeline()
+{
+    CreateBasePipeline("BoundaryMap.comp", descriptor_set_layout_);
+
+    const VkBool32 from_distance_field = VK_TRUE;
+    const std::vector<VkSpecializationMapEntry> entries = {{0, 0, sizeof(VkBool32)}};
+
+    distance_field_pipeline_ = CreateSpecializedPipeline("BoundaryMap.comp", pipeline_layout_, entries,
+                                                         lava::c_data(&from_distance_field, sizeof(VkBool32)));
+}
+
+void BoundaryMapPass::Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants)
+{
+    if (!needs_update_)
+    {
+        return;
+    }
+
+    // Every level is left readable for the solvers, the obstacle textures were left readable by their own passes
+    for (uint32_t level = 0; level < max_levels_; level++)
+    {
+        auto boundary_image = boundary_maps_[level]->get_image();
+        boundary_image->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT,
+                                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+        (level == 0 ? distance_field_pipeline_ : pipeline_)->bind(cmd_buffer);
+
+        vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_->get(), 0, 1,
+                                &descriptor_sets_[level], 0, nullptr);
+
+        const glm::uvec2 size = boundary_image->get_size();
+        vkCmdDispatch(cmd_buffer, (size.x + 15) / 16, (size.y + 15) / 16, 1);
+
+        boundary_image->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                          VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
+
+    needs_update_ = false;
+}
+
+} // namespace FluidSimulation
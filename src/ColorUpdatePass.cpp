@@ -1,4 +1,5 @@
 #include "ColorUpdatePass.hpp"
+#include <cstddef>
 
 namespace FluidSimulation
 {
@@ -9,7 +10,9 @@ ColorUpdatePass::ColorUpdatePass(lava::engine &app, lava::descriptor::pool::s_pt
 
     color_field_B_ = resource_manager.GetTexture("color_field_B");
     color_field_A_ = resource_manager.GetTexture("color_field_A");
-    obstacle_mask_ = resource_manager.GetTexture("obstacle_mask");
+    obstacle_distance_ = resource_manager.GetTexture("obstacle_distance");
+    tile_buffer_ = resource_manager.GetBuffer("active_tiles");
+    step_time_buffer_ = resource_manager.GetBuffer("step_time");
 
     CreateDescriptorSets();
     CreatePipeline();
@@ -32,7 +35,11 @@ void ColorUpdatePass::CreateDescriptorSets()
     descriptor_set_layout_->add_binding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
                                         VK_SHADER_STAGE_COMPUTE_BIT); // Target color field
     descriptor_set_layout_->add_binding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                        VK_SHADER_STAGE_COMPUTE_BIT); // Obstacle mask
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Obstacle distance
+    descriptor_set_layout_->add_binding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Tile lists
+    descriptor_set_layout_->add_binding(4, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Step time
 
     if (!descriptor_set_layout_->create(app_.device))
     {
@@ -58,16 +65,24 @@ void ColorUpdatePass::UpdateDescriptorSets()
                                              .imageView = color_field_A_->get_image()->get_view(),
                                              .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
 
-    VkDescriptorImageInfo obstacle_mask_info{.sampler = obstacle_mask_->get_sampler(),
-                                             .imageView = obstacle_mask_->get_image()->get_view(),
-                                             .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    VkDescriptorImageInfo obstacle_distance_info{.sampler = obstacle_distance_->get_sampler(),
+                                                 .imageView = obstacle_distance_->get_image()->get_view(),
+                                                 .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
 
-    std::vector<VkDescriptorImageInfo> image_infos = {color_field_B_info, color_field_A_info, obstacle_mask_info};
+    std::vector<VkDescriptorImageInfo> image_infos = {color_field_B_info, color_field_A_info, obstacle_distance_info};
 
     std::vector<VkDescriptorType> descriptor_types = {
         VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER};
 
     ComputePass::UpdateDescriptorSets(descriptor_set_, image_infos, descriptor_types);
+
+    std::vector<VkDescriptorBufferInfo> buffer_infos = {*tile_buffer_->get_descriptor_info(),
+                                                        *step_time_buffer_->get_descriptor_info()};
+    std::vector<VkDescriptorType> buffer_types = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                                  VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER};
+
+    ComputePass::UpdateDescriptorSets(descriptor_set_, buffer_infos, buffer_types,
+                                      static_cast<uint32_t>(image_infos.size()));
 }
 
 void ColorUpdatePass::CreatePipeline()
@@ -77,14 +92,10 @@ void ColorUpdatePass::CreatePipeline()
 
 void ColorUpdatePass::Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants)
 {
-    color_field_A_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT,
-                                                   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-
-    color_field_B_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT,
-                                                   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-
-    obstacle_mask_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                                                   VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    barriers_.Transition(color_field_A_, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT);
+    barriers_.Transition(color_field_B_, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT);
+    barriers_.Transition(obstacle_distance_, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT);
+    barriers_.Flush(cmd_buffer);
 
     pipeline_->bind(cmd_buffer);
 
@@ -94,9 +105,8 @@ void ColorUpdatePass::Execute(VkCommandBuffer cmd_buffer, const SimulationConsta
     vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_->get(), 0, 1, &descriptor_set_,
                             0, nullptr);
 
-    uint32_t group_count_x = (constants.texture_width + 15) / 16;
-    uint32_t group_count_y = (constants.texture_height + 15) / 16;
-    vkCmdDispatch(cmd_buffer, group_count_x, group_count_y, 1);
+    // Retired tiles hold the same dye in both fields, only the active tiles are copied back
+    vkCmdDispatchIndirect(cmd_buffer, tile_buffer_->get(), offsetof(TileClassificationHeader, combined_dispatch));
 }
 
 } // namespace FluidSimulation
\ No newline at end of file
@@ -18,7 +18,7 @@ ComputePass::~ComputePass()
 void ComputePass::CreateBasePipeline(const char *shader_name, lava::descriptor::s_ptr descriptor_set_layout,
                                      size_t push_constant_size)
 {
-    pipeline_ = lava::compute_pipeline::make(app_.device);
+    pipeline_ = lava::compute_pipeline::make(app_.device, app_.pipeline_cache);
     pipeline_layout_ = lava::pipeline_layout::make();
     pipeline_layout_->add(descriptor_set_layout);
 
@@ -48,6 +48,105 @@ void ComputePass::CreateBasePipeline(const char *shader_name, lava::descriptor::
     }
 }
 
+void ComputePass::CreateBasePipeline(lava::compute_pipeline::s_ptr &pipeline, const char *shader_name,
+                                     lava::descriptor::s_ptr descriptor_set_layout,
+                                     lava::pipeline_layout::s_ptr &existing_pipeline_layout,
+                                     size_t push_constant_size)
+{
+    pipeline = lava::compute_pipeline::make(app_.device, app_.pipeline_cache);
+    existing_pipeline_layout = lava::pipeline_layout::make();
+    existing_pipeline_layout->add(descriptor_set_layout);
+
+    if (push_constant_size > 0)
+    {
+        existing_pipeline_layout->add_push_constant_range(
+            {VK_SHADER_STAGE_COMPUTE_BIT, 0, static_cast<uint32_t>(push_constant_size)});
+    }
+
+    if (!existing_pipeline_layout->create(app_.device))
+    {
+        throw std::runtime_error("Failed to create pipeline layout");
+    }
+
+    lava::c_data shader_data = app_.producer.get_shader(shader_name);
+    if (!shader_data.addr)
+    {
+        throw std::runtime_error("Failed to load shader");
+    }
+
+    pipeline->set_shader_stage(shader_data, VK_SHADER_STAGE_COMPUTE_BIT);
+    pipeline->set_layout(existing_pipeline_layout);
+
+    if (!pipeline->create())
+    {
+        throw std::runtime_error("Failed to create pipeline");
+    }
+}
+
+lava::pipeline_layout::s_ptr ComputePass::CreatePipelineLayout(lava::descriptor::s_ptr descriptor_set_layout,
+                                                               size_t push_constant_size)
+{
+    auto pipeline_layout = lava::pipeline_layout::make();
+    pipeline_layout->add(descriptor_set_layout);
+
+    if (push_constant_size > 0)
+    {
+        pipeline_layout->add_push_constant_range(
+            {VK_SHADER_STAGE_COMPUTE_BIT, 0, static_cast<uint32_t>(push_constant_size)});
+    }
+
+    if (!pipeline_layout->create(app_.device))
+    {
+        throw std::runtime_error("Failed to create pipeline layout");
+    }
+
+    return pipeline_layout;
+}
+
+lava::compute_pipeline::s_ptr ComputePass::CreateSpecializedPipeline(
+    const char *shader_name, lava::pipeline_layout::s_ptr pipeline_layout,
+    const std::vector<VkSpecializationMapEntry> &specialization_entries, lava::c_data specialization_data)
+{
+    lava::c_data shader_data = app_.producer.get_shader(shader_name);
+    if (!shader_data.addr)
+    {
+        throw std::runtime_error("Failed to load shader");
+    }
+
+    auto shader_stage = lava::pipeline::shader_stage::make(VK_SHADER_STAGE_COMPUTE_BIT);
+    for (const VkSpecializationMapEntry &entry : specialization_entries)
+    {
+        shader_stage->add_specialization_entry(entry);
+    }
+
+    if (!shader_stage->create(app_.device, shader_data, specialization_data))
+    {
+        throw std::runtime_error("Failed to create shader stage");
+    }
+
+    auto pipeline = lava::compute_pipeline::make(app_.device, app_.pipeline_cache);
+    pipeline->set(shader_stage);
+    pipeline->set_layout(pipeline_layout);
+
+    if (!pipeline->create())
+    {
+        throw std::runtime_error("Failed to create pipeline");
+    }
+
+    return pipeline;
+}
+
+lava::compute_pipeline::s_ptr ComputePass::CreateTilePipeline(const char *shader_name,
+                                                              lava::pipeline_layout::s_ptr pipeline_layout,
+                                                              TileClass tile_class)
+{
+    const int32_t tile_class_constant = static_cast<int32_t>(tile_class);
+    const std::vector<VkSpecializationMapEntry> entries = {{0, 0, sizeof(int32_t)}};
+
+    return CreateSpecializedPipeline(shader_name, pipeline_layout, entries,
+                                     lava::c_data(&tile_class_constant, sizeof(int32_t)));
+}
+
 void ComputePass::UpdateDescriptorSets(VkDescriptorSet descriptor_set,
                                        const std::vector<VkDescriptorImageInfo> &image_infos,
                                        const std::vector<VkDescriptorType> &descriptor_types)
@@ -68,4 +167,24 @@ void ComputePass::UpdateDescriptorSets(VkDescriptorSet descriptor_set,
     app_.device->vkUpdateDescriptorSets(static_cast<uint32_t>(write_sets.size()), write_sets.data(), 0, nullptr);
 }
 
+void ComputePass::UpdateDescriptorSets(VkDescriptorSet descriptor_set,
+                                       const std::vector<VkDescriptorBufferInfo> &buffer_infos,
+                                       const std::vector<VkDescriptorType> &descriptor_types, uint32_t first_binding)
+{
+    std::vector<VkWriteDescriptorSet> write_sets;
+    write_sets.reserve(buffer_infos.size());
+
+    for (size_t i = 0; i < buffer_infos.size(); i++)
+    {
+        write_sets.push_back({.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                              .dstSet = descriptor_set,
+                              .dstBinding = first_binding + static_cast<uint32_t>(i),
+                              .descriptorCount = 1,
+                              .descriptorType = descriptor_types[i],
+                              .pBufferInfo = &buffer_infos[i]});
+    }
+
+    app_.device->vkUpdateDescriptorSets(static_cast<uint32_t>(write_sets.size()), write_sets.data(), 0, nullptr);
+}
+
 } // namespace FluidSimulation
\ No newline at end of file
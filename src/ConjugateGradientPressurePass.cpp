@@ -0,0 +1,271 @@
+#include "ConjugateGradientPressurePass.hpp"
+
+namespace FluidSimulation
+{
+
+ConjugateGradientPressurePass::ConjugateGradientPressurePass(lava::engine &app, lava::descriptor::pool::s_ptr pool,
+                                                             uint32_t multigrid_levels)
+    : ComputePass(app, pool)
+{
+    auto &resource_manager = ResourceManager::GetInstance();
+
+    divergence_field_ = resource_manager.GetTexture("divergence_field");
+    pressure_field_ = resource_manager.GetTexture("pressure_field_A");
+    solution_ = resource_manager.GetTexture("conjugate_gradient_solution");
+    residual_ = resource_manager.GetTexture("conjugate_gradient_residual");
+    search_direction_ = resource_manager.GetTexture("conjugate_gradient_direction");
+    operator_result_ = resource_manager.GetTexture("conjugate_gradient_operator_result");
+    preconditioner_rhs_ = resource_manager.GetTexture("conjugate_gradient_preconditioner_rhs");
+    preconditioned_residual_ = resource_manager.GetTexture("conjugate_gradient_preconditioned_A");
+    obstacle_mask_ = resource_manager.GetTexture("obstacle_mask");
+    reduction_buffer_ = resource_manager.GetBuffer("conjugate_gradient_reduction");
+
+    // A single red-black cycle from a zero guess, the in-place smoother keeps the result in the bound texture
+    preconditioner_ = VCyclePressurePass::Make(app, pool, multigrid_levels,
+                                               {"conjugate_gradient_preconditioner_rhs",
+                                                "conjugate_gradient_preconditioned_A",
+                                                "conjugate_gradient_preconditioned_B"});
+    preconditioner_->SetRelaxationType(VCycleRelaxationType::Red_Black_Gauss_Seidel);
+    preconditioner_->SetRelaxationIterations(2);
+    preconditioner_->SetVCycleIterations(1);
+    preconditioner_->SetZeroInitialGuess(true);
+
+    CreateDescriptorSets();
+    CreatePipeline();
+    UpdateDescriptorSets();
+}
+
+ConjugateGradientPressurePass::~ConjugateGradientPressurePass()
+{
+    for (auto *pipeline : {&initialize_pipeline_, &dot_product_pipeline_, &reduce_pipeline_,
+                           &update_direction_pipeline_, &apply_operator_pipeline_, &update_solution_pipeline_,
+                           &finalize_pipeline_})
+    {
+        if (*pipeline)
+        {
+            (*pipeline)->destroy();
+        }
+    }
+
+    for (auto *pipeline_layout :
+         {&initialize_pipeline_layout_, &dot_product_pipeline_layout_, &reduce_pipeline_layout_,
+          &update_direction_pipeline_layout_, &apply_operator_pipeline_layout_, &update_solution_pipeline_layout_,
+          &finalize_pipeline_layout_})
+    {
+        if (*pipeline_layout)
+        {
+            (*pipeline_layout)->destroy();
+        }
+    }
+
+    if (descriptor_set_layout_)
+    {
+        descriptor_set_layout_->destroy();
+    }
+}
+
+void ConjugateGradientPressurePass::CreateDescriptorSets()
+{
+    descriptor_set_layout_ = lava::descriptor::make();
+    descriptor_set_layout_->add_binding(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Divergence field
+    descriptor_set_layout_->add_binding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Pressure field
+    descriptor_set_layout_->add_binding(2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Solution
+    descriptor_set_layout_->add_binding(3, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Residual
+    descriptor_set_layout_->add_binding(4, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Search direction
+    descriptor_set_layout_->add_binding(5, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Operator applied to the search direction
+    descriptor_set_layout_->add_binding(6, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Preconditioner right hand side
+    descriptor_set_layout_->add_binding(7, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Preconditioned residual
+    descriptor_set_layout_->add_binding(8, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Obstacle mask
+    descriptor_set_layout_->add_binding(9, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Dot product reduction
+
+    if (!descriptor_set_layout_->create(app_.device))
+    {
+        lava::logger()->error("Failed to create conjugate gradient descriptor set layout");
+        throw std::runtime_error("Failed to create conjugate gradient descriptor set layout");
+    }
+
+    descriptor_set_ = descriptor_set_layout_->allocate(descriptor_pool_->get());
+    if (!descriptor_set_)
+    {
+        lava::logger()->error("Failed to allocate conjugate gradient descriptor set");
+        throw std::runtime_error("Failed to allocate conjugate gradient descriptor set");
+    }
+}
+
+void ConjugateGradientPressurePass::UpdateDescriptorSets()
+{
+    std::vector<VkDescriptorImageInfo> image_infos;
+    std::vector<VkDescriptorType> image_types;
+
+    for (auto &texture : {divergence_field_, pressure_field_, solution_, residual_, search_direction_,
+                          operator_result_, preconditioner_rhs_, preconditioned_residual_})
+    {
+        image_infos.push_back({.sampler = VK_NULL_HANDLE,
+                               .imageView = texture->get_image()->get_view(),
+                               .imageLayout = VK_IMAGE_LAYOUT_GENERAL});
+        image_types.push_back(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+    }
+
+    image_infos.push_back({.sampler = obstacle_mask_->get_sampler(),
+                           .imageView = obstacle_mask_->get_image()->get_view(),
+                           .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL});
+    image_types.push_back(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+
+    ComputePass::UpdateDescriptorSets(descriptor_set_, image_infos, image_types);
+
+    std::vector<VkDescriptorBufferInfo> buffer_infos = {*reduction_buffer_->get_descriptor_info()};
+    std::vector<VkDescriptorType> buffer_types = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER};
+
+    ComputePass::UpdateDescriptorSets(descriptor_set_, buffer_infos, buffer_types,
+                                      static_cast<uint32_t>(image_infos.size()));
+}
+
+void ConjugateGradientPressurePass::CreatePipeline()
+{
+    const size_t push_constant_size = sizeof(ConjugateGradientConstants);
+
+    CreateBasePipeline(initialize_pipeline_, "ConjugateGradientInitialize.comp", descriptor_set_layout_,
+                       initialize_pipeline_layout_, push_constant_size);
+    CreateBasePipeline(dot_product_pipeline_, "ConjugateGradientDotProduct.comp", descriptor_set_layout_,
+                       dot_product_pipeline_layout_, push_constant_size);
+    CreateBasePipeline(reduce_pipeline_, "ConjugateGradientReduce.comp", descriptor_set_layout_,
+                       reduce_pipeline_layout_, push_constant_size);
+    CreateBasePipeline(update_direction_pipeline_, "ConjugateGradientUpdateDirection.comp", descriptor_set_layout_,
+                       update_direction_pipeline_layout_, push_constant_size);
+    CreateBasePipeline(apply_operator_pipeline_, "ConjugateGradientApplyOperator.comp", descriptor_set_layout_,
+                       apply_operator_pipeline_layout_, push_constant_size);
+    CreateBasePipeline(update_solution_pipeline_, "ConjugateGradientUpdateSolution.comp", descriptor_set_layout_,
+                       update_solution_pipeline_layout_, push_constant_size);
+    CreateBasePipeline(finalize_pipeline_, "ConjugateGradientFinalize.comp", descriptor_set_layout_,
+                       finalize_pipeline_layout_, push_constant_size);
+}
+
+void ConjugateGradientPressurePass::InsertComputeBarrier(VkCommandBuffer cmd_buffer)
+{
+    // Kernels exchange data through images and the reduction buffer, all of them already in their final layout
+    VkMemoryBarrier barrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                            .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+                            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
+
+    vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0,
+                         nullptr, 0, nullptr);
+}
+
+void ConjugateGradientPressurePass::Dispatch(VkCommandBuffer cmd_buffer, lava::compute_pipeline::s_ptr &pipeline,
+                                             const ConjugateGradientConstants &constants, DispatchShape shape)
+{
+    pipeline->bind(cmd_buffer);
+    vkCmdPushConstants(cmd_buffer, pipeline->get_layout()->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(ConjugateGradientConstants), &constants);
+    vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->get_layout()->get(), 0, 1,
+                            &descriptor_set_, 0, nullptr);
+
+    if (shape == DispatchShape::Single_Group)
+    {
+        if (convergence_control_)
+        {
+            convergence_control_->DispatchSingleGroup(cmd_buffer);
+        }
+        else
+        {
+            vkCmdDispatch(cmd_buffer, 1, 1, 1);
+        }
+    }
+    else if (shape == DispatchShape::Grid && convergence_control_)
+    {
+        convergence_control_->DispatchLevel(cmd_buffer, 0);
+    }
+    else
+    {
+        vkCmdDispatch(cmd_buffer, (constants.simulation.texture_width + 15) / 16,
+                      (constants.simulation.texture_height + 15) / 16, 1);
+    }
+
+    InsertComputeBarrier(cmd_buffer);
+}
+
+void ConjugateGradientPressurePass::DotProduct(VkCommandBuffer cmd_buffer, ConjugateGradientConstants constants,
+                                               int dot_product_mode)
+{
+    constants.dot_product_mode = dot_product_mode;
+
+    // Per-workgroup partial sums, then a single workgroup folds them into the reduction buffer
+    Dispatch(cmd_buffer, dot_product_pipeline_, constants, DispatchShape::Grid);
+    Dispatch(cmd_buffer, reduce_pipeline_, constants, DispatchShape::Single_Group);
+}
+
+void ConjugateGradientPressurePass::Precondition(VkCommandBuffer cmd_buffer, const SimulationConstants &constants)
+{
+    preconditioner_->Execute(cmd_buffer, constants);
+    InsertComputeBarrier(cmd_buffer);
+}
+
+void ConjugateGradientPressurePass::Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants)
+{
+    for (auto &texture : {divergence_field_, pressure_field_, solution_, residual_, search_direction_,
+                          operator_result_, preconditioner_rhs_, preconditioned_residual_})
+    {
+        texture->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL,
+                                                VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                                                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
+
+    const uint32_t group_count_x = (constants.texture_width + 15) / 16;
+    const uint32_t group_count_y = (constants.texture_height + 15) / 16;
+
+    ConjugateGradientConstants cg_constants{};
+    cg_constants.simulation = constants;
+    cg_constants.partial_sum_count = static_cast<int>(group_count_x * group_count_y);
+
+    // The reset only applies to the initial guess, the preconditioner must still produce a correction
+    SimulationConstants preconditioner_constants = constants;
+    preconditioner_constants.reset_color = 0;
+
+    Dispatch(cmd_buffer, initialize_pipeline_, cg_constants, DispatchShape::Ungated_Grid);
+
+    Precondition(cmd_buffer, preconditioner_constants);
+    DotProduct(cmd_buffer, cg_constants, DOT_PRODUCT_RESIDUAL);
+    Dispatch(cmd_buffer, update_direction_pipeline_, cg_constants, DispatchShape::Grid);
+
+    for (uint32_t i = 0; i < iterations_; i++)
+    {
+        cg_constants.iteration = static_cast<int>(i);
+
+        Dispatch(cmd_buffer, apply_operator_pipeline_, cg_constants, DispatchShape::Grid);
+        DotProduct(cmd_buffer, cg_constants, DOT_PRODUCT_DIRECTION);
+        Dispatch(cmd_buffer, update_solution_pipeline_, cg_constants, DispatchShape::Grid);
+
+        if (i + 1 == iterations_)
+        {
+            break;
+        }
+
+        if (convergence_control_)
+        {
+            convergence_control_->CheckResidual(cmd_buffer, constants, ResidualSource::Conjugate_Gradient);
+        }
+
+        // The new residual dot lands in the other slot, beta divides it by the one alpha just used
+        cg_constants.iteration = static_cast<int>(i + 1);
+
+        DotProduct(cmd_buffer, cg_constants, DOT_PRODUCT_STALE_RESIDUAL);
+        Precondition(cmd_buffer, preconditioner_constants);
+        DotProduct(cmd_buffer, cg_constants, DOT_PRODUCT_RESIDUAL);
+        Dispatch(cmd_buffer, update_direction_pipeline_, cg_constants, DispatchShape::Grid);
+    }
+
+    Dispatch(cmd_buffer, finalize_pipeline_, cg_constants, DispatchShape::Ungated_Grid);
+}
+
+} // namespace FluidSimulation
@@ -0,0 +1,245 @@
+#include "ConvergenceControlPass.hpp"
+#include <cstddef>
+
+namespace FluidSimulation
+{
+
+ConvergenceControlPass::ConvergenceControlPass(lava::engine &app, lava::descriptor::pool::s_ptr pool,
+                                               uint32_t multigrid_levels)
+    : ComputePass(app, pool)
+{
+    if (multigrid_levels > MAX_CONVERGENCE_LEVELS)
+    {
+        lava::logger()->error("Convergence control supports at most {} multigrid levels", MAX_CONVERGENCE_LEVELS);
+        throw std::runtime_error("Too many multigrid levels for convergence control");
+    }
+
+    auto &resource_manager = ResourceManager::GetInstance();
+
+    divergence_field_ = resource_manager.GetTexture("divergence_field");
+    pressure_field_ = resource_manager.GetTexture("pressure_field_A");
+    conjugate_gradient_residual_ = resource_manager.GetTexture("conjugate_gradient_residual");
+    boundary_map_ = resource_manager.GetTexture("boundary_map");
+    control_buffer_ = resource_manager.GetBuffer("pressure_convergence_control");
+    tile_buffer_ = resource_manager.GetBuffer("tile_classification");
+
+    // Full-size arguments of every dispatch shape the solvers use
+    for (uint32_t level = 0; level < multigrid_levels; level++)
+    {
+        const glm::uvec2 size =
+            (level == 0) ? divergence_field_->get_image()->get_size()
+                         : resource_manager.GetTexture("pressure_multigrid_A_L" + std::to_string(level))
+                               ->get_image()
+                               ->get_size();
+
+        reset_header_.level_dispatch[level] = {(size.x + 15) / 16, (size.y + 15) / 16, 1, 0};
+        reset_header_.red_black_dispatch[level] = {((size.x + 1) / 2 + 15) / 16, (size.y + 15) / 16, 1, 0};
+    }
+    reset_header_.single_group_dispatch = {1, 1, 1, 0};
+
+    CreateDescriptorSets();
+    CreatePipeline();
+    UpdateDescriptorSets();
+}
+
+ConvergenceControlPass::~ConvergenceControlPass()
+{
+    if (final_reduction_pipeline_)
+    {
+        final_reduction_pipeline_->destroy();
+    }
+    if (final_reduction_pipeline_layout_)
+    {
+        final_reduction_pipeline_layout_->destroy();
+    }
+    if (descriptor_set_layout_)
+    {
+        descriptor_set_layout_->destroy();
+    }
+}
+
+void ConvergenceControlPass::CreateDescriptorSets()
+{
+    descriptor_set_layout_ = lava::descriptor::make();
+    descriptor_set_layout_->add_binding(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Divergence field
+    descriptor_set_layout_->add_binding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Pressure field
+    descriptor_set_layout_->add_binding(2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Conjugate gradient residual
+    descriptor_set_layout_->add_binding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Boundary map
+    descriptor_set_layout_->add_binding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Convergence control
+
+    if (!descriptor_set_layout_->create(app_.device))
+    {
+        lava::logger()->error("Failed to create convergence control descriptor set layout");
+        throw std::runtime_error("Failed to create convergence control descriptor set layout");
+    }
+
+    descriptor_set_ = descriptor_set_layout_->allocate(descriptor_pool_->get());
+    if (!descriptor_set_)
+    {
+        lava::logger()->error("Failed to allocate convergence control descriptor set");
+        throw std::runtime_error("Failed to allocate convergence control descriptor set");
+    }
+}
+
+void ConvergenceControlPass::UpdateDescriptorSets()
+{
+    VkDescriptorImageInfo divergence_info{.sampler = VK_NULL_HANDLE,
+                                          .imageView = divergence_field_->get_image()->get_view(),
+                                          .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+
+    VkDescriptorImageInfo pressure_info{.sampler = VK_NULL_HANDLE,
+                                        .imageView = pressure_field_->get_image()->get_view(),
+                                        .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+
+    VkDescriptorImageInfo residual_info{.sampler = VK_NULL_HANDLE,
+                                        .imageView = conjugate_gradient_residual_->get_image()->get_view(),
+                                        .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+
+    VkDescriptorImageInfo boundary_info{.sampler = boundary_map_->get_sampler(),
+                                        .imageView = boundary_map_->get_image()->get_view(),
+                                        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+
+    std::vector<VkDescriptorImageInfo> image_infos = {divergence_info, pressure_info, residual_info, boundary_info};
+    std::vector<VkDescriptorType> image_types = {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                 VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                 VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER};
+
+    ComputePass::UpdateDescriptorSets(descriptor_set_, image_infos, image_types);
+
+    std::vector<VkDescriptorBufferInfo> buffer_infos = {*control_buffer_->get_descriptor_info()};
+    std::vector<VkDescriptorType> buffer_types = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER};
+
+    ComputePass::UpdateDescriptorSets(descriptor_set_, buffer_infos, buffer_types,
+                                      static_cast<uint32_t>(image_infos.size()));
+}
+
+void ConvergenceControlPass::CreatePipeline()
+{
+    CreateBasePipeline("ResidualReduction.comp", descriptor_set_layout_, sizeof(ConvergenceConstants));
+    CreateBasePipeline(final_reduction_pipeline_, "ResidualReductionFinal.comp", descriptor_set_layout_,
+                       final_reduction_pipeline_layout_, sizeof(ConvergenceConstants));
+}
+
+void ConvergenceControlPass::InsertIndirectBarrier(VkCommandBuffer cmd_buffer)
+{
+    VkMemoryBarrier barrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                            .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+                            .dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT |
+                                             VK_ACCESS_SHADER_WRITE_BIT};
+
+    vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier,
+                         0, nullptr, 0, nullptr);
+}
+
+void ConvergenceControlPass::Reset(VkCommandBuffer cmd_buffer)
+{
+    // The previous frame's indirect reads and reductions must be done before the arguments are rewritten
+    VkMemoryBarrier barrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                            .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+                            .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT};
+
+    vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    vkCmdUpdateBuffer(cmd_buffer, control_buffer_->get(), 0, offsetof(ConvergenceControlHeader, interior_tile_dispatch),
+                      &reset_header_);
+
+    // The tile list arguments follow the latest classification
+    VkBufferCopy tile_copy{.srcOffset = offsetof(TileClassificationHeader, interior_dispatch),
+                           .dstOffset = offsetof(ConvergenceControlHeader, interior_tile_dispatch),
+                           .size = offsetof(TileClassificationHeader, combined_dispatch)};
+    vkCmdCopyBuffer(cmd_buffer, tile_buffer_->get(), control_buffer_->get(), 1, &tile_copy);
+
+    InsertIndirectBarrier(cmd_buffer);
+}
+
+void ConvergenceControlPass::Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants)
+{
+    CheckResidual(cmd_buffer, constants, ResidualSource::Pressure);
+}
+
+void ConvergenceControlPass::CheckResidual(VkCommandBuffer cmd_buffer, const SimulationConstants &constants,
+                                           ResidualSource source)
+{
+    if (!IsEnabled())
+    {
+        return;
+    }
+
+    divergence_field_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT,
+                                                      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    if (source == ResidualSource::Pressure)
+    {
+        pressure_field_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL,
+                                                        VK_ACCESS_SHADER_READ_BIT,
+                                                        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
+    else
+    {
+        conjugate_gradient_residual_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL,
+                                                                     VK_ACCESS_SHADER_READ_BIT,
+                                                                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
+
+    ConvergenceConstants convergence_constants{};
+    convergence_constants.simulation = constants;
+    convergence_constants.tolerance = tolerance_;
+    convergence_constants.residual_source = static_cast<int>(source);
+    convergence_constants.partial_sum_count =
+        static_cast<int>(reset_header_.level_dispatch[0].x * reset_header_.level_dispatch[0].y);
+
+    // Fused residual and per-workgroup partial sums, skipped as well once an earlier check converged
+    pipeline_->bind(cmd_buffer);
+    vkCmdPushConstants(cmd_buffer, pipeline_layout_->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(ConvergenceConstants), &convergence_constants);
+    vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_->get(), 0, 1,
+                            &descriptor_set_, 0, nullptr);
+    DispatchLevel(cmd_buffer, 0);
+
+    InsertIndirectBarrier(cmd_buffer);
+
+    final_reduction_pipeline_->bind(cmd_buffer);
+    vkCmdPushConstants(cmd_buffer, final_reduction_pipeline_layout_->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(ConvergenceConstants), &convergence_constants);
+    vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, final_reduction_pipeline_layout_->get(), 0,
+                            1, &descriptor_set_, 0, nullptr);
+    DispatchSingleGroup(cmd_buffer);
+
+    InsertIndirectBarrier(cmd_buffer);
+}
+
+void ConvergenceControlPass::DispatchLevel(VkCommandBuffer cmd_buffer, uint32_t level) const
+{
+    vkCmdDispatchIndirect(cmd_buffer, control_buffer_->get(),
+                          offsetof(ConvergenceControlHeader, level_dispatch) + level * sizeof(IndirectDispatch));
+}
+
+void ConvergenceControlPass::DispatchRedBlack(VkCommandBuffer cmd_buffer, uint32_t level) const
+{
+    vkCmdDispatchIndirect(cmd_buffer, control_buffer_->get(),
+                          offsetof(ConvergenceControlHeader, red_black_dispatch) + level * sizeof(IndirectDispatch));
+}
+
+void ConvergenceControlPass::DispatchTiles(VkCommandBuffer cmd_buffer, TileClass tile_class) const
+{
+    const VkDeviceSize offset = (tile_class == TileClass::Interior)
+                                    ? offsetof(ConvergenceControlHeader, interior_tile_dispatch)
+                                    : offsetof(ConvergenceControlHeader, boundary_tile_dispatch);
+
+    vkCmdDispatchIndirect(cmd_buffer, control_buffer_->get(), offset);
+}
+
+void ConvergenceControlPass::DispatchSingleGroup(VkCommandBuffer cmd_buffer) const
+{
+    vkCmdDispatchIndirect(cmd_buffer, control_buffer_->get(),
+                          offsetof(ConvergenceControlHeader, single_group_dispatch));
+}
+
+} // namespace FluidSimulation
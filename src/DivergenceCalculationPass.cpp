@@ -10,7 +10,8 @@ DivergenceCalculationPass::DivergenceCalculationPass(lava::engine &app, lava::de
 
     advected_velocity_field_ = resource_manager.GetTexture("advected_velocity_field");
     divergence_field_ = resource_manager.GetTexture("divergence_field");
-    obstacle_mask_ = resource_manager.GetTexture("obstacle_mask");
+    obstacle_distance_ = resource_manager.GetTexture("obstacle_distance");
+    tile_buffer_ = resource_manager.GetBuffer("active_tiles");
 
     CreateDescriptorSets();
     CreatePipeline();
@@ -19,6 +20,14 @@ DivergenceCalculationPass::DivergenceCalculationPass(lava::engine &app, lava::de
 
 DivergenceCalculationPass::~DivergenceCalculationPass()
 {
+    if (interior_pipeline_)
+    {
+        interior_pipeline_->destroy();
+    }
+    if (boundary_pipeline_)
+    {
+        boundary_pipeline_->destroy();
+    }
     if (descriptor_set_layout_)
     {
         descriptor_set_layout_->destroy();
@@ -33,7 +42,9 @@ void DivergenceCalculationPass::CreateDescriptorSets()
     descriptor_set_layout_->add_binding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
                                         VK_SHADER_STAGE_COMPUTE_BIT); // Divergence field
     descriptor_set_layout_->add_binding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                        VK_SHADER_STAGE_COMPUTE_BIT); // Obstacle mask
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Obstacle distance
+    descriptor_set_layout_->add_binding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Tile lists
 
     if (!descriptor_set_layout_->create(app_.device))
     {
@@ -59,36 +70,40 @@ void DivergenceCalculationPass::UpdateDescriptorSets()
                                                 .imageView = divergence_field_->get_image()->get_view(),
                                                 .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
 
-    VkDescriptorImageInfo obstacle_mask_info{.sampler = obstacle_mask_->get_sampler(),
-                                             .imageView = obstacle_mask_->get_image()->get_view(),
-                                             .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    VkDescriptorImageInfo obstacle_distance_info{.sampler = obstacle_distance_->get_sampler(),
+                                                 .imageView = obstacle_distance_->get_image()->get_view(),
+                                                 .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
 
     std::vector<VkDescriptorImageInfo> image_infos = {advected_velocity_info, divergence_field_info,
-                                                      obstacle_mask_info};
+                                                      obstacle_distance_info};
 
     std::vector<VkDescriptorType> descriptor_types = {
         VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER};
 
     ComputePass::UpdateDescriptorSets(descriptor_set_, image_infos, descriptor_types);
+
+    std::vector<VkDescriptorBufferInfo> buffer_infos = {*tile_buffer_->get_descriptor_info()};
+    std::vector<VkDescriptorType> buffer_types = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER};
+
+    ComputePass::UpdateDescriptorSets(descriptor_set_, buffer_infos, buffer_types,
+                                      static_cast<uint32_t>(image_infos.size()));
 }
 
 void DivergenceCalculationPass::CreatePipeline()
 {
     CreateBasePipeline("DivergenceCalculation.comp", descriptor_set_layout_, sizeof(SimulationConstants));
+    interior_pipeline_ = CreateTilePipeline("DivergenceCalculation.comp", pipeline_layout_, TileClass::Interior);
+    boundary_pipeline_ = CreateTilePipeline("DivergenceCalculation.comp", pipeline_layout_, TileClass::Boundary);
 }
 
 void DivergenceCalculationPass::Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants)
 {
-    advected_velocity_field_->get_image()->transition_layout(
-        cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    barriers_.Transition(advected_velocity_field_, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT);
+    barriers_.Transition(divergence_field_, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT);
+    barriers_.Transition(obstacle_distance_, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT);
+    barriers_.Flush(cmd_buffer);
 
-    divergence_field_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT,
-                                                      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-
-    obstacle_mask_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                                                   VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-
-    pipeline_->bind(cmd_buffer);
+    (tile_lists_ ? interior_pipeline_ : pipeline_)->bind(cmd_buffer);
 
     vkCmdPushConstants(cmd_buffer, pipeline_layout_->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SimulationConstants),
                        &constants);
@@ -96,6 +111,15 @@ void DivergenceCalculationPass::Execute(VkCommandBuffer cmd_buffer, const Simula
     vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_->get(), 0, 1, &descriptor_set_,
                             0, nullptr);
 
+    if (tile_lists_)
+    {
+        // The variants share the layout, so the push constants and the descriptor set stay bound
+        tile_lists_->Dispatch(cmd_buffer, TileClass::Interior);
+        boundary_pipeline_->bind(cmd_buffer);
+        tile_lists_->Dispatch(cmd_buffer, TileClass::Boundary);
+        return;
+    }
+
     uint32_t group_count_x = (constants.texture_width + 15) / 16;
     uint32_t group_count_y = (constants.texture_height + 15) / 16;
     vkCmdDispatch(cmd_buffer, group_count_x, group_count_y, 1);
@@ -8,6 +8,7 @@ FluidRenderer::FluidRenderer(lava::engine &app) : app_(app)
 
     FluidSimulation::ResourceManager::GetInstance(&app).Initialize(&app);
     simulation_ = Simulation::Make(app);
+    async_compute_ = AsyncCompute::Make(app, simulation_);
     AddShaderMappings();
     CreateDescriptorPool();
     CreateDescriptorSets();
@@ -22,6 +23,13 @@ FluidRenderer::~FluidRenderer()
 
 void FluidRenderer::Destroy()
 {
+    // Waits for the steps in flight before anything they use goes away
+    if (async_compute_)
+    {
+        async_compute_->Destroy();
+        async_compute_.reset();
+    }
+
     if (render_descriptor_set_layout_)
     {
         render_descriptor_set_layout_->destroy();
@@ -51,7 +59,7 @@ void FluidRenderer::Destroy()
 
 void FluidRenderer::OnCompute(VkCommandBuffer cmd_buffer, const FrameTimeInfo &frame_context)
 {
-    simulation_->OnUpdate(cmd_buffer, frame_context);
+    async_compute_->Process(cmd_buffer, frame_context);
 }
 
 void FluidRenderer::AddShaderMappings()
@@ -72,7 +80,7 @@ void FluidRenderer::CreateDescriptorPool()
 {
     descriptor_pool_ = lava::descriptor::pool::make();
 
-    constexpr uint32_t set_count = 1;
+    constexpr uint32_t set_count = DISPLAY_SLOT_COUNT;
 
     std::vector<VkDescriptorPoolSize> pool_sizes = {
         VkDescriptorPoolSize{.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 20},
@@ -101,12 +109,15 @@ void FluidRenderer::CreateDescriptorSets()
         throw std::runtime_error("Failed to create render descriptor set layout.");
     }
 
-    render_descriptor_set_ = render_descriptor_set_layout_->allocate(descriptor_pool_->get());
-
-    if (!render_descriptor_set_)
+    for (auto &descriptor_set : render_descriptor_sets_)
     {
-        lava::logger()->error("Failed to allocate render descriptor set.");
-        throw std::runtime_error("Failed to allocate render descriptor set.");
+        descriptor_set = render_descriptor_set_layout_->allocate(descriptor_pool_->get());
+
+        if (!descriptor_set)
+        {
+            lava::logger()->error("Failed to allocate render descriptor set.");
+            throw std::runtime_error("Failed to allocate render descriptor set.");
+        }
     }
 }
 
@@ -114,32 +125,35 @@ void FluidRenderer::UpdateDescriptorSets()
 {
     auto &resource_manager = ResourceManager::GetInstance();
 
-    auto color_texture = resource_manager.GetTexture("color_field_A");
-    VkDescriptorImageInfo color_texture_info = {.sampler = color_texture->get_sampler(),
-                                                .imageView = color_texture->get_image()->get_view(),
-                                                .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
-
-    auto obstacle_mask = resource_manager.GetTexture("obstacle_mask");
-    VkDescriptorImageInfo obstacle_mask_info = {.sampler = obstacle_mask->get_sampler(),
-                                                .imageView = obstacle_mask->get_image()->get_view(),
-                                                .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
-
-    std::vector<VkWriteDescriptorSet> write_descriptor_sets = {
-        VkWriteDescriptorSet{.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                             .dstSet = render_descriptor_set_,
-                             .dstBinding = 0,
-                             .descriptorCount = 1,
-                             .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                             .pImageInfo = &color_texture_info},
-        VkWriteDescriptorSet{.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                             .dstSet = render_descriptor_set_,
-                             .dstBinding = 1,
-                             .descriptorCount = 1,
-                             .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                             .pImageInfo = &obstacle_mask_info}};
-
-    app_.device->vkUpdateDescriptorSets(uint32_t(write_descriptor_sets.size()), write_descriptor_sets.data(), 0,
-                                        nullptr);
+    for (uint32_t slot = 0; slot < DISPLAY_SLOT_COUNT; slot++)
+    {
+        auto color_texture = resource_manager.GetTexture("display_color_" + std::to_string(slot));
+        VkDescriptorImageInfo color_texture_info = {.sampler = color_texture->get_sampler(),
+                                                    .imageView = color_texture->get_image()->get_view(),
+                                                    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+
+        auto obstacle_mask = resource_manager.GetTexture("display_obstacle_" + std::to_string(slot));
+        VkDescriptorImageInfo obstacle_mask_info = {.sampler = obstacle_mask->get_sampler(),
+                                                    .imageView = obstacle_mask->get_image()->get_view(),
+                                                    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+
+        std::vector<VkWriteDescriptorSet> write_descriptor_sets = {
+            VkWriteDescriptorSet{.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                                 .dstSet = render_descriptor_sets_[slot],
+                                 .dstBinding = 0,
+                                 .descriptorCount = 1,
+                                 .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                 .pImageInfo = &color_texture_info},
+            VkWriteDescriptorSet{.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                                 .dstSet = render_descriptor_sets_[slot],
+                                 .dstBinding = 1,
+                                 .descriptorCount = 1,
+                                 .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                 .pImageInfo = &obstacle_mask_info}};
+
+        app_.device->vkUpdateDescriptorSets(uint32_t(write_descriptor_sets.size()), write_descriptor_sets.data(), 0,
+                                            nullptr);
+    }
 }
 
 void FluidRenderer::CreatePipeline()
@@ -186,7 +200,8 @@ void FluidRenderer::CreatePipeline()
     {
         render_pipeline_->bind(cmd_buffer);
         render_pipeline_->set_viewport_and_scissor(cmd_buffer, app_.target->get_size());
-        render_pipeline_layout_->bind(cmd_buffer, render_descriptor_set_, 0, {}, VK_PIPELINE_BIND_POINT_GRAPHICS);
+        render_pipeline_layout_->bind(cmd_buffer, render_descriptor_sets_[async_compute_->GetDisplaySlot()], 0, {},
+                                  VK_PIPELINE_BIND_POINT_GRAPHICS);
 
         vkCmdDraw(cmd_buffer, 3, 1, 0, 0);
     };
@@ -198,7 +213,8 @@ void FluidRenderer::OnRender(uint32_t frame, VkCommandBuffer cmd_buffer)
 
     render_pipeline_->bind(cmd_buffer);
     render_pipeline_->set_viewport_and_scissor(cmd_buffer, app_.target->get_size());
-    render_pipeline_layout_->bind(cmd_buffer, render_descriptor_set_, 0, {}, VK_PIPELINE_BIND_POINT_GRAPHICS);
+    render_pipeline_layout_->bind(cmd_buffer, render_descriptor_sets_[async_compute_->GetDisplaySlot()], 0, {},
+                                  VK_PIPELINE_BIND_POINT_GRAPHICS);
     vkCmdDraw(cmd_buffer, 3, 1, 0, 0);
 
     lava::end_label(cmd_buffer);
@@ -0,0 +1,463 @@
+#include "HeadlessRunner.hpp"
+#include <chrono>
+#include <fstream>
+
+namespace FluidSimulation
+{
+
+namespace
+{
+const std::vector<std::pair<std::string, PressureProjectionMethod>> pressure_projection_method_names{
+    {"jacobi", PressureProjectionMethod::Jacobi},
+    {"poisson_filter", PressureProjectionMethod::Poisson_Filter},
+    {"multigrid", PressureProjectionMethod::Multigrid},
+    {"multigrid_poisson", PressureProjectionMethod::Multigrid_Poisson},
+    {"multigrid_red_black", PressureProjectionMethod::Multigrid_Red_Black},
+    {"multigrid_pcg", PressureProjectionMethod::Multigrid_PCG},
+    {"spectral_dct", PressureProjectionMethod::Spectral_DCT},
+    {"spectral_fft", PressureProjectionMethod::Spectral_FFT}};
+
+const std::vector<std::pair<std::string, MultigridCycleType>> multigrid_cycle_type_names{
+    {"v", MultigridCycleType::V_Cycle},
+    {"w", MultigridCycleType::W_Cycle},
+    {"f", MultigridCycleType::F_Cycle},
+    {"fmg", MultigridCycleType::Full_Multigrid}};
+
+const std::vector<std::pair<std::string, AdvectionScheme>> advection_scheme_names{
+    {"semi_lagrangian", AdvectionScheme::Semi_Lagrangian},
+    {"maccormack", AdvectionScheme::MacCormack}};
+
+const std::vector<std::pair<std::string, BacktraceIntegrator>> backtrace_integrator_names{
+    {"euler", BacktraceIntegrator::Euler},
+    {"rk2", BacktraceIntegrator::RK2},
+    {"rk3", BacktraceIntegrator::RK3}};
+
+PressureProjectionMethod ParsePressureProjectionMethod(const std::string &name)
+{
+    for (auto &&[method_name, method] : pressure_projection_method_names)
+    {
+        if (method_name == name)
+        {
+            return method;
+        }
+    }
+
+    lava::logger()->error("Unknown pressure projection method: {}", name);
+    throw std::invalid_argument("Unknown pressure projection method: " + name);
+}
+
+MultigridCycleType ParseMultigridCycleType(const std::string &name)
+{
+    for (auto &&[cycle_name, cycle_type] : multigrid_cycle_type_names)
+    {
+        if (cycle_name == name)
+        {
+            return cycle_type;
+        }
+    }
+
+    lava::logger()->error("Unknown multigrid cycle: {}", name);
+    throw std::invalid_argument("Unknown multigrid cycle: " + name);
+}
+
+AdvectionScheme ParseAdvectionScheme(const std::string &name)
+{
+    for (auto &&[scheme_name, scheme] : advection_scheme_names)
+    {
+        if (scheme_name == name)
+        {
+            return scheme;
+        }
+    }
+
+    lava::logger()->error("Unknown advection scheme: {}", name);
+    throw std::invalid_argument("Unknown advection scheme: " + name);
+}
+
+BacktraceIntegrator ParseBacktraceIntegrator(const std::string &name)
+{
+    for (auto &&[integrator_name, integrator] : backtrace_integrator_names)
+    {
+        if (integrator_name == name)
+        {
+            return integrator;
+        }
+    }
+
+    lava::logger()->error("Unknown backtrace integrator: {}", name);
+    throw std::invalid_argument("Unknown backtrace integrator: " + name);
+}
+} // namespace
+
+HeadlessRunner::HeadlessRunner(lava::engine &app, const HeadlessRunConfig &config) : app_(app), config_(config)
+{
+    FluidSimulation::ResourceManager::GetInstance(&app).Initialize(&app);
+
+    simulation_ = Simulation::Make(app_, config_.grid_size, config_.precision_policy);
+    if (!simulation_->SetPressureProjectionMethod(config_.pressure_projection_method))
+    {
+        // SetPressureProjectionMethod logged the reason
+        throw std::invalid_argument("Pressure projection method is not available for this grid size");
+    }
+    simulation_->SetAdvectionScheme(config_.advection_scheme);
+    simulation_->SetBacktrace(config_.backtrace);
+    simulation_->SetAdaptiveTimestep(config_.adaptive_timestep);
+    simulation_->SetTargetCFL(config_.target_cfl);
+    simulation_->SetMaxSubsteps(config_.max_substeps);
+    simulation_->SetPressureJacobiIterations(config_.pressure_jacobi_iterations);
+    simulation_->SetJacobiSweepsPerDispatch(config_.jacobi_sweeps_per_dispatch);
+    simulation_->SetChebyshevAcceleration(config_.chebyshev_acceleration);
+    simulation_->SetTileClassification(config_.tile_classification);
+    simulation_->SetSparseSimulation(config_.sparse_simulation);
+    simulation_->SetStepReplay(config_.step_replay);
+    simulation_->SetRelaxationOmega(config_.relaxation_omega);
+    simulation_->SetConjugateGradientIterations(config_.conjugate_gradient_iterations);
+    simulation_->SetMultigridCycleType(config_.multigrid_cycle_type);
+    simulation_->SetMultigridCycles(config_.multigrid_cycles);
+    simulation_->SetMultigridBottomSolver(config_.multigrid_bottom_solver);
+    simulation_->SetPressureTolerance(config_.pressure_tolerance);
+    simulation_->SetPoissonFilter(config_.poisson_filter);
+    simulation_->SetMultigridPoissonFilter(config_.multigrid_poisson_filter);
+}
+
+bool HeadlessRunner::CreateComputeDevice(lava::engine &app)
+{
+    const auto &physical_devices = lava::instance::singleton().get_physical_devices();
+    if (physical_devices.empty())
+    {
+        lava::logger()->error("No physical device available for headless run");
+        return false;
+    }
+
+    lava::index physical_device_index = 0;
+    app.get_cmd_line()({"-pd", "--physical_device"}) >> physical_device_index;
+    if (physical_device_index >= physical_devices.size())
+    {
+        lava::logger()->error("No physical device: {}", physical_device_index);
+        return false;
+    }
+
+    lava::device::create_param param;
+    param.physical_device = physical_devices.at(physical_device_index).get();
+
+    if (!param.add_queue(VK_QUEUE_COMPUTE_BIT))
+    {
+        lava::logger()->error("Physical device exposes no compute queue");
+        return false;
+    }
+
+    if (!Simulation::EnableDeviceFeatures(param))
+    {
+        return false;
+    }
+
+    auto device = app.platform.create(param);
+    if (!device)
+    {
+        lava::logger()->error("Failed to create compute device");
+        return false;
+    }
+
+    app.device = device.get();
+    return true;
+}
+
+HeadlessRunner::s_ptr HeadlessRunner::Make(lava::engine &app, const HeadlessRunConfig &config)
+{
+    try
+    {
+        return std::make_shared<HeadlessRunner>(app, config);
+    }
+    catch (const std::exception &)
+    {
+        // Everything thrown while the simulation is built has been logged where it was raised
+        return nullptr;
+    }
+}
+
+std::optional<HeadlessRunConfig> HeadlessRunner::ParseConfig(lava::cmd_line cmd_line)
+{
+    try
+    {
+        return ReadConfig(cmd_line);
+    }
+    catch (const lava::json::exception &error)
+    {
+        lava::logger()->error("Failed to parse scenario file: {}", error.what());
+        return std::nullopt;
+    }
+    catch (const std::exception &)
+    {
+        return std::nullopt;
+    }
+}
+
+HeadlessRunConfig HeadlessRunner::ReadConfig(lava::cmd_line cmd_line)
+{
+    HeadlessRunConfig config;
+
+    const std::string scenario_path = lava::get_cmd(cmd_line, {"-sc", "--scenario"});
+    if (!scenario_path.empty())
+    {
+        std::ifstream scenario_file(scenario_path);
+        if (!scenario_file.is_open())
+        {
+            lava::logger()->error("Failed to open scenario file: {}", scenario_path);
+            throw std::runtime_error("Failed to open scenario file: " + scenario_path);
+        }
+
+        const lava::json scenario = lava::json::parse(scenario_file);
+
+        config.grid_size.x = scenario.value("width", config.grid_size.x);
+        config.grid_size.y = scenario.value("height", config.grid_size.y);
+        config.steps = scenario.value("steps", config.steps);
+        config.delta_time = scenario.value("dt", config.delta_time);
+        config.steps_per_submit = scenario.value("steps_per_submit", config.steps_per_submit);
+        config.pressure_jacobi_iterations = scenario.value("jacobi_iterations", config.pressure_jacobi_iterations);
+        config.jacobi_sweeps_per_dispatch = scenario.value("jacobi_sweeps", config.jacobi_sweeps_per_dispatch);
+        config.chebyshev_acceleration = scenario.value("chebyshev", config.chebyshev_acceleration);
+        config.tile_classification = scenario.value("tile_classification", config.tile_classification);
+        config.sparse_simulation = scenario.value("sparse_simulation", config.sparse_simulation);
+        config.step_replay = scenario.value("step_replay", config.step_replay);
+        config.relaxation_omega = scenario.value("omega", config.relaxation_omega);
+        config.conjugate_gradient_iterations = scenario.value("cg_iterations", config.conjugate_gradient_iterations);
+        config.multigrid_cycles = scenario.value("cycles", config.multigrid_cycles);
+        config.multigrid_bottom_solver = scenario.value("bottom_solver", config.multigrid_bottom_solver);
+        config.pressure_tolerance = scenario.value("tolerance", config.pressure_tolerance);
+        config.poisson_filter.order = scenario.value("filter_order", config.poisson_filter.order);
+        config.poisson_filter.ranks = scenario.value("filter_ranks", config.poisson_filter.ranks);
+        config.multigrid_poisson_filter.order =
+            scenario.value("multigrid_filter_order", config.multigrid_poisson_filter.order);
+        config.multigrid_poisson_filter.ranks =
+            scenario.value("multigrid_filter_ranks", config.multigrid_poisson_filter.ranks);
+        config.backtrace.substeps = scenario.value("substeps", config.backtrace.substeps);
+        config.adaptive_timestep = scenario.value("adaptive_timestep", config.adaptive_timestep);
+        config.target_cfl = scenario.value("cfl", config.target_cfl);
+        config.max_substeps = scenario.value("max_substeps", config.max_substeps);
+
+        if (scenario.contains("method"))
+        {
+            config.pressure_projection_method = ParsePressureProjectionMethod(scenario["method"].get<std::string>());
+        }
+
+        if (scenario.contains("advection"))
+        {
+            config.advection_scheme = ParseAdvectionScheme(scenario["advection"].get<std::string>());
+        }
+
+        if (scenario.contains("integrator"))
+        {
+            config.backtrace.integrator = ParseBacktraceIntegrator(scenario["integrator"].get<std::string>());
+        }
+
+        if (scenario.contains("cycle"))
+        {
+            config.multigrid_cycle_type = ParseMultigridCycleType(scenario["cycle"].get<std::string>());
+        }
+
+        if (scenario.contains("precision"))
+        {
+            config.precision_policy = Simulation::ParsePrecisionPolicy(scenario["precision"].get<std::string>());
+        }
+
+        if (scenario.contains("pressure_precision"))
+        {
+            config.precision_policy.pressure =
+                Simulation::ParseFieldPrecision(scenario["pressure_precision"].get<std::string>());
+        }
+
+        if (scenario.contains("divergence_precision"))
+        {
+            config.precision_policy.divergence =
+                Simulation::ParseFieldPrecision(scenario["divergence_precision"].get<std::string>());
+        }
+
+        if (scenario.contains("multigrid_precision"))
+        {
+            config.precision_policy.multigrid =
+                Simulation::ParseFieldPrecision(scenario["multigrid_precision"].get<std::string>());
+        }
+    }
+
+    cmd_line({"-gw", "--grid_width"}) >> config.grid_size.x;
+    cmd_line({"-gh", "--grid_height"}) >> config.grid_size.y;
+    cmd_line({"-n", "--steps"}) >> config.steps;
+    cmd_line({"-ts", "--time_step"}) >> config.delta_time;
+    cmd_line({"-sps", "--steps_per_submit"}) >> config.steps_per_submit;
+    cmd_line({"-ji", "--jacobi_iterations"}) >> config.pressure_jacobi_iterations;
+    cmd_line({"-js", "--jacobi_sweeps"}) >> config.jacobi_sweeps_per_dispatch;
+    cmd_line({"-ch", "--chebyshev"}) >> config.chebyshev_acceleration;
+    cmd_line({"-tc", "--tile_classification"}) >> config.tile_classification;
+    cmd_line({"-sa", "--sparse_simulation"}) >> config.sparse_simulation;
+    cmd_line({"-rp", "--step_replay"}) >> config.step_replay;
+    cmd_line({"-om", "--omega"}) >> config.relaxation_omega;
+    cmd_line({"-ci", "--cg_iterations"}) >> config.conjugate_gradient_iterations;
+    cmd_line({"-cc", "--cycles"}) >> config.multigrid_cycles;
+    cmd_line({"-bs", "--bottom_solver"}) >> config.multigrid_bottom_solver;
+    cmd_line({"-tol", "--tolerance"}) >> config.pressure_tolerance;
+    cmd_line({"-fo", "--filter_order"}) >> config.poisson_filter.order;
+    cmd_line({"-fr", "--filter_ranks"}) >> config.poisson_filter.ranks;
+    cmd_line({"-mfo", "--multigrid_filter_order"}) >> config.multigrid_poisson_filter.order;
+    cmd_line({"-mfr", "--multigrid_filter_ranks"}) >> config.multigrid_poisson_filter.ranks;
+    cmd_line({"-ss", "--substeps"}) >> config.backtrace.substeps;
+    cmd_line({"-at", "--adaptive_timestep"}) >> config.adaptive_timestep;
+    cmd_line({"-cfl", "--cfl"}) >> config.target_cfl;
+    cmd_line({"-ms", "--max_substeps"}) >> config.max_substeps;
+
+    const std::string method_name = lava::get_cmd(cmd_line, {"-m", "--method"});
+    if (!method_name.empty())
+    {
+        config.pressure_projection_method = ParsePressureProjectionMethod(method_name);
+    }
+
+    const std::string advection_name = lava::get_cmd(cmd_line, {"-ad", "--advection"});
+    if (!advection_name.empty())
+    {
+        config.advection_scheme = ParseAdvectionScheme(advection_name);
+    }
+
+    const std::string integrator_name = lava::get_cmd(cmd_line, {"-in", "--integrator"});
+    if (!integrator_name.empty())
+    {
+        config.backtrace.integrator = ParseBacktraceIntegrator(integrator_name);
+    }
+
+    const std::string cycle_name = lava::get_cmd(cmd_line, {"-cy", "--cycle"});
+    if (!cycle_name.empty())
+    {
+        config.multigrid_cycle_type = ParseMultigridCycleType(cycle_name);
+    }
+
+    const std::string precision_name = lava::get_cmd(cmd_line, {"-pr", "--precision"});
+    if (!precision_name.empty())
+    {
+        config.precision_policy = Simulation::ParsePrecisionPolicy(precision_name);
+    }
+
+    const std::string pressure_precision_name = lava::get_cmd(cmd_line, {"-pp", "--pressure_precision"});
+    if (!pressure_precision_name.empty())
+    {
+        config.precision_policy.pressure = Simulation::ParseFieldPrecision(pressure_precision_name);
+    }
+
+    const std::string divergence_precision_name = lava::get_cmd(cmd_line, {"-dp", "--divergence_precision"});
+    if (!divergence_precision_name.empty())
+    {
+        config.precision_policy.divergence = Simulation::ParseFieldPrecision(divergence_precision_name);
+    }
+
+    const std::string multigrid_precision_name = lava::get_cmd(cmd_line, {"-mp", "--multigrid_precision"});
+    if (!multigrid_precision_name.empty())
+    {
+        config.precision_policy.multigrid = Simulation::ParseFieldPrecision(multigrid_precision_name);
+    }
+
+    if (!(config.delta_time > 0.0f))
+    {
+        lava::logger()->error("Time step must be positive, got {}", config.delta_time);
+        throw std::invalid_argument("Time step must be positive");
+    }
+
+    if (config.grid_size.x == 0 || config.grid_size.y == 0)
+    {
+        lava::logger()->error("Grid size must be non-zero, got {} x {}", config.grid_size.x, config.grid_size.y);
+        throw std::invalid_argument("Grid size must be non-zero");
+    }
+
+    if (!IsSupportedPoissonFilter(config.poisson_filter) || !IsSupportedPoissonFilter(config.multigrid_poisson_filter))
+    {
+        lava::logger()->error("Poisson filter order must be one of 1-8, 10, 16, 24, 32 with 1-8 ranks");
+        throw std::invalid_argument("Poisson filter order must be one of 1-8, 10, 16, 24, 32 with 1-8 ranks");
+    }
+
+    if (config.pressure_jacobi_iterations % 2 != 0)
+    {
+        lava::logger()->error("Jacobi iterations must be even, got {}", config.pressure_jacobi_iterations);
+        throw std::invalid_argument("Jacobi iterations must be even");
+    }
+
+    if (config.jacobi_sweeps_per_dispatch == 0 || config.jacobi_sweeps_per_dispatch > MAX_JACOBI_SWEEPS_PER_DISPATCH)
+    {
+        lava::logger()->error("Jacobi sweeps per dispatch must be between 1 and 8, got {}",
+                              config.jacobi_sweeps_per_dispatch);
+        throw std::invalid_argument("Jacobi sweeps per dispatch must be between 1 and 8");
+    }
+
+    if (!IsSupportedBacktrace(config.backtrace))
+    {
+        lava::logger()->error("Backtrace substeps must be between 1 and 16, got {}", config.backtrace.substeps);
+        throw std::invalid_argument("Backtrace substeps must be between 1 and 16");
+    }
+
+    if (config.target_cfl <= 0.0f || config.max_substeps == 0 || config.max_substeps > MAX_CFL_SUBSTEPS)
+    {
+        lava::logger()->error("Target CFL must be positive with 1 to 8 substeps, got {} with {}", config.target_cfl,
+                              config.max_substeps);
+        throw std::invalid_argument("Target CFL must be positive with 1 to 8 substeps");
+    }
+
+    config.steps_per_submit = std::max(1u, config.steps_per_submit);
+
+    return config;
+}
+
+bool HeadlessRunner::Run()
+{
+    lava::logger()->info("headless run: {} x {} grid, {} steps, dt {}", config_.grid_size.x, config_.grid_size.y,
+                         config_.steps, config_.delta_time);
+
+    if (config_.steps == 0)
+    {
+        return true;
+    }
+
+    const lava::queue &queue = app_.device->get_compute_queue();
+
+    double current_time = 0.0;
+    uint32_t completed_steps = 0;
+    uint64_t submission = 0;
+
+    const auto start_time = std::chrono::steady_clock::now();
+
+    // Several steps are recorded per submission so the device is not starved by per-step fence waits
+    while (completed_steps < config_.steps)
+    {
+        const uint32_t batch_steps = std::min(config_.steps_per_submit, config_.steps - completed_steps);
+
+        // one_time_submit waits for its fence, every earlier submission has finished
+        submission++;
+        simulation_->BeginSubmission(submission, submission - 1);
+
+        const bool submitted = lava::one_time_submit(app_.device, queue,
+                                                     [&](VkCommandBuffer cmd_buffer)
+                                                     {
+                                                         for (uint32_t step = 0; step < batch_steps; step++)
+                                                         {
+                                                             simulation_->StepFixed(cmd_buffer, current_time,
+                                                                                    config_.delta_time);
+                                                             current_time += config_.delta_time;
+                                                         }
+                                                     });
+
+        if (!submitted)
+        {
+            lava::logger()->error("Failed to submit simulation steps {} - {}", completed_steps,
+                                  completed_steps + batch_steps);
+            return false;
+        }
+
+        completed_steps += batch_steps;
+    }
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+    const double seconds = std::max(elapsed.count(), 1e-9);
+    const double cells = static_cast<double>(config_.grid_size.x) * static_cast<double>(config_.grid_size.y);
+
+    lava::logger()->info("headless run: {} steps in {:.3f} s, {:.3f} ms/step, {:.1f} steps/s, {:.1f} Mcells/s",
+                         completed_steps, seconds, seconds * 1000.0 / completed_steps, completed_steps / seconds,
+                         cells * completed_steps / seconds * 1e-6);
+
+    return true;
+}
+
+} // namespace FluidSimulation
@@ -1,4 +1,5 @@
 #include "JacobiPressurePass.hpp"
+#include <algorithm>
 
 namespace FluidSimulation
 {
@@ -10,7 +11,8 @@ JacobiPressurePass::JacobiPressurePass(lava::engine &app, lava::descriptor::pool
     divergence_field_ = resource_manager.GetTexture("divergence_field");
     pressure_field_A_ = resource_manager.GetTexture("pressure_field_A");
     pressure_field_B_ = resource_manager.GetTexture("pressure_field_B");
-    obstacle_mask_ = resource_manager.GetTexture("obstacle_mask");
+    boundary_map_ = resource_manager.GetTexture("boundary_map");
+    tile_buffer_ = resource_manager.GetBuffer("tile_classification");
 
     CreateDescriptorSets();
     CreatePipeline();
@@ -19,6 +21,30 @@ JacobiPressurePass::JacobiPressurePass(lava::engine &app, lava::descriptor::pool
 
 JacobiPressurePass::~JacobiPressurePass()
 {
+    if (interior_pipeline_)
+    {
+        interior_pipeline_->destroy();
+    }
+    if (boundary_pipeline_)
+    {
+        boundary_pipeline_->destroy();
+    }
+    for (auto &&[halo, pipeline] : tiled_pipelines_)
+    {
+        pipeline->destroy();
+    }
+    if (tiled_pipeline_layout_)
+    {
+        tiled_pipeline_layout_->destroy();
+    }
+    if (chebyshev_pipeline_)
+    {
+        chebyshev_pipeline_->destroy();
+    }
+    if (chebyshev_pipeline_layout_)
+    {
+        chebyshev_pipeline_layout_->destroy();
+    }
     if (descriptor_set_layout_)
     {
         descriptor_set_layout_->destroy();
@@ -35,7 +61,9 @@ void JacobiPressurePass::CreateDescriptorSets()
     descriptor_set_layout_->add_binding(2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
                                         VK_SHADER_STAGE_COMPUTE_BIT); // Pressure field B
     descriptor_set_layout_->add_binding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                        VK_SHADER_STAGE_COMPUTE_BIT); // Obstacle mask
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Boundary map
+    descriptor_set_layout_->add_binding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Tile lists
 
     if (!descriptor_set_layout_->create(app_.device))
     {
@@ -65,13 +93,13 @@ void JacobiPressurePass::UpdateDescriptorSets()
                                                 .imageView = pressure_field_B_->get_image()->get_view(),
                                                 .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
 
-    VkDescriptorImageInfo obstacle_mask_info{.sampler = obstacle_mask_->get_sampler(),
-                                             .imageView = obstacle_mask_->get_image()->get_view(),
-                                             .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    VkDescriptorImageInfo boundary_map_info{.sampler = boundary_map_->get_sampler(),
+                                            .imageView = boundary_map_->get_image()->get_view(),
+                                            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
 
     // Update set A
     std::vector<VkDescriptorImageInfo> image_infos_A = {divergence_field_info, pressure_field_A_info,
-                                                        pressure_field_B_info, obstacle_mask_info};
+                                                        pressure_field_B_info, boundary_map_info};
 
     std::vector<VkDescriptorType> descriptor_types = {
         VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
@@ -81,52 +109,235 @@ void JacobiPressurePass::UpdateDescriptorSets()
 
     // Update set B
     std::vector<VkDescriptorImageInfo> image_infos_B = {divergence_field_info, pressure_field_B_info,
-                                                        pressure_field_A_info, obstacle_mask_info};
+                                                        pressure_field_A_info, boundary_map_info};
 
     ComputePass::UpdateDescriptorSets(descriptor_set_B_, image_infos_B, descriptor_types);
+
+    std::vector<VkDescriptorBufferInfo> buffer_infos = {*tile_buffer_->get_descriptor_info()};
+    std::vector<VkDescriptorType> buffer_types = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER};
+
+    const uint32_t first_buffer_binding = static_cast<uint32_t>(image_infos_A.size());
+    ComputePass::UpdateDescriptorSets(descriptor_set_A_, buffer_infos, buffer_types, first_buffer_binding);
+    ComputePass::UpdateDescriptorSets(descriptor_set_B_, buffer_infos, buffer_types, first_buffer_binding);
 }
 
 void JacobiPressurePass::CreatePipeline()
 {
     CreateBasePipeline("PressureProjectionJacobi.comp", descriptor_set_layout_, sizeof(SimulationConstants));
+    interior_pipeline_ = CreateTilePipeline("PressureProjectionJacobi.comp", pipeline_layout_, TileClass::Interior);
+    boundary_pipeline_ = CreateTilePipeline("PressureProjectionJacobi.comp", pipeline_layout_, TileClass::Boundary);
+    tiled_pipeline_layout_ = CreatePipelineLayout(descriptor_set_layout_, sizeof(TiledJacobiConstants));
+
+    chebyshev_pipeline_ = lava::compute_pipeline::make(app_.device, app_.pipeline_cache);
+    CreateBasePipeline(chebyshev_pipeline_, "PressureProjectionChebyshev.comp", descriptor_set_layout_,
+                       chebyshev_pipeline_layout_, sizeof(ChebyshevConstants));
+}
+
+void JacobiPressurePass::SetSweepsPerDispatch(uint32_t sweeps_per_dispatch)
+{
+    sweeps_per_dispatch_ = std::clamp(sweeps_per_dispatch, 1u, MAX_JACOBI_SWEEPS_PER_DISPATCH);
+    if (sweeps_per_dispatch_ > 1)
+    {
+        GetTiledPipeline(sweeps_per_dispatch_);
+    }
+}
+
+lava::compute_pipeline::s_ptr JacobiPressurePass::GetTiledPipeline(uint32_t halo)
+{
+    auto &pipeline = tiled_pipelines_[halo];
+    if (!pipeline)
+    {
+        const int32_t halo_constant = static_cast<int32_t>(halo);
+        const std::vector<VkSpecializationMapEntry> entries = {{0, 0, sizeof(int32_t)}};
+
+        pipeline = CreateSpecializedPipeline("PressureProjectionJacobiTiled.comp", tiled_pipeline_layout_, entries,
+                                             lava::c_data(&halo_constant, sizeof(int32_t)));
+    }
+
+    return pipeline;
+}
+
+void JacobiPressurePass::DispatchGrid(VkCommandBuffer cmd_buffer, const SimulationConstants &constants)
+{
+    if (convergence_control_)
+    {
+        convergence_control_->DispatchLevel(cmd_buffer, 0);
+    }
+    else
+    {
+        uint32_t group_count_x = (constants.texture_width + 15) / 16;
+        uint32_t group_count_y = (constants.texture_height + 15) / 16;
+        vkCmdDispatch(cmd_buffer, group_count_x, group_count_y, 1);
+    }
+}
+
+void JacobiPressurePass::DispatchTiles(VkCommandBuffer cmd_buffer, TileClass tile_class)
+{
+    if (convergence_control_)
+    {
+        convergence_control_->DispatchTiles(cmd_buffer, tile_class);
+    }
+    else
+    {
+        tile_classification_->Dispatch(cmd_buffer, tile_class);
+    }
 }
 
 void JacobiPressurePass::Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants)
 {
-    divergence_field_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT,
-                                                      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    if (pressure_jacobi_iterations_ == 0)
+    {
+        return;
+    }
+
+    // Flushed together with the transitions of the first sweep
+    barriers_.Transition(divergence_field_, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT);
 
-    pipeline_->bind(cmd_buffer);
+    // The recurrence needs the previous iterate of every cell, which a tile only has for its own sweeps
+    if (chebyshev_acceleration_)
+    {
+        ExecuteChebyshev(cmd_buffer, constants);
+        return;
+    }
 
-    vkCmdPushConstants(cmd_buffer, pipeline_layout_->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SimulationConstants),
-                       &constants);
+    if (sweeps_per_dispatch_ > 1)
+    {
+        ExecuteTiled(cmd_buffer, constants);
+        return;
+    }
 
     for (uint32_t i = 0; i < pressure_jacobi_iterations_; i++)
     {
         uint32_t phase = i % 2;
 
-        pressure_field_A_->get_image()->transition_layout(
-            cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, phase ? VK_ACCESS_SHADER_WRITE_BIT : VK_ACCESS_SHADER_READ_BIT,
-            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        barriers_.Transition(pressure_field_A_, VK_IMAGE_LAYOUT_GENERAL,
+                             phase ? VK_ACCESS_SHADER_WRITE_BIT : VK_ACCESS_SHADER_READ_BIT);
+        barriers_.Transition(pressure_field_B_, VK_IMAGE_LAYOUT_GENERAL,
+                             phase ? VK_ACCESS_SHADER_READ_BIT : VK_ACCESS_SHADER_WRITE_BIT);
+        barriers_.Flush(cmd_buffer);
 
-        pressure_field_B_->get_image()->transition_layout(
-            cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, phase ? VK_ACCESS_SHADER_READ_BIT : VK_ACCESS_SHADER_WRITE_BIT,
-            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        // Rebound every iteration since a convergence check may have bound its own pipeline in between
+        (tile_classification_ ? interior_pipeline_ : pipeline_)->bind(cmd_buffer);
+
+        vkCmdPushConstants(cmd_buffer, pipeline_layout_->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                           sizeof(SimulationConstants), &constants);
 
         VkDescriptorSet active_set = phase ? descriptor_set_B_ : descriptor_set_A_;
         vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_->get(), 0, 1, &active_set,
                                 0, nullptr);
 
-        uint32_t group_count_x = (constants.texture_width + 15) / 16;
-        uint32_t group_count_y = (constants.texture_height + 15) / 16;
-        vkCmdDispatch(cmd_buffer, group_count_x, group_count_y, 1);
+        // The two lists cover disjoint tiles of the same sweep, no barrier is needed between them
+        if (tile_classification_)
+        {
+            DispatchTiles(cmd_buffer, TileClass::Interior);
+            boundary_pipeline_->bind(cmd_buffer);
+            DispatchTiles(cmd_buffer, TileClass::Boundary);
+        }
+        else
+        {
+            DispatchGrid(cmd_buffer, constants);
+        }
+
+        // Checked only after an even number of iterations, where texture A holds the latest pressure
+        const bool last_iteration = (i + 1 == pressure_jacobi_iterations_);
+        if (convergence_control_ && !last_iteration && (i + 1) % convergence_check_interval_ == 0)
+        {
+            convergence_control_->Execute(cmd_buffer, constants);
+        }
+    }
+}
+
+void JacobiPressurePass::ExecuteTiled(VkCommandBuffer cmd_buffer, const SimulationConstants &constants)
+{
+    // An even dispatch count leaves the result in texture A, the sweeps are spread evenly so none exceeds the halo
+    uint32_t dispatch_count = (pressure_jacobi_iterations_ + sweeps_per_dispatch_ - 1) / sweeps_per_dispatch_;
+    dispatch_count += dispatch_count % 2;
+
+    auto pipeline = GetTiledPipeline(sweeps_per_dispatch_);
+
+    TiledJacobiConstants tiled_constants{};
+    tiled_constants.simulation = constants;
+
+    uint32_t completed_sweeps = 0;
+    uint32_t next_check = convergence_check_interval_;
+
+    for (uint32_t i = 0; i < dispatch_count; i++)
+    {
+        uint32_t phase = i % 2;
+
+        barriers_.Transition(pressure_field_A_, VK_IMAGE_LAYOUT_GENERAL,
+                             phase ? VK_ACCESS_SHADER_WRITE_BIT : VK_ACCESS_SHADER_READ_BIT);
+        barriers_.Transition(pressure_field_B_, VK_IMAGE_LAYOUT_GENERAL,
+                             phase ? VK_ACCESS_SHADER_READ_BIT : VK_ACCESS_SHADER_WRITE_BIT);
+        barriers_.Flush(cmd_buffer);
+
+        const uint32_t sweeps = pressure_jacobi_iterations_ * (i + 1) / dispatch_count -
+                                pressure_jacobi_iterations_ * i / dispatch_count;
+        tiled_constants.sweeps = static_cast<int>(sweeps);
+
+        pipeline->bind(cmd_buffer);
+
+        vkCmdPushConstants(cmd_buffer, tiled_pipeline_layout_->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                           sizeof(TiledJacobiConstants), &tiled_constants);
+
+        VkDescriptorSet active_set = phase ? descriptor_set_B_ : descriptor_set_A_;
+        vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, tiled_pipeline_layout_->get(), 0, 1,
+                                &active_set, 0, nullptr);
+
+        DispatchGrid(cmd_buffer, constants);
+
+        completed_sweeps += sweeps;
+
+        // Same cadence as the untiled path, rounded to the next dispatch that leaves the result in texture A
+        const bool last_dispatch = (i + 1 == dispatch_count);
+        if (convergence_control_ && phase == 1 && !last_dispatch && completed_sweeps >= next_check)
+        {
+            convergence_control_->Execute(cmd_buffer, constants);
+            next_check = completed_sweeps + convergence_check_interval_;
+        }
     }
+}
+
+void JacobiPressurePass::ExecuteChebyshev(VkCommandBuffer cmd_buffer, const SimulationConstants &constants)
+{
+    const auto weights = CalculateChebyshevWeights(
+        ChebyshevSpectrumLowerBound(constants.texture_width, constants.texture_height), CHEBYSHEV_SPECTRUM_UPPER_BOUND,
+        pressure_jacobi_iterations_);
 
-    // Swap textures by handles since the final result is always stored in texture A
-    if (pressure_jacobi_iterations_ % 2 != 0)
+    ChebyshevConstants chebyshev_constants{};
+    chebyshev_constants.simulation = constants;
+
+    for (uint32_t i = 0; i < pressure_jacobi_iterations_; i++)
     {
-        std::swap(pressure_field_A_, pressure_field_B_);
+        uint32_t phase = i % 2;
+
+        // The written texture is read first, it still holds the iterate before the one being read
+        const VkAccessFlags write_access = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        const VkAccessFlags read_access = VK_ACCESS_SHADER_READ_BIT;
+        barriers_.Transition(pressure_field_A_, VK_IMAGE_LAYOUT_GENERAL, phase ? write_access : read_access);
+        barriers_.Transition(pressure_field_B_, VK_IMAGE_LAYOUT_GENERAL, phase ? read_access : write_access);
+        barriers_.Flush(cmd_buffer);
+
+        chebyshev_constants.previous_weight = weights[i][0];
+        chebyshev_constants.jacobi_weight = weights[i][1];
+
+        chebyshev_pipeline_->bind(cmd_buffer);
+
+        vkCmdPushConstants(cmd_buffer, chebyshev_pipeline_layout_->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                           sizeof(ChebyshevConstants), &chebyshev_constants);
+
+        VkDescriptorSet active_set = phase ? descriptor_set_B_ : descriptor_set_A_;
+        vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, chebyshev_pipeline_layout_->get(), 0, 1,
+                                &active_set, 0, nullptr);
+
+        DispatchGrid(cmd_buffer, constants);
+
+        const bool last_iteration = (i + 1 == pressure_jacobi_iterations_);
+        if (convergence_control_ && !last_iteration && (i + 1) % convergence_check_interval_ == 0)
+        {
+            convergence_control_->Execute(cmd_buffer, constants);
+        }
     }
 }
 
-} // namespace FluidSimulation
\ No newline at end of file
+} // namespace FluidSimulation
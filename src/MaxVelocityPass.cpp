@@ -0,0 +1,169 @@
+#include "MaxVelocityPass.hpp"
+#include <bit>
+#include <cmath>
+
+namespace FluidSimulation
+{
+
+MaxVelocityPass::MaxVelocityPass(lava::engine &app, lava::descriptor::pool::s_ptr pool) : ComputePass(app, pool)
+{
+    auto &resource_manager = ResourceManager::GetInstance();
+
+    velocity_field_ = resource_manager.GetTexture("velocity_field");
+    readback_buffer_ = resource_manager.GetBuffer("max_velocity_readback");
+
+    CreateDescriptorSets();
+    CreatePipeline();
+    UpdateDescriptorSets();
+}
+
+MaxVelocityPass::~MaxVelocityPass()
+{
+    if (descriptor_set_layout_)
+    {
+        descriptor_set_layout_->destroy();
+    }
+}
+
+void MaxVelocityPass::CreateDescriptorSets()
+{
+    descriptor_set_layout_ = lava::descriptor::make();
+    descriptor_set_layout_->add_binding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Velocity field
+    descriptor_set_layout_->add_binding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Readback ring
+
+    if (!descriptor_set_layout_->create(app_.device))
+    {
+        lava::logger()->error("Failed to create max velocity descriptor set layout");
+        throw std::runtime_error("Failed to create max velocity descriptor set layout");
+    }
+
+    descriptor_set_ = descriptor_set_layout_->allocate(descriptor_pool_->get());
+    if (!descriptor_set_)
+    {
+        lava::logger()->error("Failed to allocate max velocity descriptor set");
+        throw std::runtime_error("Failed to allocate max velocity descriptor set");
+    }
+}
+
+void MaxVelocityPass::UpdateDescriptorSets()
+{
+    VkDescriptorImageInfo velocity_field_info{.sampler = velocity_field_->get_sampler(),
+                                              .imageView = velocity_field_->get_image()->get_view(),
+                                              .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+
+    ComputePass::UpdateDescriptorSets(descriptor_set_, {velocity_field_info},
+                                      {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER});
+
+    std::vector<VkDescriptorBufferInfo> buffer_infos = {*readback_buffer_->get_descriptor_info()};
+    std::vector<VkDescriptorType> buffer_types = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER};
+
+    ComputePass::UpdateDescriptorSets(descriptor_set_, buffer_infos, buffer_types, 1);
+}
+
+void MaxVelocityPass::CreatePipeline()
+{
+    CreateBasePipeline("MaxVelocityReduction.comp", descriptor_set_layout_, sizeof(MaxVelocityConstants));
+}
+
+void MaxVelocityPass::Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants)
+{
+    const uint32_t slot = static_cast<uint32_t>(recorded_frames_ % MAX_VELOCITY_READBACK_FRAMES);
+
+    velocity_field_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                                    VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    // The slot's previous reduction was read MAX_VELOCITY_READBACK_FRAMES frames ago, headless runs record several
+    // frames into one command buffer so its atomics still have to be ordered before the clear
+    VkMemoryBarrier clear_barrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                  .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+                                  .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT};
+
+    vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1,
+                         &clear_barrier, 0, nullptr, 0, nullptr);
+
+    vkCmdFillBuffer(cmd_buffer, readback_buffer_->get(), slot * sizeof(uint32_t), sizeof(uint32_t), 0);
+
+    VkMemoryBarrier reduction_barrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                      .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                                      .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
+
+    vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                         &reduction_barrier, 0, nullptr, 0, nullptr);
+
+    MaxVelocityConstants max_velocity_constants{};
+    max_velocity_constants.simulation = constants;
+    max_velocity_constants.readback_slot = static_cast<int>(slot);
+
+    pipeline_->bind(cmd_buffer);
+
+    vkCmdPushConstants(cmd_buffer, pipeline_layout_->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(MaxVelocityConstants), &max_velocity_constants);
+
+    vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_->get(), 0, 1, &descriptor_set_,
+                            0, nullptr);
+
+    uint32_t group_count_x = (constants.texture_width + 15) / 16;
+    uint32_t group_count_y = (constants.texture_height + 15) / 16;
+    vkCmdDispatch(cmd_buffer, group_count_x, group_count_y, 1);
+
+    VkMemoryBarrier host_barrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                 .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+                                 .dstAccessMask = VK_ACCESS_HOST_READ_BIT};
+
+    vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1,
+                         &host_barrier, 0, nullptr, 0, nullptr);
+
+    recorded_frames_++;
+    slot_submissions_[slot] = submission_;
+    slot_frames_[slot] = recorded_frames_;
+}
+
+bool MaxVelocityPass::ReadMaxVelocity(float &max_velocity)
+{
+    // Headless runs record several reductions per submission, every slot may belong to the one still in flight
+    std::optional<uint32_t> newest_slot;
+    for (uint32_t slot = 0; slot < MAX_VELOCITY_READBACK_FRAMES; slot++)
+    {
+        const bool finished = slot_submissions_[slot] != 0 && slot_submissions_[slot] <= completed_submission_;
+        if (finished && slot_frames_[slot] > read_frame_ &&
+            (!newest_slot || slot_frames_[slot] > slot_frames_[*newest_slot]))
+        {
+            newest_slot = slot;
+        }
+    }
+
+    if (newest_slot)
+    {
+        const uint32_t slot = *newest_slot;
+        read_frame_ = slot_frames_[slot];
+
+        vmaInvalidateAllocation(app_.device->alloc(), readback_buffer_->get_allocation(), slot * sizeof(uint32_t),
+                                sizeof(uint32_t));
+
+        // Speeds are non-negative, their bit patterns order like the floats so the shader reduces them as integers
+        const auto *slots = static_cast<const uint32_t *>(readback_buffer_->get_mapped_data());
+        const float reading = std::bit_cast<float>(slots[slot]);
+
+        // A diverged field reduces to NaN or infinity, the plan keeps the last usable speed instead
+        if (std::isfinite(reading) && reading >= 0.0f)
+        {
+            max_velocity_ = reading;
+        }
+        else
+        {
+            lava::logger()->warn("Discarding max velocity reading {}", reading);
+        }
+    }
+
+    if (!max_velocity_)
+    {
+        return false;
+    }
+
+    max_velocity = *max_velocity_;
+    return true;
+}
+
+} // namespace FluidSimulation
@@ -0,0 +1,202 @@
+#include "MixedPrecisionRefinementPass.hpp"
+
+namespace FluidSimulation
+{
+
+MixedPrecisionRefinementPass::MixedPrecisionRefinementPass(lava::engine &app, lava::descriptor::pool::s_ptr pool,
+                                                           uint32_t multigrid_levels)
+    : ComputePass(app, pool)
+{
+    auto &resource_manager = ResourceManager::GetInstance();
+
+    divergence_field_ = resource_manager.GetTexture("divergence_field");
+    pressure_field_ = resource_manager.GetTexture("pressure_field_A");
+    refinement_residual_ = resource_manager.GetTexture("refinement_residual");
+    refinement_correction_ = resource_manager.GetTexture("refinement_correction_A");
+    boundary_map_ = resource_manager.GetTexture("boundary_map");
+
+    // The correction starts from zero every step, it only has to resolve the current residual
+    correction_solver_ = VCyclePressurePass::Make(
+        app, pool, multigrid_levels, {"refinement_residual", "refinement_correction_A", "refinement_correction_B"});
+    correction_solver_->SetVCycleIterations(1);
+    correction_solver_->SetZeroInitialGuess(true);
+
+    CreateDescriptorSets();
+    CreatePipeline();
+    UpdateDescriptorSets();
+}
+
+MixedPrecisionRefinementPass::~MixedPrecisionRefinementPass()
+{
+    for (auto *pipeline : {&residual_pipeline_, &correction_pipeline_})
+    {
+        if (*pipeline)
+        {
+            (*pipeline)->destroy();
+        }
+    }
+
+    for (auto *pipeline_layout : {&residual_pipeline_layout_, &correction_pipeline_layout_})
+    {
+        if (*pipeline_layout)
+        {
+            (*pipeline_layout)->destroy();
+        }
+    }
+
+    for (auto *descriptor_set_layout : {&residual_descriptor_set_layout_, &correction_descriptor_set_layout_})
+    {
+        if (*descriptor_set_layout)
+        {
+            (*descriptor_set_layout)->destroy();
+        }
+    }
+}
+
+void MixedPrecisionRefinementPass::CreateDescriptorSets()
+{
+    residual_descriptor_set_layout_ = lava::descriptor::make();
+    residual_descriptor_set_layout_->add_binding(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                 VK_SHADER_STAGE_COMPUTE_BIT); // Divergence field
+    residual_descriptor_set_layout_->add_binding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                 VK_SHADER_STAGE_COMPUTE_BIT); // Pressure field
+    residual_descriptor_set_layout_->add_binding(2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                 VK_SHADER_STAGE_COMPUTE_BIT); // Refinement residual
+    residual_descriptor_set_layout_->add_binding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                 VK_SHADER_STAGE_COMPUTE_BIT); // Boundary map
+
+    if (!residual_descriptor_set_layout_->create(app_.device))
+    {
+        lava::logger()->error("Failed to create refinement residual descriptor set layout");
+        throw std::runtime_error("Failed to create refinement residual descriptor set layout");
+    }
+
+    correction_descriptor_set_layout_ = lava::descriptor::make();
+    correction_descriptor_set_layout_->add_binding(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                   VK_SHADER_STAGE_COMPUTE_BIT); // Refinement correction
+    correction_descriptor_set_layout_->add_binding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                   VK_SHADER_STAGE_COMPUTE_BIT); // Pressure field
+
+    if (!correction_descriptor_set_layout_->create(app_.device))
+    {
+        lava::logger()->error("Failed to create refinement correction descriptor set layout");
+        throw std::runtime_error("Failed to create refinement correction descriptor set layout");
+    }
+
+    residual_descriptor_set_ = residual_descriptor_set_layout_->allocate(descriptor_pool_->get());
+    correction_descriptor_set_ = correction_descriptor_set_layout_->allocate(descriptor_pool_->get());
+
+    if (!residual_descriptor_set_ || !correction_descriptor_set_)
+    {
+        lava::logger()->error("Failed to allocate mixed precision refinement descriptor sets");
+        throw std::runtime_error("Failed to allocate mixed precision refinement descriptor sets");
+    }
+}
+
+void MixedPrecisionRefinementPass::UpdateDescriptorSets()
+{
+    VkDescriptorImageInfo divergence_info{.sampler = VK_NULL_HANDLE,
+                                          .imageView = divergence_field_->get_image()->get_view(),
+                                          .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+
+    VkDescriptorImageInfo pressure_info{.sampler = VK_NULL_HANDLE,
+                                        .imageView = pressure_field_->get_image()->get_view(),
+                                        .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+
+    VkDescriptorImageInfo residual_info{.sampler = VK_NULL_HANDLE,
+                                        .imageView = refinement_residual_->get_image()->get_view(),
+                                        .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+
+    VkDescriptorImageInfo correction_info{.sampler = VK_NULL_HANDLE,
+                                          .imageView = refinement_correction_->get_image()->get_view(),
+                                          .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+
+    VkDescriptorImageInfo boundary_map_info{.sampler = boundary_map_->get_sampler(),
+                                            .imageView = boundary_map_->get_image()->get_view(),
+                                            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+
+    ComputePass::UpdateDescriptorSets(residual_descriptor_set_,
+                                      {divergence_info, pressure_info, residual_info, boundary_map_info},
+                                      {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                       VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER});
+
+    ComputePass::UpdateDescriptorSets(correction_descriptor_set_, {correction_info, pressure_info},
+                                      {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE});
+}
+
+void MixedPrecisionRefinementPass::CreatePipeline()
+{
+    residual_pipeline_ = lava::compute_pipeline::make(app_.device, app_.pipeline_cache);
+    CreateBasePipeline(residual_pipeline_, "RefinementResidual.comp", residual_descriptor_set_layout_,
+                       residual_pipeline_layout_, sizeof(SimulationConstants));
+
+    correction_pipeline_ = lava::compute_pipeline::make(app_.device, app_.pipeline_cache);
+    CreateBasePipeline(correction_pipeline_, "RefinementCorrection.comp", correction_descriptor_set_layout_,
+                       correction_pipeline_layout_, sizeof(SimulationConstants));
+}
+
+void MixedPrecisionRefinementPass::DispatchGrid(VkCommandBuffer cmd_buffer, const SimulationConstants &constants)
+{
+    if (convergence_control_)
+    {
+        convergence_control_->DispatchLevel(cmd_buffer, 0);
+    }
+    else
+    {
+        vkCmdDispatch(cmd_buffer, (constants.texture_width + 15) / 16, (constants.texture_height + 15) / 16, 1);
+    }
+}
+
+void MixedPrecisionRefinementPass::CalculateResidual(VkCommandBuffer cmd_buffer, const SimulationConstants &constants)
+{
+    divergence_field_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT,
+                                                      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    pressure_field_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT,
+                                                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    refinement_residual_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL,
+                                                         VK_ACCESS_SHADER_WRITE_BIT,
+                                                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    residual_pipeline_->bind(cmd_buffer);
+    vkCmdPushConstants(cmd_buffer, residual_pipeline_layout_->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(SimulationConstants), &constants);
+    vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, residual_pipeline_layout_->get(), 0, 1,
+                            &residual_descriptor_set_, 0, nullptr);
+
+    DispatchGrid(cmd_buffer, constants);
+}
+
+void MixedPrecisionRefinementPass::ApplyCorrection(VkCommandBuffer cmd_buffer, const SimulationConstants &constants)
+{
+    refinement_correction_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL,
+                                                           VK_ACCESS_SHADER_READ_BIT,
+                                                           VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    pressure_field_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL,
+                                                    VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                                                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    correction_pipeline_->bind(cmd_buffer);
+    vkCmdPushConstants(cmd_buffer, correction_pipeline_layout_->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(SimulationConstants), &constants);
+    vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, correction_pipeline_layout_->get(), 0, 1,
+                            &correction_descriptor_set_, 0, nullptr);
+
+    DispatchGrid(cmd_buffer, constants);
+}
+
+void MixedPrecisionRefinementPass::Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants)
+{
+    for (uint32_t step = 0; step < refinement_steps_; step++)
+    {
+        if (convergence_control_ && step > 0)
+        {
+            convergence_control_->Execute(cmd_buffer, constants);
+        }
+
+        CalculateResidual(cmd_buffer, constants);
+        correction_solver_->Execute(cmd_buffer, constants);
+        ApplyCorrection(cmd_buffer, constants);
+    }
+}
+
+} // namespace FluidSimulation
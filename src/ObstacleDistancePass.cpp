@@ -0,0 +1,173 @@
+#include "ObstacleDistancePass.hpp"
+#include <bit>
+
+namespace FluidSimulation
+{
+namespace
+{
+constexpr int STAGE_SEED = 0;
+constexpr int STAGE_JUMP = 1;
+constexpr int STAGE_JUMP_RESOLVE = 2;
+} // namespace
+
+ObstacleDistancePass::ObstacleDistancePass(lava::engine &app, lava::descriptor::pool::s_ptr pool)
+    : ComputePass(app, pool)
+{
+    auto &resource_manager = ResourceManager::GetInstance();
+
+    obstacle_mask_ = resource_manager.GetTexture("obstacle_mask");
+    obstacle_seeds_A_ = resource_manager.GetTexture("obstacle_seeds_A");
+    obstacle_seeds_B_ = resource_manager.GetTexture("obstacle_seeds_B");
+    obstacle_distance_ = resource_manager.GetTexture("obstacle_distance");
+
+    CreateDescriptorSets();
+    CreatePipeline();
+    UpdateDescriptorSets();
+}
+
+ObstacleDistancePass::~ObstacleDistancePass()
+{
+    if (descriptor_set_layout_)
+    {
+        descriptor_set_layout_->destroy();
+    }
+}
+
+void ObstacleDistancePass::CreateDescriptorSets()
+{
+    descriptor_set_layout_ = lava::descriptor::make();
+    descriptor_set_layout_->add_binding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Obstacle mask
+    descriptor_set_layout_->add_binding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Seeds in
+    descriptor_set_layout_->add_binding(2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Seeds out
+    descriptor_set_layout_->add_binding(3, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Obstacle distance
+
+    if (!descriptor_set_layout_->create(app_.device))
+    {
+        lava::logger()->error("Failed to create obstacle distance descriptor set layout");
+        throw std::runtime_error("Failed to create obstacle distance descriptor set layout");
+    }
+
+    descriptor_set_A_ = descriptor_set_layout_->allocate(descriptor_pool_->get());
+    descriptor_set_B_ = descriptor_set_layout_->allocate(descriptor_pool_->get());
+    if (!descriptor_set_A_ || !descriptor_set_B_)
+    {
+        lava::logger()->error("Failed to allocate obstacle distance descriptor sets");
+        throw std::runtime_error("Failed to allocate obstacle distance descriptor sets");
+    }
+}
+
+void ObstacleDistancePass::UpdateDescriptorSets()
+{
+    VkDescriptorImageInfo obstacle_mask_info{.sampler = obstacle_mask_->get_sampler(),
+                                             .imageView = obstacle_mask_->get_image()->get_view(),
+                                             .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+
+    VkDescriptorImageInfo seeds_A_info{.sampler = VK_NULL_HANDLE,
+                                       .imageView = obstacle_seeds_A_->get_image()->get_view(),
+                                       .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+
+    VkDescriptorImageInfo seeds_B_info{.sampler = VK_NULL_HANDLE,
+                                       .imageView = obstacle_seeds_B_->get_image()->get_view(),
+                                       .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+
+    VkDescriptorImageInfo obstacle_distance_info{.sampler = VK_NULL_HANDLE,
+                                                 .imageView = obstacle_distance_->get_image()->get_view(),
+                                                 .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+
+    std::vector<VkDescriptorType> descriptor_types = {
+        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+        VK_DESCRIPTOR_TYPE_STORAGE_IMAGE};
+
+    ComputePass::UpdateDescriptorSets(descriptor_set_A_,
+                                      {obstacle_mask_info, seeds_A_info, seeds_B_info, obstacle_distance_info},
+                                      descriptor_types);
+
+    ComputePass::UpdateDescriptorSets(descriptor_set_B_,
+                                      {obstacle_mask_info, seeds_B_info, seeds_A_info, obstacle_distance_info},
+                                      descriptor_types);
+}
+
+void ObstacleDistancePass::CreatePipeline()
+{
+    CreateBasePipeline("ObstacleDistance.comp", descriptor_set_layout_, sizeof(ObstacleDistanceConstants));
+}
+
+void ObstacleDistancePass::TransitionSeeds(VkCommandBuffer cmd_buffer)
+{
+    obstacle_seeds_A_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL,
+                                                      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                                                      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    obstacle_seeds_B_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL,
+                                                      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                                                      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+}
+
+void ObstacleDistancePass::Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants)
+{
+    if (!needs_update_)
+    {
+        return;
+    }
+
+    obstacle_mask_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                                   VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    obstacle_distance_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL,
+                                                       VK_ACCESS_SHADER_WRITE_BIT,
+                                                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    pipeline_->bind(cmd_buffer);
+
+    ObstacleDistanceConstants distance_constants{};
+    distance_constants.simulation = constants;
+
+    uint32_t group_count_x = (constants.texture_width + 15) / 16;
+    uint32_t group_count_y = (constants.texture_height + 15) / 16;
+
+    // Seeds start in A, every step reads the texture the previous one wrote
+    bool seeds_in_A = true;
+    auto dispatch = [&](int stage, int step_size, VkDescriptorSet descriptor_set)
+    {
+        TransitionSeeds(cmd_buffer);
+
+        distance_constants.stage = stage;
+        distance_constants.step_size = step_size;
+        vkCmdPushConstants(cmd_buffer, pipeline_layout_->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                           sizeof(ObstacleDistanceConstants), &distance_constants);
+
+        vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_->get(), 0, 1,
+                                &descriptor_set, 0, nullptr);
+
+        vkCmdDispatch(cmd_buffer, group_count_x, group_count_y, 1);
+    };
+
+    dispatch(STAGE_SEED, 0, descriptor_set_B_);
+
+    // Halving steps from half the grid down to one cell, followed by one more single cell step (JFA+1) that fixes
+    // most of the seeds the coarse steps got wrong. The last step also resolves distances and normals
+    const uint32_t max_side = static_cast<uint32_t>(std::max(constants.texture_width, constants.texture_height));
+    std::vector<int> step_sizes;
+    for (uint32_t step_size = std::max(std::bit_ceil(max_side) / 2, 1u); step_size >= 1; step_size /= 2)
+    {
+        step_sizes.push_back(static_cast<int>(step_size));
+    }
+    step_sizes.push_back(1);
+
+    for (size_t i = 0; i < step_sizes.size(); i++)
+    {
+        const int stage = (i + 1 == step_sizes.size()) ? STAGE_JUMP_RESOLVE : STAGE_JUMP;
+        dispatch(stage, step_sizes[i], seeds_in_A ? descriptor_set_A_ : descriptor_set_B_);
+        seeds_in_A = !seeds_in_A;
+    }
+
+    obstacle_distance_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                                       VK_ACCESS_SHADER_READ_BIT,
+                                                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    needs_update_ = false;
+}
+
+} // namespace FluidSimulation
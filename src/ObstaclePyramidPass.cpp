@@ -0,0 +1,117 @@
+#include "ObstaclePyramidPass.hpp"
+
+namespace FluidSimulation
+{
+
+ObstaclePyramidPass::ObstaclePyramidPass(lava::engine &app, lava::descriptor::pool::s_ptr pool, uint32_t max_levels)
+    : ComputePass(app, pool), max_levels_(max_levels)
+{
+    auto &resource_manager = ResourceManager::GetInstance();
+
+    obstacle_masks_.resize(max_levels_);
+    obstacle_masks_[0] = resource_manager.GetTexture("obstacle_mask");
+    for (uint32_t level = 1; level < max_levels_; level++)
+    {
+        obstacle_masks_[level] = resource_manager.GetTexture("obstacle_mask_L" + std::to_string(level));
+    }
+
+    CreateDescriptorSets();
+    CreatePipeline();
+    UpdateDescriptorSets();
+}
+
+ObstaclePyramidPass::~ObstaclePyramidPass()
+{
+    if (descriptor_set_layout_)
+    {
+        descriptor_set_layout_->destroy();
+    }
+}
+
+void ObstaclePyramidPass::CreateDescriptorSets()
+{
+    descriptor_set_layout_ = lava::descriptor::make();
+    descriptor_set_layout_->add_binding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Fine obstacle mask
+    descriptor_set_layout_->add_binding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Coarse obstacle mask
+
+    if (!descriptor_set_layout_->create(app_.device))
+    {
+        lava::logger()->error("Failed to create obstacle pyramid descriptor set layout");
+        throw std::runtime_error("Failed to create obstacle pyramid descriptor set layout");
+    }
+
+    // One set per coarse level, each reads the level above it
+    descriptor_sets_.resize(max_levels_ - 1);
+    for (auto &descriptor_set : descriptor_sets_)
+    {
+        descriptor_set = descriptor_set_layout_->allocate(descriptor_pool_->get());
+        if (!descriptor_set)
+        {
+            lava::logger()->error("Failed to allocate obstacle pyramid descriptor set");
+            throw std::runtime_error("Failed to allocate obstacle pyramid descriptor set");
+        }
+    }
+}
+
+void ObstaclePyramidPass::UpdateDescriptorSets()
+{
+    std::vector<VkDescriptorType> descriptor_types = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                      VK_DESCRIPTOR_TYPE_STORAGE_IMAGE};
+
+    for (uint32_t level = 1; level < max_levels_; level++)
+    {
+        VkDescriptorImageInfo fine_mask_info{.sampler = obstacle_masks_[level - 1]->get_sampler(),
+                                             .imageView = obstacle_masks_[level - 1]->get_image()->get_view(),
+                                             .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+
+        VkDescriptorImageInfo coarse_mask_info{.sampler = VK_NULL_HANDLE,
+                                               .imageView = obstacle_masks_[level]->get_image()->get_view(),
+                                               .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+
+        std::vector<VkDescriptorImageInfo> image_infos = {fine_mask_info, coarse_mask_info};
+
+        ComputePass::UpdateDescriptorSets(descriptor_sets_[level - 1], image_infos, descriptor_types);
+    }
+}
+
+void ObstaclePyramidPass::CreatePipeline()
+{
+    CreateBasePipeline("ObstacleMaskRestriction.comp", descriptor_set_layout_);
+}
+
+void ObstaclePyramidPass::Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants)
+{
+    if (!needs_update_)
+    {
+        return;
+    }
+
+    obstacle_masks_[0]->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                                       VK_ACCESS_SHADER_READ_BIT,
+                                                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    pipeline_->bind(cmd_buffer);
+
+    // Levels are built top down, every level is left readable for the multigrid transfers and smoothers
+    for (uint32_t level = 1; level < max_levels_; level++)
+    {
+        auto coarse_image = obstacle_masks_[level]->get_image();
+        coarse_image->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT,
+                                        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+        vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_->get(), 0, 1,
+                                &descriptor_sets_[level - 1], 0, nullptr);
+
+        const glm::uvec2 size = coarse_image->get_size();
+        vkCmdDispatch(cmd_buffer, (size.x + 15) / 16, (size.y + 15) / 16, 1);
+
+        coarse_image->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                        VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
+
+    needs_update_ = false;
+}
+
+} // namespace FluidSimulation
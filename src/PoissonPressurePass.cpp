@@ -1,4 +1,5 @@
 #include "PoissonPressurePass.hpp"
+#include <cstddef>
 
 namespace FluidSimulation
 {
@@ -9,9 +10,7 @@ PoissonPressurePass::PoissonPressurePass(lava::engine &app, lava::descriptor::po
 
     divergence_field_ = resource_manager.GetTexture("divergence_field");
     pressure_field_ = resource_manager.GetTexture("pressure_field_A");
-    temp_texture_ = resource_manager.GetTexture("temp");
-    temp_texture1_ = resource_manager.GetTexture("temp1");
-    obstacle_mask_ = resource_manager.GetTexture("obstacle_mask");
+    boundary_map_ = resource_manager.GetTexture("boundary_map");
 
     CreateDescriptorSets();
     CreatePipeline();
@@ -20,6 +19,10 @@ PoissonPressurePass::PoissonPressurePass(lava::engine &app, lava::descriptor::po
 
 PoissonPressurePass::~PoissonPressurePass()
 {
+    for (auto &&[filter, pipeline] : filter_pipelines_)
+    {
+        pipeline->destroy();
+    }
     if (descriptor_set_layout_)
     {
         descriptor_set_layout_->destroy();
@@ -33,12 +36,8 @@ void PoissonPressurePass::CreateDescriptorSets()
                                         VK_SHADER_STAGE_COMPUTE_BIT); // Divergence field
     descriptor_set_layout_->add_binding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
                                         VK_SHADER_STAGE_COMPUTE_BIT); // Pressure field
-    descriptor_set_layout_->add_binding(2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
-                                        VK_SHADER_STAGE_COMPUTE_BIT); // Temp texture
-    descriptor_set_layout_->add_binding(3, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
-                                        VK_SHADER_STAGE_COMPUTE_BIT); // Temp texture 1
-    descriptor_set_layout_->add_binding(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                        VK_SHADER_STAGE_COMPUTE_BIT); // Obstacle mask
+    descriptor_set_layout_->add_binding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Boundary map
 
     if (!descriptor_set_layout_->create(app_.device))
     {
@@ -64,31 +63,51 @@ void PoissonPressurePass::UpdateDescriptorSets()
                                               .imageView = pressure_field_->get_image()->get_view(),
                                               .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
 
-    VkDescriptorImageInfo temp_texture_info{.sampler = VK_NULL_HANDLE,
-                                            .imageView = temp_texture_->get_image()->get_view(),
-                                            .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
-
-    VkDescriptorImageInfo temp_texture1_info{.sampler = VK_NULL_HANDLE,
-                                             .imageView = temp_texture1_->get_image()->get_view(),
-                                             .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+    VkDescriptorImageInfo boundary_map_info{.sampler = boundary_map_->get_sampler(),
+                                            .imageView = boundary_map_->get_image()->get_view(),
+                                            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
 
-    VkDescriptorImageInfo obstacle_mask_info{.sampler = obstacle_mask_->get_sampler(),
-                                             .imageView = obstacle_mask_->get_image()->get_view(),
-                                             .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    std::vector<VkDescriptorImageInfo> image_infos = {divergence_field_info, pressure_field_info,
+                                                      boundary_map_info};
 
-    std::vector<VkDescriptorImageInfo> image_infos = {divergence_field_info, pressure_field_info, temp_texture_info,
-                                                      temp_texture1_info, obstacle_mask_info};
-
-    std::vector<VkDescriptorType> descriptor_types = {
-        VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
-        VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER};
+    std::vector<VkDescriptorType> descriptor_types = {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                      VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER};
 
     ComputePass::UpdateDescriptorSets(descriptor_set_, image_infos, descriptor_types);
 }
 
 void PoissonPressurePass::CreatePipeline()
 {
-    CreateBasePipeline("PressureProjectionKernel.comp", descriptor_set_layout_, sizeof(SimulationConstants));
+    pipeline_layout_ = CreatePipelineLayout(descriptor_set_layout_, sizeof(SimulationConstants));
+    GetFilterPipeline(filter_);
+}
+
+void PoissonPressurePass::SetFilter(const PoissonFilterVariant &filter)
+{
+    if (!IsSupportedPoissonFilter(filter))
+    {
+        lava::logger()->error("Unsupported Poisson filter: order {}, {} ranks", filter.order, filter.ranks);
+        throw std::invalid_argument("Unsupported Poisson filter");
+    }
+
+    GetFilterPipeline(filter);
+    filter_ = filter;
+}
+
+lava::compute_pipeline::s_ptr PoissonPressurePass::GetFilterPipeline(const PoissonFilterVariant &filter)
+{
+    auto &pipeline = filter_pipelines_[filter];
+    if (!pipeline)
+    {
+        const std::vector<VkSpecializationMapEntry> entries = {
+            {0, offsetof(PoissonFilterVariant, order), sizeof(int32_t)},
+            {1, offsetof(PoissonFilterVariant, ranks), sizeof(int32_t)}};
+
+        pipeline = CreateSpecializedPipeline("PressureProjectionKernel.comp", pipeline_layout_, entries,
+                                             lava::c_data(&filter, sizeof(PoissonFilterVariant)));
+    }
+
+    return pipeline;
 }
 
 void PoissonPressurePass::Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants)
@@ -99,18 +118,10 @@ void PoissonPressurePass::Execute(VkCommandBuffer cmd_buffer, const SimulationCo
     pressure_field_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT,
                                                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
 
-    temp_texture_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL,
-                                                  VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
-                                                  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-
-    temp_texture1_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL,
-                                                   VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
-                                                   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-
-    obstacle_mask_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                                                   VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    boundary_map_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                                  VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
 
-    pipeline_->bind(cmd_buffer);
+    filter_pipelines_[filter_]->bind(cmd_buffer);
 
     vkCmdPushConstants(cmd_buffer, pipeline_layout_->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SimulationConstants),
                        &constants);
@@ -63,6 +63,17 @@ bool ResourceManager::HasTexture(const std::string &name) const
     return textures_.find(name) != textures_.end();
 }
 
+std::vector<lava::texture::s_ptr> ResourceManager::GetAllTextures() const
+{
+    std::vector<lava::texture::s_ptr> textures;
+    textures.reserve(textures_.size());
+    for (const auto &[name, texture] : textures_)
+    {
+        textures.push_back(texture);
+    }
+    return textures;
+}
+
 void ResourceManager::CreateBuffer(const std::string &name, VkDeviceSize size, VkBufferUsageFlags usage,
                                    VmaMemoryUsage memory_usage)
 {
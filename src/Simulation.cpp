@@ -2,10 +2,28 @@
 
 namespace FluidSimulation
 {
-Simulation::Simulation(lava::engine &app) : app_(app)
+namespace
 {
-    const lava::uv2 window_size = app_.target->get_size();
+VkFormat FieldFormat(FieldPrecision precision)
+{
+    return precision == FieldPrecision::FP32 ? VK_FORMAT_R32_SFLOAT : VK_FORMAT_R16_SFLOAT;
+}
+
+PrecisionPolicy CommandLinePrecisionPolicy(lava::cmd_line cmd_line)
+{
+    const std::string precision_name = lava::get_cmd(cmd_line, {"-pr", "--precision"});
+    return precision_name.empty() ? PrecisionPolicy{} : Simulation::ParsePrecisionPolicy(precision_name);
+}
+} // namespace
+
+Simulation::Simulation(lava::engine &app)
+    : Simulation(app, app.target->get_size(), CommandLinePrecisionPolicy(app.get_cmd_line()))
+{
+}
 
+Simulation::Simulation(lava::engine &app, glm::uvec2 grid_size, const PrecisionPolicy &precision_policy)
+    : app_(app), grid_size_(grid_size), precision_policy_(precision_policy)
+{
     AddShaderMappings();
     CreateTextures();
     CreateBuffers();
@@ -15,6 +33,13 @@ Simulation::Simulation(lava::engine &app) : app_(app)
 
 Simulation::~Simulation()
 {
+    // Destroying the pool frees every recording, retired or not
+    if (recorded_step_pool_)
+    {
+        app_.device->wait_for_idle();
+        app_.device->vkDestroyCommandPool(recorded_step_pool_);
+    }
+
     if (descriptor_pool_)
         descriptor_pool_->destroy();
 
@@ -26,14 +51,30 @@ void Simulation::AddShaderMappings()
     const std::vector<std::pair<std::string, std::string>> file_mappings{
         {"ObstacleMaskFilling.comp", "../shaders/ObstacleMaskFilling.comp"},
 
+        {"ObstacleMaskRestriction.comp", "../shaders/ObstacleMaskRestriction.comp"},
+
+        {"ObstacleDistance.comp", "../shaders/ObstacleDistance.comp"},
+
+        {"BoundaryMap.comp", "../shaders/BoundaryMap.comp"},
+
+        {"TileClassification.comp", "../shaders/TileClassification.comp"},
+
+        {"ActiveTiles.comp", "../shaders/ActiveTiles.comp"},
+
         {"VelocityAdvection.comp", "../shaders/VelocityAdvection.comp"},
 
+        {"MacCormackCorrection.comp", "../shaders/MacCormackCorrection.comp"},
+
         {"DivergenceCalculation.comp", "../shaders/DivergenceCalculation.comp"},
 
         {"PressureProjectionJacobi.comp", "../shaders/PressureProjectionJacobi.comp"},
 
+        {"PressureProjectionJacobiTiled.comp", "../shaders/PressureProjectionJacobiTiled.comp"},
+
         {"PressureProjectionKernel.comp", "../shaders/PressureProjectionKernel.comp"},
 
+        {"PressureProjectionChebyshev.comp", "../shaders/PressureProjectionChebyshev.comp"},
+
         {"VelocityUpdate.comp", "../shaders/VelocityUpdate.comp"},
 
         {"ColorAdvection.comp", "../shaders/ColorAdvection.comp"},
@@ -50,9 +91,36 @@ void Simulation::AddShaderMappings()
 
         {"PressureRelaxationPoisson.comp", "../shaders/PressureRelaxationPoisson.comp"},
 
-        {"ResidualErrorCalculation.comp", "../shaders/ResidualErrorCalculation.comp"},
+        {"PressureRelaxationRedBlack.comp", "../shaders/PressureRelaxationRedBlack.comp"},
+
+        {"PressureBottomSolve.comp", "../shaders/PressureBottomSolve.comp"},
+
+        {"ConjugateGradientInitialize.comp", "../shaders/ConjugateGradientInitialize.comp"},
+
+        {"ConjugateGradientDotProduct.comp", "../shaders/ConjugateGradientDotProduct.comp"},
+
+        {"ConjugateGradientReduce.comp", "../shaders/ConjugateGradientReduce.comp"},
+
+        {"ConjugateGradientUpdateDirection.comp", "../shaders/ConjugateGradientUpdateDirection.comp"},
+
+        {"ConjugateGradientApplyOperator.comp", "../shaders/ConjugateGradientApplyOperator.comp"},
+
+        {"ConjugateGradientUpdateSolution.comp", "../shaders/ConjugateGradientUpdateSolution.comp"},
+
+        {"ConjugateGradientFinalize.comp", "../shaders/ConjugateGradientFinalize.comp"},
+
+
+        {"ResidualReduction.comp", "../shaders/ResidualReduction.comp"},
+
+        {"ResidualReductionFinal.comp", "../shaders/ResidualReductionFinal.comp"},
 
-        {"ResidualReduction.comp", "../shaders/ResidualReduction.comp"}};
+        {"SpectralTransform.comp", "../shaders/SpectralTransform.comp"},
+
+        {"RefinementResidual.comp", "../shaders/RefinementResidual.comp"},
+
+        {"RefinementCorrection.comp", "../shaders/RefinementCorrection.comp"},
+
+        {"MaxVelocityReduction.comp", "../shaders/MaxVelocityReduction.comp"}};
 
     for (auto &&[name, file] : file_mappings)
     {
@@ -63,48 +131,52 @@ void Simulation::AddShaderMappings()
 void Simulation::CreateMultigridTextures(uint32_t max_levels)
 {
     auto &resource_manager = FluidSimulation::ResourceManager::GetInstance(&app_);
+    const VkFormat multigrid_format = FieldFormat(precision_policy_.multigrid);
 
     for (uint32_t level = 0; level < max_levels; level++)
     {
-        glm::uvec2 texture_size{std::max(1u, app_.target->get_size().x / (1 << level)),
-                                std::max(1u, app_.target->get_size().y / (1 << level))};
+        glm::uvec2 texture_size{std::max(1u, grid_size_.x / (1 << level)), std::max(1u, grid_size_.y / (1 << level))};
 
         std::string suffix = "_L" + std::to_string(level);
 
         if (level > 0)
         {
+            // Coarse corrections are cleared before every cycle
+            resource_manager.CreateTexture("pressure_multigrid_A" + suffix,
+                                           {texture_size, multigrid_format,
+                                            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+                                                VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                                            VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR,
+                                            VK_SAMPLER_MIPMAP_MODE_LINEAR});
+
+            resource_manager.CreateTexture("pressure_multigrid_B" + suffix,
+                                           {texture_size, multigrid_format,
+                                            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+                                                VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                                            VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR,
+                                            VK_SAMPLER_MIPMAP_MODE_LINEAR});
+
             resource_manager.CreateTexture(
-                "pressure_multigrid_A" + suffix,
-                {texture_size, VK_FORMAT_R16_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-                 VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_LINEAR});
+                "residual" + suffix,
+                {texture_size, multigrid_format, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                 VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_NEAREST, VK_SAMPLER_MIPMAP_MODE_NEAREST});
 
+            // Solid fraction of the level, sampled like the full resolution obstacle mask
             resource_manager.CreateTexture(
-                "pressure_multigrid_B" + suffix,
+                "obstacle_mask" + suffix,
                 {texture_size, VK_FORMAT_R16_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-                 VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_LINEAR});
+                 VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_NEAREST, VK_SAMPLER_MIPMAP_MODE_NEAREST});
 
             resource_manager.CreateTexture(
-                "residual" + suffix,
-                {texture_size, VK_FORMAT_R16_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                "boundary_map" + suffix,
+                {texture_size, VK_FORMAT_R32_UINT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
                  VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_NEAREST, VK_SAMPLER_MIPMAP_MODE_NEAREST});
         }
-
-        resource_manager.CreateTexture(
-            "multigrid_temp" + suffix,
-            {texture_size, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-             VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_LINEAR});
-
-        resource_manager.CreateTexture(
-            "multigrid_temp1" + suffix,
-            {texture_size, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-             VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_LINEAR});
     }
 }
 
 void Simulation::CreateTextures()
 {
-    const glm::uvec2 window_size = app_.target->get_size();
-
     auto &resource_manager = FluidSimulation::ResourceManager::GetInstance(&app_);
 
     auto create_resource_texture = [&](const std::string &name, VkFormat format, VkImageUsageFlags usage,
@@ -115,68 +187,207 @@ void Simulation::CreateTextures()
         resource_manager.CreateTexture(name, create_info);
     };
 
+    create_resource_texture("obstacle_mask", VK_FORMAT_R8_UNORM,
+                            VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                            VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_NEAREST, VK_SAMPLER_MIPMAP_MODE_NEAREST,
+                            grid_size_);
+
+    // Jump flooding ping-pong of the nearest solid and fluid cell per cell
+    create_resource_texture("obstacle_seeds_A", VK_FORMAT_R16G16B16A16_SINT, VK_IMAGE_USAGE_STORAGE_BIT,
+                            VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_NEAREST, VK_SAMPLER_MIPMAP_MODE_NEAREST,
+                            grid_size_);
+
+    create_resource_texture("obstacle_seeds_B", VK_FORMAT_R16G16B16A16_SINT, VK_IMAGE_USAGE_STORAGE_BIT,
+                            VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_NEAREST, VK_SAMPLER_MIPMAP_MODE_NEAREST,
+                            grid_size_);
+
+    // Signed distance to the obstacle surface in cells and the normal into the obstacle, filtered linearly so
+    // boundary queries between cell centres land on the surface rather than a cell edge
+    create_resource_texture("obstacle_distance", VK_FORMAT_R16G16B16A16_SFLOAT,
+                            VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+                            VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_NEAREST,
+                            grid_size_);
+
+    // Packed cell every pressure stencil read resolves to, see BoundaryMap.glsl
     create_resource_texture(
-        "obstacle_mask", VK_FORMAT_R8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
-        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_NEAREST, VK_SAMPLER_MIPMAP_MODE_NEAREST, window_size);
+        "boundary_map", VK_FORMAT_R32_UINT, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_NEAREST, VK_SAMPLER_MIPMAP_MODE_NEAREST, grid_size_);
+
+    // One texel per 16x16 tile, the motion measured on the tile and whether it was active on the last step
+    for (const char *name : {"tile_motion", "tile_active"})
+    {
+        create_resource_texture(name, VK_FORMAT_R32_UINT, VK_IMAGE_USAGE_STORAGE_BIT,
+                                VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_NEAREST,
+                                VK_SAMPLER_MIPMAP_MODE_NEAREST, (grid_size_ + 15u) / 16u);
+    }
 
     create_resource_texture(
         "velocity_field", VK_FORMAT_R16G16_SFLOAT, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
-        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_LINEAR, window_size);
+        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_LINEAR, grid_size_);
 
     create_resource_texture(
         "advected_velocity_field", VK_FORMAT_R16G16_SFLOAT, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
-        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_LINEAR, window_size);
+        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_LINEAR, grid_size_);
 
+    // First order predictions of MacCormack advection, sampled by the correction kernels
     create_resource_texture(
-        "divergence_field", VK_FORMAT_R16_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_LINEAR, window_size);
+        "predicted_velocity_field", VK_FORMAT_R16G16_SFLOAT, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_LINEAR, grid_size_);
 
     create_resource_texture(
-        "pressure_field_A", VK_FORMAT_R16_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_LINEAR, window_size);
+        "predicted_color_field", VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_LINEAR, grid_size_);
 
-    create_resource_texture(
-        "pressure_field_B", VK_FORMAT_R16_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_LINEAR, window_size);
+    create_resource_texture("divergence_field", FieldFormat(precision_policy_.divergence),
+                            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                            VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_LINEAR,
+                            grid_size_);
 
-    create_resource_texture(
-        "color_field_A", VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_LINEAR, window_size);
+    create_resource_texture("pressure_field_A", FieldFormat(precision_policy_.pressure),
+                            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                            VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_LINEAR,
+                            grid_size_);
+
+    create_resource_texture("pressure_field_B", FieldFormat(precision_policy_.pressure),
+                            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                            VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_LINEAR,
+                            grid_size_);
+
+    create_resource_texture("color_field_A", VK_FORMAT_R8G8B8A8_UNORM,
+                            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                            VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_LINEAR,
+                            grid_size_);
 
     create_resource_texture(
         "color_field_B", VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_LINEAR, window_size);
+        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_LINEAR, grid_size_);
 
-    create_resource_texture(
-        "temp", VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_LINEAR, window_size);
+    // Copied from the dye and the obstacle mask after every step for the window, see AsyncCompute
+    if (!app_.headless)
+    {
+        for (uint32_t slot = 0; slot < DISPLAY_SLOT_COUNT; slot++)
+        {
+            create_resource_texture("display_color_" + std::to_string(slot), VK_FORMAT_R8G8B8A8_UNORM,
+                                    VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                                    VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR,
+                                    VK_SAMPLER_MIPMAP_MODE_LINEAR, grid_size_);
+
+            create_resource_texture("display_obstacle_" + std::to_string(slot), VK_FORMAT_R8_UNORM,
+                                    VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                                    VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_NEAREST,
+                                    VK_SAMPLER_MIPMAP_MODE_NEAREST, grid_size_);
+        }
+    }
 
-    create_resource_texture(
-        "temp1", VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_LINEAR, window_size);
+    // Complex intermediates of the spectral solver, the cosine transform only uses the real part
+    create_resource_texture("spectral_field_A", VK_FORMAT_R32G32_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT,
+                            VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_NEAREST, VK_SAMPLER_MIPMAP_MODE_NEAREST,
+                            grid_size_);
 
-    create_resource_texture("residual", VK_FORMAT_R32_SFLOAT,
-                            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+    create_resource_texture("spectral_field_B", VK_FORMAT_R32G32_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT,
+                            VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_NEAREST, VK_SAMPLER_MIPMAP_MODE_NEAREST,
+                            grid_size_);
+
+    // Conjugate gradient vectors are kept in full precision, the preconditioner runs at the precision of the other
+    // multigrid levels
+    for (const char *name : {"conjugate_gradient_solution", "conjugate_gradient_residual",
+                             "conjugate_gradient_direction", "conjugate_gradient_operator_result"})
+    {
+        create_resource_texture(name, VK_FORMAT_R32_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT,
+                                VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_NEAREST,
+                                VK_SAMPLER_MIPMAP_MODE_NEAREST, grid_size_);
+    }
+
+    create_resource_texture("conjugate_gradient_preconditioner_rhs", FieldFormat(precision_policy_.multigrid),
+                            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
                             VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_NEAREST, VK_SAMPLER_MIPMAP_MODE_NEAREST,
-                            window_size);
+                            grid_size_);
+
+    for (const char *name : {"conjugate_gradient_preconditioned_A", "conjugate_gradient_preconditioned_B"})
+    {
+        create_resource_texture(name, FieldFormat(precision_policy_.multigrid),
+                                VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+                                    VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                                VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR,
+                                VK_SAMPLER_MIPMAP_MODE_LINEAR, grid_size_);
+    }
+
+    // Fine level of the correction solve in mixed precision, the correction is cleared before every cycle
+    if (precision_policy_.mixed_precision)
+    {
+        create_resource_texture("refinement_residual", VK_FORMAT_R16_SFLOAT,
+                                VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                                VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_NEAREST,
+                                VK_SAMPLER_MIPMAP_MODE_NEAREST, grid_size_);
+
+        for (const char *name : {"refinement_correction_A", "refinement_correction_B"})
+        {
+            create_resource_texture(name, VK_FORMAT_R16_SFLOAT,
+                                    VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+                                        VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                                    VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FILTER_LINEAR,
+                                    VK_SAMPLER_MIPMAP_MODE_LINEAR, grid_size_);
+        }
+    }
 
     CreateMultigridTextures(multigrid_levels_);
 }
 
 void Simulation::CreateBuffers()
 {
-    const lava::uv2 texture_size = app_.target->get_size();
+    const lava::uv2 texture_size = grid_size_;
 
     auto &resource_manager = FluidSimulation::ResourceManager::GetInstance(&app_);
-    resource_manager.CreateBuffer("staging_buffer", texture_size.x * texture_size.y * sizeof(float),
-                                  VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+    // Two residual dot products, the direction and stale residual dot products, then one partial sum per workgroup
+    const VkDeviceSize partial_sum_count = ((texture_size.x + 15) / 16) * ((texture_size.y + 15) / 16);
+    resource_manager.CreateBuffer("conjugate_gradient_reduction", (4 + partial_sum_count) * sizeof(float),
+                                  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+
+    // One max speed per readback slot, written by the device and read by the host a few frames later. Zeroed so a
+    // slot never holds garbage, though only slots of finished submissions are read
+    std::array<uint32_t, MAX_VELOCITY_READBACK_FRAMES> max_velocity_slots{};
+    resource_manager.CreateMappedBuffer("max_velocity_readback", max_velocity_slots.data(),
+                                        MAX_VELOCITY_READBACK_FRAMES * sizeof(uint32_t),
+                                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                        VMA_MEMORY_USAGE_GPU_TO_CPU);
+
+    // Indirect dispatch arguments and convergence state, followed by a residual and right hand side partial sum
+    // per workgroup
+    resource_manager.CreateBuffer("pressure_convergence_control",
+                                  sizeof(ConvergenceControlHeader) + partial_sum_count * 2 * sizeof(float),
+                                  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                                      VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                  VMA_MEMORY_USAGE_GPU_ONLY);
+
+    // Interior and boundary dispatch arguments, followed by room for every 16x16 tile in each of the two lists
+    resource_manager.CreateBuffer("tile_classification",
+                                  sizeof(TileClassificationHeader) + partial_sum_count * 2 * sizeof(uint32_t),
+                                  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                                      VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                  VMA_MEMORY_USAGE_GPU_ONLY);
+
+    // The active subset of the tile lists in the same layout
+    resource_manager.CreateBuffer("active_tiles",
+                                  sizeof(TileClassificationHeader) + partial_sum_count * 2 * sizeof(uint32_t),
+                                  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                                      VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                  VMA_MEMORY_USAGE_GPU_ONLY);
+
+    // Written in the command buffer ahead of every frame
+    resource_manager.CreateBuffer("step_time", sizeof(StepTimeConstants),
+                                  VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                  VMA_MEMORY_USAGE_GPU_ONLY);
 }
 
 void Simulation::CreateDescriptorPool()
 {
     descriptor_pool_ = lava::descriptor::pool::make();
-    descriptor_pool_->create(
-        app_.device, {{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 100}, {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 100}}, 100);
+    descriptor_pool_->create(app_.device,
+                             {{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 512},
+                              {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 512},
+                              {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 32},
+                              {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 16}},
+                             512);
 }
 
 void Simulation::CreateComputePasses()
@@ -184,18 +395,50 @@ void Simulation::CreateComputePasses()
     obstacle_filling_pass_ = ObstacleFillingPass::Make(app_, descriptor_pool_);
     obstacle_filling_pass_->SetNeedsUpdate(upload_obstacle_mask_);
 
+    obstacle_pyramid_pass_ = ObstaclePyramidPass::Make(app_, descriptor_pool_, multigrid_levels_);
+
+    obstacle_distance_pass_ = ObstacleDistancePass::Make(app_, descriptor_pool_);
+
+    boundary_map_pass_ = BoundaryMapPass::Make(app_, descriptor_pool_, multigrid_levels_);
+
+    tile_classification_pass_ = TileClassificationPass::Make(app_, descriptor_pool_);
+
+    active_tile_pass_ = ActiveTilePass::Make(app_, descriptor_pool_);
+
     velocity_advect_pass_ = VelocityAdvectionPass::Make(app_, descriptor_pool_);
 
     divergence_calculation_pass_ = DivergenceCalculationPass::Make(app_, descriptor_pool_);
 
+    convergence_control_pass_ = ConvergenceControlPass::Make(app_, descriptor_pool_, multigrid_levels_);
+    convergence_control_pass_->SetTolerance(pressure_tolerance_);
+
     jacobi_pressure_projection_pass_ = JacobiPressurePass::Make(app_, descriptor_pool_);
     jacobi_pressure_projection_pass_->SetIterations(pressure_jacobi_iterations_);
+    jacobi_pressure_projection_pass_->SetSweepsPerDispatch(jacobi_sweeps_per_dispatch_);
+    jacobi_pressure_projection_pass_->SetConvergenceControl(convergence_control_pass_,
+                                                            PRESSURE_CONVERGENCE_CHECK_INTERVAL);
 
     poisson_pressure_projection_pass_ = PoissonPressurePass::Make(app_, descriptor_pool_);
 
     v_cycle_pressure_projection_pass_ = VCyclePressurePass::Make(app_, descriptor_pool_, multigrid_levels_);
     v_cycle_pressure_projection_pass_->SetRelaxationIterations(relaxation_iterations_);
     v_cycle_pressure_projection_pass_->SetVCycleIterations(vcycle_iterations_);
+    v_cycle_pressure_projection_pass_->SetConvergenceControl(convergence_control_pass_, true);
+
+    if (precision_policy_.mixed_precision)
+    {
+        mixed_precision_refinement_pass_ =
+            MixedPrecisionRefinementPass::Make(app_, descriptor_pool_, multigrid_levels_);
+        mixed_precision_refinement_pass_->GetCorrectionSolver()->SetRelaxationIterations(relaxation_iterations_);
+        mixed_precision_refinement_pass_->SetConvergenceControl(convergence_control_pass_);
+    }
+
+    conjugate_gradient_pressure_projection_pass_ =
+        ConjugateGradientPressurePass::Make(app_, descriptor_pool_, multigrid_levels_);
+    conjugate_gradient_pressure_projection_pass_->SetIterations(conjugate_gradient_iterations_);
+    conjugate_gradient_pressure_projection_pass_->SetConvergenceControl(convergence_control_pass_);
+
+    spectral_pressure_projection_pass_ = SpectralPressurePass::Make(app_, descriptor_pool_);
 
     velocity_update_pass_ = VelocityUpdatePass::Make(app_, descriptor_pool_);
 
@@ -203,85 +446,483 @@ void Simulation::CreateComputePasses()
 
     color_update_pass_ = ColorUpdatePass::Make(app_, descriptor_pool_);
 
-    residual_calculation_pass_ = ResidualCalculationPass::Make(app_, descriptor_pool_);
+    max_velocity_pass_ = MaxVelocityPass::Make(app_, descriptor_pool_);
 }
 
-void Simulation::OnUpdate(VkCommandBuffer cmd_buffer, const FrameTimeInfo &frame_context)
+FieldPrecision Simulation::ParseFieldPrecision(const std::string &name)
 {
-    const lava::uv2 window_size = app_.target->get_size();
-    float delta_time = glm::clamp(frame_context.delta_time, 0.0f, 1.0f / 30.0f);
+    if (name == "fp16")
+    {
+        return FieldPrecision::FP16;
+    }
+    if (name == "fp32")
+    {
+        return FieldPrecision::FP32;
+    }
 
-    SimulationConstants simulation_constants{};
-    simulation_constants.current_time = static_cast<float>(frame_context.current_time);
-    simulation_constants.delta_time = delta_time;
-    simulation_constants.texture_width = static_cast<int>(window_size.x);
-    simulation_constants.texture_height = static_cast<int>(window_size.y);
-    simulation_constants.divergence_width = static_cast<int>(window_size.x);
-    simulation_constants.divergence_height = static_cast<int>(window_size.y);
-    simulation_constants.fluid_density = 0.5f;
-    simulation_constants.vorticity_strength = 0.5f;
-    simulation_constants.reset_color = static_cast<int>(reset_flag_);
+    lava::logger()->error("Unknown field precision: {}", name);
+    throw std::invalid_argument("Unknown field precision: " + name);
+}
 
-    reset_flag_ = false;
+PrecisionPolicy Simulation::ParsePrecisionPolicy(const std::string &name)
+{
+    if (name == "mixed")
+    {
+        return {FieldPrecision::FP32, FieldPrecision::FP32, FieldPrecision::FP16, true};
+    }
+
+    const FieldPrecision precision = ParseFieldPrecision(name);
+    return {precision, precision, precision, false};
+}
 
-    MultigridConstants multigrid_constants;
-    multigrid_constants.fine_width = app_.target->get_size().x / (1 << multigrid_levels_);
-    multigrid_constants.fine_height = app_.target->get_size().y / (1 << multigrid_levels_);
-    multigrid_constants.coarse_width = app_.target->get_size().x / (1 << (multigrid_levels_ + 1));
-    multigrid_constants.coarse_height = app_.target->get_size().y / (1 << (multigrid_levels_ + 1));
+bool Simulation::EnableDeviceFeatures(lava::device::create_param &param)
+{
+    const VkPhysicalDeviceFeatures &supported_features = param.physical_device->get_features();
+    if (!supported_features.shaderStorageImageReadWithoutFormat ||
+        !supported_features.shaderStorageImageWriteWithoutFormat)
+    {
+        lava::logger()->error("Physical device does not support format-less storage image access");
+        return false;
+    }
 
-    obstacle_filling_pass_->Execute(cmd_buffer, simulation_constants);
+    // The compute passes record their batched transitions with vkCmdPipelineBarrier2, the windowed app orders its
+    // compute and graphics queues with timeline semaphores
+    VkPhysicalDeviceTimelineSemaphoreFeatures supported_timeline_semaphore{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES};
+    VkPhysicalDeviceSynchronization2Features supported_synchronization2{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES, .pNext = &supported_timeline_semaphore};
+    VkPhysicalDeviceFeatures2 supported_features2{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+                                                  .pNext = &supported_synchronization2};
+    vkGetPhysicalDeviceFeatures2(param.physical_device->get(), &supported_features2);
+    if (!supported_synchronization2.synchronization2 || !supported_timeline_semaphore.timelineSemaphore)
+    {
+        lava::logger()->error("Physical device does not support synchronization2 and timeline semaphores");
+        return false;
+    }
 
-    velocity_advect_pass_->Execute(cmd_buffer, simulation_constants);
+    param.features.shaderStorageImageReadWithoutFormat = VK_TRUE;
+    param.features.shaderStorageImageWriteWithoutFormat = VK_TRUE;
+
+    // Read when the device is created after this returns
+    static VkPhysicalDeviceTimelineSemaphoreFeatures timeline_semaphore{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES, .timelineSemaphore = VK_TRUE};
+    static VkPhysicalDeviceSynchronization2Features synchronization2{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES, .synchronization2 = VK_TRUE};
+    timeline_semaphore.pNext = const_cast<void *>(param.next);
+    synchronization2.pNext = &timeline_semaphore;
+    param.next = &synchronization2;
+    return true;
+}
 
-    divergence_calculation_pass_->Execute(cmd_buffer, simulation_constants);
+bool Simulation::SetPressureProjectionMethod(const PressureProjectionMethod &method)
+{
+    const bool spectral =
+        method == PressureProjectionMethod::Spectral_DCT || method == PressureProjectionMethod::Spectral_FFT;
+    if (spectral && !SpectralPressurePass::IsSupportedGridSize(grid_size_))
+    {
+        lava::logger()->error("Spectral pressure solver needs grid sides up to {} that factor into 2, 3 and 5, got {} x {}",
+                              SpectralPressurePass::MAX_LINE_LENGTH, grid_size_.x, grid_size_.y);
+        return false;
+    }
+
+    pressure_projection_method_ = method;
+    return true;
+}
+
+void Simulation::Step(VkCommandBuffer cmd_buffer, const SimulationConstants &constants,
+                      const BacktraceVariant &backtrace)
+{
+    active_tile_pass_->SetEnabled(sparse_simulation_);
+    active_tile_pass_->Execute(cmd_buffer, constants);
+
+    velocity_advect_pass_->SetAdvectionScheme(advection_scheme_);
+    velocity_advect_pass_->SetBacktrace(backtrace);
+    velocity_advect_pass_->Execute(cmd_buffer, constants);
+
+    // The pressure is solved on the whole grid, sparse simulation dispatches the other kernels from the active lists
+    // and runs the interior kernels on its interior tiles
+    const ActiveTilePass::s_ptr tile_lists = (tile_classification_ || sparse_simulation_) ? active_tile_pass_ : nullptr;
+    divergence_calculation_pass_->SetTileLists(tile_lists);
+    jacobi_pressure_projection_pass_->SetTileClassification(tile_classification_ ? tile_classification_pass_ : nullptr);
+    velocity_update_pass_->SetTileLists(tile_lists);
+
+    divergence_calculation_pass_->Execute(cmd_buffer, constants);
+
+    // Solvers stop on the device once the residual is below the tolerance, the iteration counts act as caps
+    convergence_control_pass_->SetTolerance(pressure_tolerance_);
+    convergence_control_pass_->Reset(cmd_buffer);
 
     if (pressure_projection_method_ == PressureProjectionMethod::Jacobi)
     {
         jacobi_pressure_projection_pass_->SetIterations(pressure_jacobi_iterations_);
-        jacobi_pressure_projection_pass_->Execute(cmd_buffer, simulation_constants);
+        jacobi_pressure_projection_pass_->SetSweepsPerDispatch(jacobi_sweeps_per_dispatch_);
+        jacobi_pressure_projection_pass_->SetChebyshevAcceleration(chebyshev_acceleration_);
+        jacobi_pressure_projection_pass_->Execute(cmd_buffer, constants);
     }
     else if (pressure_projection_method_ == PressureProjectionMethod::Poisson_Filter)
     {
-        poisson_pressure_projection_pass_->Execute(cmd_buffer, simulation_constants);
+        poisson_pressure_projection_pass_->SetFilter(poisson_filter_);
+        poisson_pressure_projection_pass_->Execute(cmd_buffer, constants);
     }
     else if (pressure_projection_method_ == PressureProjectionMethod::Multigrid ||
-             pressure_projection_method_ == PressureProjectionMethod::Multigrid_Poisson)
+             pressure_projection_method_ == PressureProjectionMethod::Multigrid_Poisson ||
+             pressure_projection_method_ == PressureProjectionMethod::Multigrid_Red_Black)
     {
-        VCycleRelaxationType relaxation_type = (pressure_projection_method_ == PressureProjectionMethod::Multigrid)
-                                                   ? VCycleRelaxationType::Standard
-                                                   : VCycleRelaxationType::Poisson_Filter;
+        VCycleRelaxationType relaxation_type = VCycleRelaxationType::Standard;
+        if (pressure_projection_method_ == PressureProjectionMethod::Multigrid_Poisson)
+        {
+            relaxation_type = VCycleRelaxationType::Poisson_Filter;
+        }
+        else if (pressure_projection_method_ == PressureProjectionMethod::Multigrid_Red_Black)
+        {
+            relaxation_type = VCycleRelaxationType::Red_Black_Gauss_Seidel;
+        }
 
-        v_cycle_pressure_projection_pass_->SetRelaxationType(relaxation_type);
-        v_cycle_pressure_projection_pass_->Execute(cmd_buffer, simulation_constants);
+        // In mixed precision every cycle solves for a correction of the full precision pressure instead
+        VCyclePressurePass::s_ptr multigrid_pass = v_cycle_pressure_projection_pass_;
+        if (mixed_precision_refinement_pass_)
+        {
+            multigrid_pass = mixed_precision_refinement_pass_->GetCorrectionSolver();
+        }
+
+        multigrid_pass->SetRelaxationType(relaxation_type);
+        multigrid_pass->SetCycleType(multigrid_cycle_type_);
+        multigrid_pass->SetRelaxationOmega(relaxation_omega_);
+        multigrid_pass->SetChebyshevSmoothing(chebyshev_acceleration_);
+        multigrid_pass->SetPoissonFilter(multigrid_poisson_filter_);
+        multigrid_pass->SetBottomSolver(multigrid_bottom_solver_);
+
+        if (mixed_precision_refinement_pass_)
+        {
+            mixed_precision_refinement_pass_->SetRefinementSteps(vcycle_iterations_);
+            mixed_precision_refinement_pass_->Execute(cmd_buffer, constants);
+        }
+        else
+        {
+            v_cycle_pressure_projection_pass_->SetVCycleIterations(vcycle_iterations_);
+            v_cycle_pressure_projection_pass_->Execute(cmd_buffer, constants);
+        }
     }
+    else if (pressure_projection_method_ == PressureProjectionMethod::Multigrid_PCG)
+    {
+        conjugate_gradient_pressure_projection_pass_->SetIterations(conjugate_gradient_iterations_);
+        conjugate_gradient_pressure_projection_pass_->Execute(cmd_buffer, constants);
+    }
+    else if (pressure_projection_method_ == PressureProjectionMethod::Spectral_DCT ||
+             pressure_projection_method_ == PressureProjectionMethod::Spectral_FFT)
+    {
+        spectral_pressure_projection_pass_->SetBoundary(pressure_projection_method_ ==
+                                                                PressureProjectionMethod::Spectral_FFT
+                                                            ? SpectralBoundary::Periodic
+                                                            : SpectralBoundary::Neumann);
+        spectral_pressure_projection_pass_->Execute(cmd_buffer, constants);
+    }
+
+    velocity_update_pass_->Execute(cmd_buffer, constants);
+
+    color_advect_pass_->SetAdvectionScheme(advection_scheme_);
+    color_advect_pass_->SetBacktrace(backtrace);
+    color_advect_pass_->Execute(cmd_buffer, constants);
+
+    color_update_pass_->Execute(cmd_buffer, constants);
+}
 
-    if (calculate_residual_error_ && frame_count_ == PRESSURE_CONVERGENCE_CHECK_FRAME)
+void Simulation::RecordSteps(VkCommandBuffer cmd_buffer, SimulationConstants constants, const TimestepPlan &plan)
+{
+    const BacktraceVariant step_backtrace{backtrace_.integrator, plan.backtrace_substeps};
+    for (uint32_t step = 0; step < plan.steps; step++)
     {
-        residual_calculation_pass_->Execute(cmd_buffer, simulation_constants);
-        auto staging_buffer = FluidSimulation::ResourceManager::GetInstance(&app_).GetBuffer("staging_buffer");
-        residual_calculation_pass_->CopyResidualToCPU(cmd_buffer, staging_buffer);
+        constants.substep = static_cast<int>(step);
+        Step(cmd_buffer, constants, step_backtrace);
+
+        constants.reset_color = 0;
     }
+}
 
-    velocity_update_pass_->Execute(cmd_buffer, simulation_constants);
+Simulation::StepSettings Simulation::GetStepSettings() const
+{
+    return {.pressure_projection_method = pressure_projection_method_,
+            .advection_scheme = advection_scheme_,
+            .backtrace_integrator = backtrace_.integrator,
+            .pressure_jacobi_iterations = pressure_jacobi_iterations_,
+            .jacobi_sweeps_per_dispatch = jacobi_sweeps_per_dispatch_,
+            .chebyshev_acceleration = chebyshev_acceleration_,
+            .tile_classification = tile_classification_,
+            .sparse_simulation = sparse_simulation_,
+            .vcycle_iterations = vcycle_iterations_,
+            .multigrid_cycle_type = multigrid_cycle_type_,
+            .multigrid_bottom_solver = multigrid_bottom_solver_,
+            .relaxation_omega = relaxation_omega_,
+            .conjugate_gradient_iterations = conjugate_gradient_iterations_,
+            .pressure_tolerance = pressure_tolerance_,
+            .poisson_filter = poisson_filter_,
+            .multigrid_poisson_filter = multigrid_poisson_filter_};
+}
 
-    color_advect_pass_->Execute(cmd_buffer, simulation_constants);
+void Simulation::RestoreTextureStates(VkCommandBuffer cmd_buffer, const std::vector<TextureState> &texture_states)
+{
+    std::vector<VkImageMemoryBarrier2> image_barriers;
 
-    color_update_pass_->Execute(cmd_buffer, simulation_constants);
+    for (const TextureState &state : texture_states)
+    {
+        const lava::image::s_ptr &image = state.image;
 
-    // Transition resources for rendering
-    auto &resource_manager = ResourceManager::GetInstance();
+        // A texture the recording starts on undefined is discarded by its first barrier from wherever it is
+        const bool unchanged = image->get_layout() == state.layout && image->get_access_mask() == state.access &&
+                               image->get_stage() == state.stage;
+        if (unchanged || state.layout == VK_IMAGE_LAYOUT_UNDEFINED)
+        {
+            continue;
+        }
+
+        const VkImageCreateInfo &info = image->get_info();
+        image_barriers.push_back({.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                                  .srcStageMask = image->get_stage(),
+                                  .srcAccessMask = image->get_access_mask(),
+                                  .dstStageMask = state.stage,
+                                  .dstAccessMask = state.access,
+                                  .oldLayout = image->get_layout(),
+                                  .newLayout = state.layout,
+                                  .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                  .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                  .image = image->get(),
+                                  .subresourceRange = {.aspectMask = image->get_subresource_range().aspectMask,
+                                                       .baseMipLevel = 0,
+                                                       .levelCount = info.mipLevels,
+                                                       .baseArrayLayer = 0,
+                                                       .layerCount = info.arrayLayers}});
+
+        image->set_transition_state(state.layout, state.access, state.stage);
+    }
+
+    if (image_barriers.empty())
+    {
+        return;
+    }
+
+    VkDependencyInfo dependency_info{.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                                     .imageMemoryBarrierCount = static_cast<uint32_t>(image_barriers.size()),
+                                     .pImageMemoryBarriers = image_barriers.data()};
+    vkCmdPipelineBarrier2(cmd_buffer, &dependency_info);
+}
+
+Simulation::RecordedSteps Simulation::RecordReplayableSteps(const SimulationConstants &constants,
+                                                            const TimestepPlan &plan)
+{
+    // The recordings run inside command buffers of the compute queue, see AsyncCompute and HeadlessRunner
+    if (!recorded_step_pool_ &&
+        !app_.device->vkCreateCommandPool(static_cast<uint32_t>(app_.device->get_compute_queue().family),
+                                          &recorded_step_pool_))
+    {
+        lava::logger()->error("Failed to create recorded step command pool");
+        throw std::runtime_error("Failed to create recorded step command pool");
+    }
+
+    RecordedSteps recorded;
+    for (const auto &texture : ResourceManager::GetInstance(&app_).GetAllTextures())
+    {
+        const lava::image::s_ptr image = texture->get_image();
+        recorded.texture_states.push_back({image, image->get_layout(), image->get_access_mask(), image->get_stage()});
+    }
+
+    if (!app_.device->vkAllocateCommandBuffers(recorded_step_pool_, 1, &recorded.cmd_buffer,
+                                               VK_COMMAND_BUFFER_LEVEL_SECONDARY))
+    {
+        lava::logger()->error("Failed to allocate recorded step command buffer");
+        throw std::runtime_error("Failed to allocate recorded step command buffer");
+    }
 
-    auto color_field_texture = resource_manager.GetTexture("color_field_A");
-    color_field_texture->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                                                        VK_ACCESS_SHADER_READ_BIT,
-                                                        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    // Frames in flight replay the same recording
+    VkCommandBufferInheritanceInfo inheritance_info{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
+    VkCommandBufferBeginInfo begin_info{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                        .flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT,
+                                        .pInheritanceInfo = &inheritance_info};
 
-    auto obstacle_mask_ = resource_manager.GetTexture("obstacle_mask");
-    obstacle_mask_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                                                   VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    if (!lava::check(app_.device->call().vkBeginCommandBuffer(recorded.cmd_buffer, &begin_info)))
+    {
+        lava::logger()->error("Failed to begin recorded step command buffer");
+        throw std::runtime_error("Failed to begin recorded step command buffer");
+    }
 
-    frame_count_++;
+    RecordSteps(recorded.cmd_buffer, constants, plan);
+    RestoreTextureStates(recorded.cmd_buffer, recorded.texture_states);
+
+    if (!lava::check(app_.device->call().vkEndCommandBuffer(recorded.cmd_buffer)))
+    {
+        lava::logger()->error("Failed to end recorded step command buffer");
+        throw std::runtime_error("Failed to end recorded step command buffer");
+    }
+
+    lava::logger()->debug("Recorded {} steps with {} backtrace substeps for replay", plan.steps,
+                          plan.backtrace_substeps);
+    return recorded;
+}
+
+void Simulation::RetireRecordedSteps()
+{
+    for (auto &&[key, recorded] : recorded_steps_)
+    {
+        retired_steps_.emplace_back(recorded.cmd_buffer, submission_);
+    }
+    recorded_steps_.clear();
+}
+
+void Simulation::BeginSubmission(uint64_t submission, uint64_t completed_submission)
+{
+    submission_ = submission;
+    max_velocity_pass_->BeginSubmission(submission, completed_submission);
+
+    std::erase_if(retired_steps_,
+                  [&](const std::pair<VkCommandBuffer, uint64_t> &retired)
+                  {
+                      if (retired.second > completed_submission)
+                      {
+                          return false;
+                      }
+
+                      app_.device->vkFreeCommandBuffers(recorded_step_pool_, 1, &retired.first);
+                      return true;
+                  });
+}
+
+void Simulation::ReplaySteps(VkCommandBuffer cmd_buffer, const SimulationConstants &constants,
+                             const TimestepPlan &plan)
+{
+    const StepSettings step_settings = GetStepSettings();
+    if (step_settings != recorded_step_settings_)
+    {
+        RetireRecordedSteps();
+        recorded_step_settings_ = step_settings;
+    }
+
+    const std::pair<uint32_t, int32_t> key{plan.steps, plan.backtrace_substeps};
+    auto recorded = recorded_steps_.find(key);
+    if (recorded == recorded_steps_.end())
+    {
+        recorded = recorded_steps_.emplace(key, RecordReplayableSteps(constants, plan)).first;
+    }
+
+    // Directly recorded frames and the passes around the steps leave textures elsewhere
+    RestoreTextureStates(cmd_buffer, recorded->second.texture_states);
+
+    vkCmdExecuteCommands(cmd_buffer, 1, &recorded->second.cmd_buffer);
+}
+
+void Simulation::UpdateStepTime(VkCommandBuffer cmd_buffer, const StepTimeConstants &step_time)
+{
+    auto step_time_buffer = ResourceManager::GetInstance(&app_).GetBuffer("step_time");
+
+    VkMemoryBarrier read_barrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                 .srcAccessMask = VK_ACCESS_UNIFORM_READ_BIT,
+                                 .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT};
+
+    vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1,
+                         &read_barrier, 0, nullptr, 0, nullptr);
+
+    vkCmdUpdateBuffer(cmd_buffer, step_time_buffer->get(), 0, sizeof(StepTimeConstants), &step_time);
+
+    VkMemoryBarrier write_barrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                  .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                                  .dstAccessMask = VK_ACCESS_UNIFORM_READ_BIT};
+
+    vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                         &write_barrier, 0, nullptr, 0, nullptr);
+}
+
+SimulationConstants Simulation::GetSimulationConstants() const
+{
+    SimulationConstants simulation_constants{};
+    simulation_constants.texture_width = static_cast<int>(grid_size_.x);
+    simulation_constants.texture_height = static_cast<int>(grid_size_.y);
+    simulation_constants.divergence_width = static_cast<int>(grid_size_.x);
+    simulation_constants.divergence_height = static_cast<int>(grid_size_.y);
+    simulation_constants.fluid_density = 0.5f;
+    simulation_constants.vorticity_strength = 0.5f;
+    simulation_constants.reset_color = static_cast<int>(reset_flag_);
+    return simulation_constants;
+}
+
+void Simulation::OnUpdate(VkCommandBuffer cmd_buffer, const FrameTimeInfo &frame_context)
+{
+    if (fixed_timestep_ <= 0.0f)
+    {
+        Advance(cmd_buffer, frame_context.current_time,
+                glm::clamp(frame_context.delta_time, 0.0f, MAX_STEP_DELTA_TIME));
+        fixed_steps_ = 0;
+    }
+    else
+    {
+        // Beyond the maximum the whole steps are dropped, so a slow frame cannot make the next ones slower still
+        accumulated_time_ += std::max(frame_context.delta_time, 0.0f);
+        fixed_steps_ = std::min(static_cast<uint32_t>(accumulated_time_ / fixed_timestep_), max_fixed_steps_);
+        accumulated_time_ = std::fmod(accumulated_time_, static_cast<double>(fixed_timestep_));
+
+        for (uint32_t step = 0; step < fixed_steps_; step++)
+        {
+            Advance(cmd_buffer, simulation_time_, fixed_timestep_);
+            simulation_time_ += fixed_timestep_;
+        }
+    }
+
+    // Once per submission, the readback ring is sized for the submissions in flight rather than the steps
+    max_velocity_pass_->Execute(cmd_buffer, GetSimulationConstants());
+}
+
+void Simulation::StepFixed(VkCommandBuffer cmd_buffer, double current_time, float delta_time)
+{
+    Advance(cmd_buffer, current_time, delta_time);
+    max_velocity_pass_->Execute(cmd_buffer, GetSimulationConstants());
+}
+
+void Simulation::Advance(VkCommandBuffer cmd_buffer, double current_time, float delta_time)
+{
+    // The plan uses the max velocity of a few frames ago, the reduction is never waited on
+    TimestepPlan plan{delta_time, 1, backtrace_.substeps};
+    if (max_velocity_pass_->ReadMaxVelocity(max_velocity_) && adaptive_timestep_)
+    {
+        plan = PlanTimestep(delta_time, max_velocity_, std::min(grid_size_.x, grid_size_.y), target_cfl_,
+                            max_substeps_, backtrace_.substeps);
+    }
+    substeps_ = plan.steps;
+
+    const SimulationConstants simulation_constants = GetSimulationConstants();
+    reset_flag_ = false;
+
+    UpdateStepTime(cmd_buffer, {static_cast<float>(current_time), plan.delta_time});
+
+    // The coarse obstacle fractions, the distance field, the boundary maps and the tile lists follow the mask, they
+    // are built on the first frame and after every upload
+    if (obstacle_filling_pass_->GetNeedsUpdate())
+    {
+        obstacle_pyramid_pass_->SetNeedsUpdate(true);
+        obstacle_distance_pass_->SetNeedsUpdate(true);
+        boundary_map_pass_->SetNeedsUpdate(true);
+        tile_classification_pass_->SetNeedsUpdate(true);
+        active_tile_pass_->SetNeedsUpdate(true);
+    }
+
+    obstacle_filling_pass_->Execute(cmd_buffer, simulation_constants);
+    obstacle_pyramid_pass_->Execute(cmd_buffer, simulation_constants);
+    obstacle_distance_pass_->Execute(cmd_buffer, simulation_constants);
+    boundary_map_pass_->Execute(cmd_buffer, simulation_constants);
+    tile_classification_pass_->Execute(cmd_buffer, simulation_constants);
+
+    // A recording holds the commands of a settled frame, the first frame after a settings change records them
+    // directly so every texture it touches is defined by the time they are recorded
+    active_tile_pass_->SetEnabled(sparse_simulation_);
+    const StepSettings step_settings = GetStepSettings();
+    const bool settled = last_step_settings_ == step_settings && simulation_constants.reset_color == 0 &&
+                         active_tile_pass_->IsSteady();
+    last_step_settings_ = step_settings;
+
+    if (step_replay_ && settled)
+    {
+        ReplaySteps(cmd_buffer, simulation_constants, plan);
+    }
+    else
+    {
+        RecordSteps(cmd_buffer, simulation_constants, plan);
+    }
 }
 
 } // namespace FluidSimulation
\ No newline at end of file
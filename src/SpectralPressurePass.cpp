@@ -0,0 +1,154 @@
+#include "SpectralPressurePass.hpp"
+
+namespace FluidSimulation
+{
+
+namespace
+{
+constexpr int STAGE_FORWARD_ROWS = 0;
+constexpr int STAGE_INVERSE_ROWS = 3;
+
+bool IsSupportedLineLength(uint32_t length)
+{
+    if (length == 0 || length > SpectralPressurePass::MAX_LINE_LENGTH)
+    {
+        return false;
+    }
+
+    for (uint32_t radix : {2u, 3u, 5u})
+    {
+        while (length % radix == 0)
+        {
+            length /= radix;
+        }
+    }
+
+    return length == 1;
+}
+} // namespace
+
+SpectralPressurePass::SpectralPressurePass(lava::engine &app, lava::descriptor::pool::s_ptr pool)
+    : ComputePass(app, pool)
+{
+    auto &resource_manager = ResourceManager::GetInstance();
+
+    divergence_field_ = resource_manager.GetTexture("divergence_field");
+    pressure_field_ = resource_manager.GetTexture("pressure_field_A");
+    spectral_field_A_ = resource_manager.GetTexture("spectral_field_A");
+    spectral_field_B_ = resource_manager.GetTexture("spectral_field_B");
+
+    CreateDescriptorSets();
+    CreatePipeline();
+    UpdateDescriptorSets();
+}
+
+SpectralPressurePass::~SpectralPressurePass()
+{
+    if (descriptor_set_layout_)
+    {
+        descriptor_set_layout_->destroy();
+    }
+}
+
+bool SpectralPressurePass::IsSupportedGridSize(glm::uvec2 grid_size)
+{
+    return IsSupportedLineLength(grid_size.x) && IsSupportedLineLength(grid_size.y);
+}
+
+void SpectralPressurePass::CreateDescriptorSets()
+{
+    descriptor_set_layout_ = lava::descriptor::make();
+    descriptor_set_layout_->add_binding(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Divergence field
+    descriptor_set_layout_->add_binding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Pressure field
+    descriptor_set_layout_->add_binding(2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Spectral field A
+    descriptor_set_layout_->add_binding(3, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Spectral field B
+
+    if (!descriptor_set_layout_->create(app_.device))
+    {
+        lava::logger()->error("Failed to create spectral pressure projection descriptor set layout");
+        throw std::runtime_error("Failed to create spectral pressure projection descriptor set layout");
+    }
+
+    descriptor_set_ = descriptor_set_layout_->allocate(descriptor_pool_->get());
+    if (!descriptor_set_)
+    {
+        lava::logger()->error("Failed to allocate spectral pressure projection descriptor set");
+        throw std::runtime_error("Failed to allocate spectral pressure projection descriptor set");
+    }
+}
+
+void SpectralPressurePass::UpdateDescriptorSets()
+{
+    VkDescriptorImageInfo divergence_field_info{.sampler = VK_NULL_HANDLE,
+                                                .imageView = divergence_field_->get_image()->get_view(),
+                                                .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+
+    VkDescriptorImageInfo pressure_field_info{.sampler = VK_NULL_HANDLE,
+                                              .imageView = pressure_field_->get_image()->get_view(),
+                                              .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+
+    VkDescriptorImageInfo spectral_field_A_info{.sampler = VK_NULL_HANDLE,
+                                                .imageView = spectral_field_A_->get_image()->get_view(),
+                                                .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+
+    VkDescriptorImageInfo spectral_field_B_info{.sampler = VK_NULL_HANDLE,
+                                                .imageView = spectral_field_B_->get_image()->get_view(),
+                                                .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+
+    std::vector<VkDescriptorImageInfo> image_infos = {divergence_field_info, pressure_field_info,
+                                                      spectral_field_A_info, spectral_field_B_info};
+
+    std::vector<VkDescriptorType> descriptor_types = {
+        VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+        VK_DESCRIPTOR_TYPE_STORAGE_IMAGE};
+
+    ComputePass::UpdateDescriptorSets(descriptor_set_, image_infos, descriptor_types);
+}
+
+void SpectralPressurePass::CreatePipeline()
+{
+    CreateBasePipeline("SpectralTransform.comp", descriptor_set_layout_, sizeof(SpectralConstants));
+}
+
+void SpectralPressurePass::Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants)
+{
+    divergence_field_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT,
+                                                      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    pressure_field_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT,
+                                                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    pipeline_->bind(cmd_buffer);
+
+    vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_->get(), 0, 1, &descriptor_set_,
+                            0, nullptr);
+
+    SpectralConstants spectral_constants{};
+    spectral_constants.simulation = constants;
+    spectral_constants.periodic = (boundary_ == SpectralBoundary::Periodic) ? 1 : 0;
+
+    // Forward transform along rows then columns, divide by the eigenvalues, then invert in reverse order
+    for (int stage = STAGE_FORWARD_ROWS; stage <= STAGE_INVERSE_ROWS; stage++)
+    {
+        spectral_field_A_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL,
+                                                          VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                                                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        spectral_field_B_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL,
+                                                          VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                                                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+        spectral_constants.stage = stage;
+        vkCmdPushConstants(cmd_buffer, pipeline_layout_->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                           sizeof(SpectralConstants), &spectral_constants);
+
+        // One workgroup per line
+        const bool rows = (stage == STAGE_FORWARD_ROWS || stage == STAGE_INVERSE_ROWS);
+        vkCmdDispatch(cmd_buffer, rows ? constants.texture_height : constants.texture_width, 1, 1);
+    }
+}
+
+} // namespace FluidSimulation
@@ -0,0 +1,135 @@
+#include "TileClassificationPass.hpp"
+#include <cstddef>
+
+namespace FluidSimulation
+{
+
+TileClassificationPass::TileClassificationPass(lava::engine &app, lava::descriptor::pool::s_ptr pool)
+    : ComputePass(app, pool)
+{
+    auto &resource_manager = ResourceManager::GetInstance();
+
+    boundary_map_ = resource_manager.GetTexture("boundary_map");
+    tile_buffer_ = resource_manager.GetBuffer("tile_classification");
+
+    CreateDescriptorSets();
+    CreatePipeline();
+    UpdateDescriptorSets();
+}
+
+TileClassificationPass::~TileClassificationPass()
+{
+    if (descriptor_set_layout_)
+    {
+        descriptor_set_layout_->destroy();
+    }
+}
+
+void TileClassificationPass::CreateDescriptorSets()
+{
+    descriptor_set_layout_ = lava::descriptor::make();
+    descriptor_set_layout_->add_binding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Boundary map
+    descriptor_set_layout_->add_binding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Tile lists
+
+    if (!descriptor_set_layout_->create(app_.device))
+    {
+        lava::logger()->error("Failed to create tile classification descriptor set layout");
+        throw std::runtime_error("Failed to create tile classification descriptor set layout");
+    }
+
+    descriptor_set_ = descriptor_set_layout_->allocate(descriptor_pool_->get());
+    if (!descriptor_set_)
+    {
+        lava::logger()->error("Failed to allocate tile classification descriptor set");
+        throw std::runtime_error("Failed to allocate tile classification descriptor set");
+    }
+}
+
+void TileClassificationPass::UpdateDescriptorSets()
+{
+    VkDescriptorImageInfo boundary_map_info{.sampler = boundary_map_->get_sampler(),
+                                            .imageView = boundary_map_->get_image()->get_view(),
+                                            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+
+    ComputePass::UpdateDescriptorSets(descriptor_set_, {boundary_map_info},
+                                      {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER});
+
+    std::vector<VkDescriptorBufferInfo> buffer_infos = {*tile_buffer_->get_descriptor_info()};
+    std::vector<VkDescriptorType> buffer_types = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER};
+
+    ComputePass::UpdateDescriptorSets(descriptor_set_, buffer_infos, buffer_types, 1);
+}
+
+void TileClassificationPass::CreatePipeline()
+{
+    CreateBasePipeline("TileClassification.comp", descriptor_set_layout_);
+}
+
+void TileClassificationPass::Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants)
+{
+    if (!needs_update_)
+    {
+        return;
+    }
+
+    // Earlier dispatches from the lists, and copies of their arguments, must be done before the lists are rebuilt
+    VkMemoryBarrier reset_barrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                  .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+                                  .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT};
+
+    vkCmdPipelineBarrier(cmd_buffer,
+                         VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &reset_barrier,
+                         0, nullptr, 0, nullptr);
+
+    const TileClassificationHeader empty_lists{.interior_dispatch = {0, 1, 1, 0},
+                                               .boundary_dispatch = {0, 1, 1, 0},
+                                               .combined_dispatch = {0, 1, 1, 0}};
+    vkCmdUpdateBuffer(cmd_buffer, tile_buffer_->get(), 0, sizeof(TileClassificationHeader), &empty_lists);
+
+    VkMemoryBarrier update_barrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                   .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                                   .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
+
+    vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                         &update_barrier, 0, nullptr, 0, nullptr);
+
+    boundary_map_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                                  VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    pipeline_->bind(cmd_buffer);
+
+    vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_->get(), 0, 1, &descriptor_set_,
+                            0, nullptr);
+
+    uint32_t group_count_x = (constants.texture_width + 15) / 16;
+    uint32_t group_count_y = (constants.texture_height + 15) / 16;
+    vkCmdDispatch(cmd_buffer, group_count_x, group_count_y, 1);
+
+    // The lists are read by the kernels and their arguments by indirect dispatches and the convergence control copy
+    VkMemoryBarrier list_barrier{.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                                 .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+                                 .dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT |
+                                                  VK_ACCESS_TRANSFER_READ_BIT};
+
+    vkCmdPipelineBarrier(cmd_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 1, &list_barrier, 0, nullptr, 0, nullptr);
+
+    needs_update_ = false;
+}
+
+void TileClassificationPass::Dispatch(VkCommandBuffer cmd_buffer, TileClass tile_class) const
+{
+    const VkDeviceSize offset = (tile_class == TileClass::Interior)
+                                    ? offsetof(TileClassificationHeader, interior_dispatch)
+                                    : offsetof(TileClassificationHeader, boundary_dispatch);
+
+    vkCmdDispatchIndirect(cmd_buffer, tile_buffer_->get(), offset);
+}
+
+} // namespace FluidSimulation
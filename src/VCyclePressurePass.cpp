@@ -1,36 +1,49 @@
 #include "VCyclePressurePass.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <numbers>
 
 namespace FluidSimulation
 {
 
-VCyclePressurePass::VCyclePressurePass(lava::engine &app, lava::descriptor::pool::s_ptr pool, uint32_t max_levels)
+VCyclePressurePass::VCyclePressurePass(lava::engine &app, lava::descriptor::pool::s_ptr pool, uint32_t max_levels,
+                                       const VCycleFineLevelTextures &fine_level_textures)
     : ComputePass(app, pool), max_levels_(max_levels)
 {
     auto &resource_manager = ResourceManager::GetInstance();
 
     divergence_fields_.resize(max_levels_);
-    divergence_fields_[0] = resource_manager.GetTexture("divergence_field");
+    divergence_fields_[0] = resource_manager.GetTexture(fine_level_textures.divergence);
     for (uint32_t level = 1; level < max_levels_; level++)
     {
         divergence_fields_[level] = resource_manager.GetTexture("residual_L" + std::to_string(level));
     }
 
-    obstacle_mask_ = resource_manager.GetTexture("obstacle_mask");
+    obstacle_masks_.resize(max_levels_);
+    obstacle_masks_[0] = resource_manager.GetTexture("obstacle_mask");
+    for (uint32_t level = 1; level < max_levels_; level++)
+    {
+        obstacle_masks_[level] = resource_manager.GetTexture("obstacle_mask_L" + std::to_string(level));
+    }
+
+    boundary_maps_.resize(max_levels_);
+    boundary_maps_[0] = resource_manager.GetTexture("boundary_map");
+    for (uint32_t level = 1; level < max_levels_; level++)
+    {
+        boundary_maps_[level] = resource_manager.GetTexture("boundary_map_L" + std::to_string(level));
+    }
 
     pressure_multigrid_texture_A_.resize(max_levels_);
     pressure_multigrid_texture_B_.resize(max_levels_);
-    multigrid_temp_textures_.resize(max_levels_);
-    multigrid_temp_textures1_.resize(max_levels_);
 
     // Use existing pressure field for level 0
-    pressure_multigrid_texture_A_[0] = resource_manager.GetTexture("pressure_field_A");
-    pressure_multigrid_texture_B_[0] = resource_manager.GetTexture("pressure_field_B");
+    pressure_multigrid_texture_A_[0] = resource_manager.GetTexture(fine_level_textures.pressure_A);
+    pressure_multigrid_texture_B_[0] = resource_manager.GetTexture(fine_level_textures.pressure_B);
 
     for (uint32_t level = 0; level < max_levels_; level++)
     {
         std::string suffix = "_L" + std::to_string(level);
-        multigrid_temp_textures_[level] = resource_manager.GetTexture("multigrid_temp" + suffix);
-        multigrid_temp_textures1_[level] = resource_manager.GetTexture("multigrid_temp1" + suffix);
         if (level > 0)
         {
             pressure_multigrid_texture_A_[level] = resource_manager.GetTexture("pressure_multigrid_A" + suffix);
@@ -41,6 +54,8 @@ VCyclePressurePass::VCyclePressurePass(lava::engine &app, lava::descriptor::pool
     CreateDescriptorSets();
     CreatePipeline();
     UpdateDescriptorSets();
+
+    SetBottomSolver(true);
 }
 
 VCyclePressurePass::~VCyclePressurePass()
@@ -57,6 +72,14 @@ VCyclePressurePass::~VCyclePressurePass()
     {
         relaxation_pipeline_->destroy();
     }
+    if (chebyshev_relaxation_pipeline_layout_)
+    {
+        chebyshev_relaxation_pipeline_layout_->destroy();
+    }
+    if (chebyshev_relaxation_pipeline_)
+    {
+        chebyshev_relaxation_pipeline_->destroy();
+    }
 
     if (poisson_relaxation_descriptor_set_layout_)
     {
@@ -66,9 +89,31 @@ VCyclePressurePass::~VCyclePressurePass()
     {
         poisson_relaxation_pipeline_layout_->destroy();
     }
-    if (poisson_relaxation_pipeline_)
+    for (auto &&[filter, pipeline] : poisson_relaxation_pipelines_)
     {
-        poisson_relaxation_pipeline_->destroy();
+        pipeline->destroy();
+    }
+
+    if (red_black_relaxation_descriptor_set_layout_)
+    {
+        red_black_relaxation_descriptor_set_layout_->destroy();
+    }
+    if (red_black_relaxation_pipeline_layout_)
+    {
+        red_black_relaxation_pipeline_layout_->destroy();
+    }
+    if (red_black_relaxation_pipeline_)
+    {
+        red_black_relaxation_pipeline_->destroy();
+    }
+
+    if (bottom_solve_pipeline_layout_)
+    {
+        bottom_solve_pipeline_layout_->destroy();
+    }
+    if (bottom_solve_pipeline_)
+    {
+        bottom_solve_pipeline_->destroy();
     }
 
     if (residual_descriptor_set_layout_)
@@ -122,7 +167,7 @@ void VCyclePressurePass::CreateDescriptorSets()
     relaxation_descriptor_set_layout_->add_binding(2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
                                                    VK_SHADER_STAGE_COMPUTE_BIT); // Pressure field
     relaxation_descriptor_set_layout_->add_binding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                                   VK_SHADER_STAGE_COMPUTE_BIT); // Obstacle mask
+                                                   VK_SHADER_STAGE_COMPUTE_BIT); // Boundary map
 
     if (!relaxation_descriptor_set_layout_->create(app_.device))
     {
@@ -136,12 +181,8 @@ void VCyclePressurePass::CreateDescriptorSets()
                                                            VK_SHADER_STAGE_COMPUTE_BIT); // Divergence field
     poisson_relaxation_descriptor_set_layout_->add_binding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
                                                            VK_SHADER_STAGE_COMPUTE_BIT); // Pressure field
-    poisson_relaxation_descriptor_set_layout_->add_binding(2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
-                                                           VK_SHADER_STAGE_COMPUTE_BIT); // Temp texture
-    poisson_relaxation_descriptor_set_layout_->add_binding(3, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
-                                                           VK_SHADER_STAGE_COMPUTE_BIT); // Temp texture 1
-    poisson_relaxation_descriptor_set_layout_->add_binding(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                                           VK_SHADER_STAGE_COMPUTE_BIT); // Obstacle mask
+    poisson_relaxation_descriptor_set_layout_->add_binding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                           VK_SHADER_STAGE_COMPUTE_BIT); // Boundary map
 
     if (!poisson_relaxation_descriptor_set_layout_->create(app_.device))
     {
@@ -149,6 +190,21 @@ void VCyclePressurePass::CreateDescriptorSets()
         throw std::runtime_error("Failed to create poisson relaxation descriptor set layout");
     }
 
+    // Red-black relaxation descriptor sets, updates the pressure field in place
+    red_black_relaxation_descriptor_set_layout_ = lava::descriptor::make();
+    red_black_relaxation_descriptor_set_layout_->add_binding(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                             VK_SHADER_STAGE_COMPUTE_BIT); // Divergence field
+    red_black_relaxation_descriptor_set_layout_->add_binding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                             VK_SHADER_STAGE_COMPUTE_BIT); // Pressure field
+    red_black_relaxation_descriptor_set_layout_->add_binding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                             VK_SHADER_STAGE_COMPUTE_BIT); // Boundary map
+
+    if (!red_black_relaxation_descriptor_set_layout_->create(app_.device))
+    {
+        lava::logger()->error("Failed to create red-black relaxation descriptor set layout");
+        throw std::runtime_error("Failed to create red-black relaxation descriptor set layout");
+    }
+
     // Residual calculation descriptor sets
     residual_descriptor_set_layout_ = lava::descriptor::make();
     residual_descriptor_set_layout_->add_binding(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
@@ -157,6 +213,10 @@ void VCyclePressurePass::CreateDescriptorSets()
                                                  VK_SHADER_STAGE_COMPUTE_BIT); // Pressure texture
     residual_descriptor_set_layout_->add_binding(2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
                                                  VK_SHADER_STAGE_COMPUTE_BIT); // Residual texture
+    residual_descriptor_set_layout_->add_binding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                 VK_SHADER_STAGE_COMPUTE_BIT); // Fine obstacle mask
+    residual_descriptor_set_layout_->add_binding(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                 VK_SHADER_STAGE_COMPUTE_BIT); // Fine boundary map
 
     if (!residual_descriptor_set_layout_->create(app_.device))
     {
@@ -170,6 +230,8 @@ void VCyclePressurePass::CreateDescriptorSets()
                                                     VK_SHADER_STAGE_COMPUTE_BIT); // Fine grid texture
     restriction_descriptor_set_layout_->add_binding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
                                                     VK_SHADER_STAGE_COMPUTE_BIT); // Coarse grid texture
+    restriction_descriptor_set_layout_->add_binding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                    VK_SHADER_STAGE_COMPUTE_BIT); // Fine obstacle mask
 
     if (!restriction_descriptor_set_layout_->create(app_.device))
     {
@@ -183,6 +245,10 @@ void VCyclePressurePass::CreateDescriptorSets()
                                                      VK_SHADER_STAGE_COMPUTE_BIT); // Coarse grid texture
     prolongation_descriptor_set_layout_->add_binding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
                                                      VK_SHADER_STAGE_COMPUTE_BIT); // Fine grid texture
+    prolongation_descriptor_set_layout_->add_binding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                     VK_SHADER_STAGE_COMPUTE_BIT); // Coarse obstacle mask
+    prolongation_descriptor_set_layout_->add_binding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                     VK_SHADER_STAGE_COMPUTE_BIT); // Fine obstacle mask
 
     if (!prolongation_descriptor_set_layout_->create(app_.device))
     {
@@ -194,6 +260,7 @@ void VCyclePressurePass::CreateDescriptorSets()
     relaxation_descriptor_sets_A_.resize(max_levels_);
     relaxation_descriptor_sets_B_.resize(max_levels_);
     poisson_relaxation_descriptor_sets_.resize(max_levels_);
+    red_black_relaxation_descriptor_sets_.resize(max_levels_);
     residual_descriptor_sets_.resize(max_levels_);
     restriction_descriptor_sets_.resize(max_levels_ - 1);
     prolongation_descriptor_sets_.resize(max_levels_ - 1);
@@ -204,6 +271,8 @@ void VCyclePressurePass::CreateDescriptorSets()
         relaxation_descriptor_sets_B_[level] = relaxation_descriptor_set_layout_->allocate(descriptor_pool_->get());
         poisson_relaxation_descriptor_sets_[level] =
             poisson_relaxation_descriptor_set_layout_->allocate(descriptor_pool_->get());
+        red_black_relaxation_descriptor_sets_[level] =
+            red_black_relaxation_descriptor_set_layout_->allocate(descriptor_pool_->get());
         residual_descriptor_sets_[level] = residual_descriptor_set_layout_->allocate(descriptor_pool_->get());
 
         if (level < max_levels_ - 1)
@@ -219,6 +288,16 @@ void VCyclePressurePass::UpdateDescriptorSets()
 {
     for (uint32_t level = 0; level < max_levels_; level++)
     {
+        // Every level samples its own solid fractions, so smoothers and transfers agree on which cells are solid
+        VkDescriptorImageInfo obstacle_info{.sampler = obstacle_masks_[level]->get_sampler(),
+                                            .imageView = obstacle_masks_[level]->get_image()->get_view(),
+                                            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+
+        // The stencils of every level read the boundary conditions BoundaryMapPass resolved for it
+        VkDescriptorImageInfo boundary_info{.sampler = boundary_maps_[level]->get_sampler(),
+                                            .imageView = boundary_maps_[level]->get_image()->get_view(),
+                                            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+
         // Update relaxation descriptor sets
         {
             VkDescriptorImageInfo divergence_info{.sampler = VK_NULL_HANDLE,
@@ -235,14 +314,10 @@ void VCyclePressurePass::UpdateDescriptorSets()
                                                       pressure_multigrid_texture_B_[level]->get_image()->get_view(),
                                                   .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
 
-            VkDescriptorImageInfo obstacle_info{.sampler = obstacle_mask_->get_sampler(),
-                                                .imageView = obstacle_mask_->get_image()->get_view(),
-                                                .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
-
             std::vector<VkDescriptorImageInfo> image_infos_A = {divergence_info, pressure_A_info, pressure_B_info,
-                                                                obstacle_info};
+                                                                boundary_info};
             std::vector<VkDescriptorImageInfo> image_infos_B = {divergence_info, pressure_B_info, pressure_A_info,
-                                                                obstacle_info};
+                                                                boundary_info};
 
             std::vector<VkDescriptorType> descriptor_types = {
                 VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
@@ -263,26 +338,34 @@ void VCyclePressurePass::UpdateDescriptorSets()
                                                     pressure_multigrid_texture_A_[level]->get_image()->get_view(),
                                                 .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
 
-            VkDescriptorImageInfo temp_info{.sampler = VK_NULL_HANDLE,
-                                            .imageView = multigrid_temp_textures_[level]->get_image()->get_view(),
-                                            .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+            std::vector<VkDescriptorImageInfo> image_infos = {divergence_info, pressure_info, boundary_info};
 
-            VkDescriptorImageInfo temp1_info{.sampler = VK_NULL_HANDLE,
-                                             .imageView = multigrid_temp_textures1_[level]->get_image()->get_view(),
-                                             .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+            std::vector<VkDescriptorType> descriptor_types = {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                              VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                              VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER};
 
-            VkDescriptorImageInfo obstacle_info{.sampler = obstacle_mask_->get_sampler(),
-                                                .imageView = obstacle_mask_->get_image()->get_view(),
-                                                .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+            ComputePass::UpdateDescriptorSets(poisson_relaxation_descriptor_sets_[level], image_infos,
+                                              descriptor_types);
+        }
 
-            std::vector<VkDescriptorImageInfo> image_infos = {divergence_info, pressure_info, temp_info, temp1_info,
-                                                              obstacle_info};
+        // Update red-black relaxation descriptor sets
+        {
+            VkDescriptorImageInfo divergence_info{.sampler = VK_NULL_HANDLE,
+                                                  .imageView = divergence_fields_[level]->get_image()->get_view(),
+                                                  .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
 
-            std::vector<VkDescriptorType> descriptor_types = {
-                VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
-                VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER};
+            VkDescriptorImageInfo pressure_info{.sampler = VK_NULL_HANDLE,
+                                                .imageView =
+                                                    pressure_multigrid_texture_A_[level]->get_image()->get_view(),
+                                                .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
 
-            ComputePass::UpdateDescriptorSets(poisson_relaxation_descriptor_sets_[level], image_infos,
+            std::vector<VkDescriptorImageInfo> image_infos = {divergence_info, pressure_info, boundary_info};
+
+            std::vector<VkDescriptorType> descriptor_types = {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                              VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                              VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER};
+
+            ComputePass::UpdateDescriptorSets(red_black_relaxation_descriptor_sets_[level], image_infos,
                                               descriptor_types);
         }
 
@@ -304,10 +387,12 @@ void VCyclePressurePass::UpdateDescriptorSets()
                     .imageView = divergence_fields_[level + 1]->get_image()->get_view(), // Residual at next level
                     .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
 
-                std::vector<VkDescriptorImageInfo> image_infos = {divergence_info, pressure_info, residual_info};
-                std::vector<VkDescriptorType> descriptor_types = {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
-                                                                  VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
-                                                                  VK_DESCRIPTOR_TYPE_STORAGE_IMAGE};
+                std::vector<VkDescriptorImageInfo> image_infos = {divergence_info, pressure_info, residual_info,
+                                                                  obstacle_info, boundary_info};
+                std::vector<VkDescriptorType> descriptor_types = {
+                    VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                    VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                    VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER};
 
                 ComputePass::UpdateDescriptorSets(residual_descriptor_sets_[level], image_infos, descriptor_types);
             }
@@ -323,9 +408,10 @@ void VCyclePressurePass::UpdateDescriptorSets()
                 .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
 
             std::vector<VkDescriptorImageInfo> restriction_infos = {fine_grid_divergence_info,
-                                                                    coarse_grid_divergence_info};
+                                                                    coarse_grid_divergence_info, obstacle_info};
             std::vector<VkDescriptorType> restriction_types = {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
-                                                               VK_DESCRIPTOR_TYPE_STORAGE_IMAGE};
+                                                               VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                               VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER};
 
             ComputePass::UpdateDescriptorSets(restriction_descriptor_sets_[level], restriction_infos,
                                               restriction_types);
@@ -339,11 +425,16 @@ void VCyclePressurePass::UpdateDescriptorSets()
                                                                .imageView = pressure_multigrid_texture_A_[level]->get_image()->get_view(),
                                                                .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
             
-            std::vector<VkDescriptorImageInfo> prolongation_infos = {coarse_grid_pressure_info,
-                                                                     fine_grid_pressure_info};
+            VkDescriptorImageInfo coarse_obstacle_info{.sampler = obstacle_masks_[level + 1]->get_sampler(),
+                                                       .imageView = obstacle_masks_[level + 1]->get_image()->get_view(),
+                                                       .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+
+            std::vector<VkDescriptorImageInfo> prolongation_infos = {coarse_grid_pressure_info, fine_grid_pressure_info,
+                                                                     coarse_obstacle_info, obstacle_info};
 
-            std::vector<VkDescriptorType> prolongation_types = {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
-                                                                VK_DESCRIPTOR_TYPE_STORAGE_IMAGE};
+            std::vector<VkDescriptorType> prolongation_types = {
+                VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER};
             ComputePass::UpdateDescriptorSets(prolongation_descriptor_sets_[level], prolongation_infos,
                                               prolongation_types);
         }
@@ -353,81 +444,146 @@ void VCyclePressurePass::UpdateDescriptorSets()
 void VCyclePressurePass::CreatePipeline()
 {
     CreateRelaxationPipeline();
+    CreateChebyshevRelaxationPipeline();
     CreateResidualPipeline();
     CreateRestrictionPipeline();
     CreateProlongationPipeline();
     CreatePoissonRelaxationPipeline();
-}
-
-void VCyclePressurePass::CreateBasePipeline(lava::compute_pipeline::s_ptr &pipeline, const char *shader_name,
-                                            lava::descriptor::s_ptr descriptor_set_layout,
-                                            lava::pipeline_layout::s_ptr &existing_pipeline_layout,
-                                            size_t push_constant_size)
-{
-    pipeline = lava::compute_pipeline::make(app_.device);
-    existing_pipeline_layout = lava::pipeline_layout::make();
-    existing_pipeline_layout->add(descriptor_set_layout);
-
-    if (push_constant_size > 0)
-    {
-        existing_pipeline_layout->add_push_constant_range(
-            {VK_SHADER_STAGE_COMPUTE_BIT, 0, static_cast<uint32_t>(push_constant_size)});
-    }
-
-    if (!existing_pipeline_layout->create(app_.device))
-    {
-        throw std::runtime_error("Failed to create pipeline layout");
-    }
-
-    lava::c_data shader_data = app_.producer.get_shader(shader_name);
-    if (!shader_data.addr)
-    {
-        throw std::runtime_error("Failed to load shader");
-    }
-
-    pipeline->set_shader_stage(shader_data, VK_SHADER_STAGE_COMPUTE_BIT);
-    pipeline->set_layout(existing_pipeline_layout);
-
-    if (!pipeline->create())
-    {
-        throw std::runtime_error("Failed to create pipeline");
-    }
+    CreateRedBlackRelaxationPipeline();
+    CreateBottomSolvePipeline();
 }
 
 void VCyclePressurePass::CreateRelaxationPipeline()
 {
-    relaxation_pipeline_ = lava::compute_pipeline::make(app_.device);
+    relaxation_pipeline_ = lava::compute_pipeline::make(app_.device, app_.pipeline_cache);
     CreateBasePipeline(relaxation_pipeline_, "PressureRelaxation.comp", relaxation_descriptor_set_layout_,
                        relaxation_pipeline_layout_, sizeof(SimulationConstants));
 }
 
+void VCyclePressurePass::CreateChebyshevRelaxationPipeline()
+{
+    chebyshev_relaxation_pipeline_ = lava::compute_pipeline::make(app_.device, app_.pipeline_cache);
+    CreateBasePipeline(chebyshev_relaxation_pipeline_, "PressureProjectionChebyshev.comp",
+                       relaxation_descriptor_set_layout_, chebyshev_relaxation_pipeline_layout_,
+                       sizeof(ChebyshevConstants));
+}
+
 void VCyclePressurePass::CreateResidualPipeline()
 {
-    residual_pipeline_ = lava::compute_pipeline::make(app_.device);
+    residual_pipeline_ = lava::compute_pipeline::make(app_.device, app_.pipeline_cache);
     CreateBasePipeline(residual_pipeline_, "PressureResidualCalculation.comp", residual_descriptor_set_layout_,
                        residual_pipeline_layout_, sizeof(MultigridConstants));
 }
 
 void VCyclePressurePass::CreateRestrictionPipeline()
 {
-    restriction_pipeline_ = lava::compute_pipeline::make(app_.device);
+    restriction_pipeline_ = lava::compute_pipeline::make(app_.device, app_.pipeline_cache);
     CreateBasePipeline(restriction_pipeline_, "PressureRestriction.comp", restriction_descriptor_set_layout_,
                        restriction_pipeline_layout_, sizeof(MultigridConstants));
 }
 
 void VCyclePressurePass::CreateProlongationPipeline()
 {
-    prolongation_pipeline_ = lava::compute_pipeline::make(app_.device);
+    prolongation_pipeline_ = lava::compute_pipeline::make(app_.device, app_.pipeline_cache);
     CreateBasePipeline(prolongation_pipeline_, "PressureProlongation.comp", prolongation_descriptor_set_layout_,
                        prolongation_pipeline_layout_, sizeof(MultigridConstants));
 }
 
 void VCyclePressurePass::CreatePoissonRelaxationPipeline()
 {
-    poisson_relaxation_pipeline_ = lava::compute_pipeline::make(app_.device);
-    CreateBasePipeline(poisson_relaxation_pipeline_, "PressureRelaxationPoisson.comp",
-                       poisson_relaxation_descriptor_set_layout_, poisson_relaxation_pipeline_layout_,
-                       sizeof(SimulationConstants));
+    poisson_relaxation_pipeline_layout_ =
+        CreatePipelineLayout(poisson_relaxation_descriptor_set_layout_, sizeof(SimulationConstants));
+    SetPoissonFilter(poisson_filter_);
+}
+
+void VCyclePressurePass::SetPoissonFilter(const PoissonFilterVariant &filter)
+{
+    if (!IsSupportedPoissonFilter(filter))
+    {
+        lava::logger()->error("Unsupported Poisson filter: order {}, {} ranks", filter.order, filter.ranks);
+        throw std::invalid_argument("Unsupported Poisson filter");
+    }
+
+    poisson_filter_ = filter;
+    for (uint32_t level = 0; level < max_levels_; level++)
+    {
+        GetPoissonRelaxationPipeline(level);
+    }
+}
+
+lava::compute_pipeline::s_ptr VCyclePressurePass::GetPoissonRelaxationPipeline(uint32_t level)
+{
+    // Coarse levels fall back to a shorter filter instead of mirroring most of the kernel back into the level
+    const glm::uvec2 size = pressure_multigrid_texture_A_[level]->get_image()->get_size();
+    const PoissonFilterVariant level_filter{FitPoissonFilterOrder(poisson_filter_.order, std::min(size.x, size.y)),
+                                            poisson_filter_.ranks};
+
+    auto &pipeline = poisson_relaxation_pipelines_[level_filter];
+    if (!pipeline)
+    {
+        const std::vector<VkSpecializationMapEntry> entries = {
+            {0, offsetof(PoissonFilterVariant, order), sizeof(int32_t)},
+            {1, offsetof(PoissonFilterVariant, ranks), sizeof(int32_t)}};
+
+        pipeline = CreateSpecializedPipeline("PressureRelaxationPoisson.comp", poisson_relaxation_pipeline_layout_,
+                                             entries, lava::c_data(&level_filter, sizeof(PoissonFilterVariant)));
+    }
+
+    return pipeline;
+}
+
+void VCyclePressurePass::CreateRedBlackRelaxationPipeline()
+{
+    red_black_relaxation_pipeline_ = lava::compute_pipeline::make(app_.device, app_.pipeline_cache);
+    CreateBasePipeline(red_black_relaxation_pipeline_, "PressureRelaxationRedBlack.comp",
+                       red_black_relaxation_descriptor_set_layout_, red_black_relaxation_pipeline_layout_,
+                       sizeof(RedBlackRelaxationConstants));
+}
+
+void VCyclePressurePass::CreateBottomSolvePipeline()
+{
+    bottom_solve_pipeline_ = lava::compute_pipeline::make(app_.device, app_.pipeline_cache);
+    CreateBasePipeline(bottom_solve_pipeline_, "PressureBottomSolve.comp", red_black_relaxation_descriptor_set_layout_,
+                       bottom_solve_pipeline_layout_, sizeof(BottomSolveConstants));
+}
+
+void VCyclePressurePass::SetBottomSolver(bool enabled)
+{
+    bottom_solver_ = false;
+    coarsest_level_ = max_levels_ - 1;
+
+    if (!enabled)
+    {
+        return;
+    }
+
+    for (uint32_t level = 0; level < max_levels_; level++)
+    {
+        const glm::uvec2 size = pressure_multigrid_texture_A_[level]->get_image()->get_size();
+        if (size.x <= MULTIGRID_BOTTOM_SOLVER_SIZE && size.y <= MULTIGRID_BOTTOM_SOLVER_SIZE)
+        {
+            bottom_solver_ = true;
+            coarsest_level_ = level;
+            return;
+        }
+    }
+}
+
+void VCyclePressurePass::PerformSmoothing(VkCommandBuffer cmd_buffer, const SimulationConstants &constants,
+                                          uint32_t level)
+{
+    switch (relaxation_type_)
+    {
+    case VCycleRelaxationType::Poisson_Filter:
+        PerformPoissonFilterRelaxation(cmd_buffer, constants, level);
+        break;
+    case VCycleRelaxationType::Red_Black_Gauss_Seidel:
+        PerformRedBlackRelaxation(cmd_buffer, constants, level);
+        break;
+    default:
+        PerformRelaxation(cmd_buffer, constants, level);
+        break;
+    }
 }
 
 void VCyclePressurePass::PerformRelaxation(VkCommandBuffer cmd_buffer, const SimulationConstants &constants,
@@ -437,76 +593,187 @@ void VCyclePressurePass::PerformRelaxation(VkCommandBuffer cmd_buffer, const Sim
     lava::texture::s_ptr active_read_texture = pressure_multigrid_texture_A_[level];
     lava::texture::s_ptr active_write_texture = pressure_multigrid_texture_B_[level];
 
-    divergence_fields_[level]->get_image()->transition_layout(
-        cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    // Chebyshev weights damp the eigenvalues above a quarter of the bound, the smooth rest is left to coarser levels
+    std::vector<std::array<float, 2>> chebyshev_weights;
+    if (chebyshev_smoothing_)
+    {
+        chebyshev_weights =
+            CalculateChebyshevWeights(CHEBYSHEV_SPECTRUM_UPPER_BOUND / CHEBYSHEV_SMOOTHING_RANGE,
+                                      CHEBYSHEV_SPECTRUM_UPPER_BOUND, relaxation_iterations_);
+    }
+
+    // The Chebyshev kernel also reads the written texture, it holds the iterate before the one being read
+    const VkAccessFlags write_access =
+        chebyshev_smoothing_ ? VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT : VK_ACCESS_SHADER_WRITE_BIT;
 
     for (uint32_t i = 0; i < relaxation_iterations_; i++)
     {
-        active_read_texture->get_image()->transition_layout(
-            cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-        active_write_texture->get_image()->transition_layout(
-            cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        // The divergence only needs its barrier ahead of the first sweep, later reads are dropped by the batch
+        barriers_.Transition(divergence_fields_[level], VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT);
+        barriers_.Transition(active_read_texture, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT);
+        barriers_.Transition(active_write_texture, VK_IMAGE_LAYOUT_GENERAL, write_access);
+        barriers_.Flush(cmd_buffer);
 
         VkDescriptorSet pressure_descriptor_set =
             (i % 2 == 0) ? relaxation_descriptor_sets_A_[level] : relaxation_descriptor_sets_B_[level];
 
-        relaxation_pipeline_->bind(cmd_buffer);
-        vkCmdPushConstants(cmd_buffer, relaxation_pipeline_->get_layout()->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0,
-                           sizeof(SimulationConstants), &constants);
-        vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, relaxation_pipeline_->get_layout()->get(),
-                                0, 1, &pressure_descriptor_set, 0, nullptr);
+        if (chebyshev_smoothing_)
+        {
+            ChebyshevConstants chebyshev_constants{};
+            chebyshev_constants.simulation = constants;
+            chebyshev_constants.previous_weight = chebyshev_weights[i][0];
+            chebyshev_constants.jacobi_weight = chebyshev_weights[i][1];
+
+            chebyshev_relaxation_pipeline_->bind(cmd_buffer);
+            vkCmdPushConstants(cmd_buffer, chebyshev_relaxation_pipeline_layout_->get(), VK_SHADER_STAGE_COMPUTE_BIT,
+                               0, sizeof(ChebyshevConstants), &chebyshev_constants);
+            vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                                    chebyshev_relaxation_pipeline_layout_->get(), 0, 1, &pressure_descriptor_set, 0,
+                                    nullptr);
+        }
+        else
+        {
+            relaxation_pipeline_->bind(cmd_buffer);
+            vkCmdPushConstants(cmd_buffer, relaxation_pipeline_->get_layout()->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                               sizeof(SimulationConstants), &constants);
+            vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                                    relaxation_pipeline_->get_layout()->get(), 0, 1, &pressure_descriptor_set, 0,
+                                    nullptr);
+        }
 
-        vkCmdDispatch(cmd_buffer, (constants.texture_width + 15) / 16, (constants.texture_height + 15) / 16, 1);
+        DispatchLevel(cmd_buffer, level, constants.texture_width, constants.texture_height);
 
         // Swap read/write textures for next iteration
         std::swap(active_read_texture, active_write_texture);
     }
-
-    // Ensure final result is in texture A
-    std::swap(pressure_multigrid_texture_A_[level], pressure_multigrid_texture_B_[level]);
-    std::swap(relaxation_descriptor_sets_A_[level], relaxation_descriptor_sets_B_[level]);
 }
 
 void VCyclePressurePass::PerformPoissonFilterRelaxation(VkCommandBuffer cmd_buffer,
                                                         const SimulationConstants &constants, uint32_t level)
 {
-    divergence_fields_[level]->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT,
-                                                      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    barriers_.Transition(divergence_fields_[level], VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT);
+    barriers_.Transition(pressure_multigrid_texture_A_[level], VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT);
+    barriers_.Flush(cmd_buffer);
 
-    pressure_multigrid_texture_A_[level]->get_image()->transition_layout(
-        cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    GetPoissonRelaxationPipeline(level)->bind(cmd_buffer);
 
-    multigrid_temp_textures_[level]->get_image()->transition_layout(
-        cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
-        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    vkCmdPushConstants(cmd_buffer, poisson_relaxation_pipeline_layout_->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(SimulationConstants), &constants);
 
-    multigrid_temp_textures1_[level]->get_image()->transition_layout(
-        cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
-        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, poisson_relaxation_pipeline_layout_->get(),
+                            0, 1,
+                            &poisson_relaxation_descriptor_sets_[level], 0, nullptr);
 
-    poisson_relaxation_pipeline_->bind(cmd_buffer);
+    DispatchLevel(cmd_buffer, level, constants.texture_width, constants.texture_height);
+}
 
-    vkCmdPushConstants(cmd_buffer, poisson_relaxation_pipeline_->get_layout()->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0,
-                       sizeof(SimulationConstants), &constants);
+void VCyclePressurePass::PerformRedBlackRelaxation(VkCommandBuffer cmd_buffer, const SimulationConstants &constants,
+                                                   uint32_t level)
+{
+    RedBlackRelaxationConstants red_black_constants{};
+    red_black_constants.simulation = constants;
+    red_black_constants.relaxation_omega = relaxation_omega_;
 
+    red_black_relaxation_pipeline_->bind(cmd_buffer);
     vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
-                            poisson_relaxation_pipeline_->get_layout()->get(), 0, 1,
-                            &poisson_relaxation_descriptor_sets_[level], 0, nullptr);
+                            red_black_relaxation_pipeline_->get_layout()->get(), 0, 1,
+                            &red_black_relaxation_descriptor_sets_[level], 0, nullptr);
+
+    // Only half of the cells are updated per dispatch, each colour reads the freshly written other colour
+    const uint32_t half_width = (constants.texture_width + 1) / 2;
+
+    for (uint32_t i = 0; i < relaxation_iterations_; i++)
+    {
+        for (int parity = 0; parity < 2; parity++)
+        {
+            barriers_.Transition(divergence_fields_[level], VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT);
+            barriers_.Transition(pressure_multigrid_texture_A_[level], VK_IMAGE_LAYOUT_GENERAL,
+                                 VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+            barriers_.Flush(cmd_buffer);
+
+            red_black_constants.parity = parity;
+            vkCmdPushConstants(cmd_buffer, red_black_relaxation_pipeline_->get_layout()->get(),
+                               VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(RedBlackRelaxationConstants),
+                               &red_black_constants);
+
+            if (convergence_control_)
+            {
+                convergence_control_->DispatchRedBlack(cmd_buffer, level);
+            }
+            else
+            {
+                vkCmdDispatch(cmd_buffer, (half_width + 15) / 16, (constants.texture_height + 15) / 16, 1);
+            }
+        }
+    }
+}
+
+void VCyclePressurePass::PerformCoarsestSolve(VkCommandBuffer cmd_buffer, const SimulationConstants &constants)
+{
+    const SimulationConstants level_constants = CalculateLevelConstants(constants, coarsest_level_);
 
-    vkCmdDispatch(cmd_buffer, (constants.texture_width + 15) / 16, (constants.texture_height + 15) / 16, 1);
+    if (bottom_solver_)
+    {
+        PerformBottomSolve(cmd_buffer, level_constants, coarsest_level_);
+    }
+    else
+    {
+        PerformSmoothing(cmd_buffer, level_constants, coarsest_level_);
+    }
 }
 
-void VCyclePressurePass::CalculateResidual(VkCommandBuffer cmd_buffer, const MultigridConstants &constants,
-                                           uint32_t level)
+void VCyclePressurePass::PerformBottomSolve(VkCommandBuffer cmd_buffer, const SimulationConstants &constants,
+                                            uint32_t level)
 {
-    divergence_fields_[level]->get_image()->transition_layout(
-        cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    barriers_.Transition(divergence_fields_[level], VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT);
+    barriers_.Transition(pressure_multigrid_texture_A_[level], VK_IMAGE_LAYOUT_GENERAL,
+                         VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    barriers_.Flush(cmd_buffer);
+
+    // Optimal SOR needs about one sweep per cell along the longer side to shed a decade of error, two per cell
+    // leave the level converged well below half precision
+    const int longest_side = std::max(constants.texture_width, constants.texture_height);
+
+    BottomSolveConstants bottom_constants{};
+    bottom_constants.simulation = constants;
+    bottom_constants.sweeps = 2 * longest_side;
+    bottom_constants.relaxation_omega =
+        2.0f / (1.0f + std::sin(std::numbers::pi_v<float> / static_cast<float>(std::max(longest_side, 2))));
+
+    bottom_solve_pipeline_->bind(cmd_buffer);
+    vkCmdPushConstants(cmd_buffer, bottom_solve_pipeline_layout_->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(BottomSolveConstants), &bottom_constants);
+    vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, bottom_solve_pipeline_layout_->get(), 0, 1,
+                            &red_black_relaxation_descriptor_sets_[level], 0, nullptr);
+
+    if (convergence_control_)
+    {
+        convergence_control_->DispatchSingleGroup(cmd_buffer);
+    }
+    else
+    {
+        vkCmdDispatch(cmd_buffer, 1, 1, 1);
+    }
+}
 
-    pressure_multigrid_texture_A_[level]->get_image()->transition_layout(
-        cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+void VCyclePressurePass::ClearPressure(VkCommandBuffer cmd_buffer, uint32_t level)
+{
+    auto image = pressure_multigrid_texture_A_[level]->get_image();
+    image->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_TRANSFER_WRITE_BIT,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT);
 
-    divergence_fields_[level + 1]->get_image()->transition_layout(
-        cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    VkClearColorValue clear_value{};
+    VkImageSubresourceRange range{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    vkCmdClearColorImage(cmd_buffer, image->get(), VK_IMAGE_LAYOUT_GENERAL, &clear_value, 1, &range);
+}
+
+void VCyclePressurePass::CalculateResidual(VkCommandBuffer cmd_buffer, const MultigridConstants &constants,
+                                           uint32_t level)
+{
+    barriers_.Transition(divergence_fields_[level], VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT);
+    barriers_.Transition(pressure_multigrid_texture_A_[level], VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT);
+    barriers_.Transition(divergence_fields_[level + 1], VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT);
+    barriers_.Flush(cmd_buffer);
 
     residual_pipeline_->bind(cmd_buffer);
 
@@ -516,18 +783,16 @@ void VCyclePressurePass::CalculateResidual(VkCommandBuffer cmd_buffer, const Mul
     vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, residual_pipeline_->get_layout()->get(), 0, 1,
                             &residual_descriptor_sets_[level], 0, nullptr);
 
-    vkCmdDispatch(cmd_buffer, (constants.coarse_width + 15) / 16, (constants.coarse_height + 15) / 16, 1);
+    DispatchLevel(cmd_buffer, level + 1, constants.coarse_width, constants.coarse_height);
 }
 
 
 void VCyclePressurePass::PerformRestriction(VkCommandBuffer cmd_buffer, const MultigridConstants &constants,
                                             uint32_t level)
 {
-    divergence_fields_[level]->get_image()->transition_layout(
-        cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-
-    divergence_fields_[level + 1]->get_image()->transition_layout(
-        cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    barriers_.Transition(divergence_fields_[level], VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT);
+    barriers_.Transition(divergence_fields_[level + 1], VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT);
+    barriers_.Flush(cmd_buffer);
 
     restriction_pipeline_->bind(cmd_buffer);
     vkCmdPushConstants(cmd_buffer, restriction_pipeline_->get_layout()->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0,
@@ -535,93 +800,168 @@ void VCyclePressurePass::PerformRestriction(VkCommandBuffer cmd_buffer, const Mu
     vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, restriction_pipeline_->get_layout()->get(), 0,
                             1, &restriction_descriptor_sets_[level], 0, nullptr);
 
-    vkCmdDispatch(cmd_buffer, (constants.coarse_width + 15) / 16, (constants.coarse_height + 15) / 16, 1);
+    DispatchLevel(cmd_buffer, level + 1, constants.coarse_width, constants.coarse_height);
 }
 
 void VCyclePressurePass::PerformProlongation(VkCommandBuffer cmd_buffer, const MultigridConstants &constants,
                                              uint32_t level)
 {
-    pressure_multigrid_texture_A_[level + 1]->get_image()->transition_layout(
-        cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-
-    pressure_multigrid_texture_A_[level]->get_image()->transition_layout(
-        cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
-        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    barriers_.Transition(pressure_multigrid_texture_A_[level + 1], VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT);
+    barriers_.Transition(pressure_multigrid_texture_A_[level], VK_IMAGE_LAYOUT_GENERAL,
+                         VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    barriers_.Flush(cmd_buffer);
 
     prolongation_pipeline_->bind(cmd_buffer);
     vkCmdPushConstants(cmd_buffer, prolongation_pipeline_->get_layout()->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0,
                        sizeof(MultigridConstants), &constants);
     vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, prolongation_pipeline_->get_layout()->get(), 0,
                             1, &prolongation_descriptor_sets_[level], 0, nullptr);
-    vkCmdDispatch(cmd_buffer, (constants.fine_width + 15) / 16, (constants.fine_height + 15) / 16, 1);
+    DispatchLevel(cmd_buffer, level, constants.fine_width, constants.fine_height);
 }
 
 void VCyclePressurePass::Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants)
 {
-    for (int i = 0; i < vcycle_iterations_; i++)
+    uint32_t cycles = vcycle_iterations_;
+
+    // Full multigrid replaces the first cycle and overwrites the previous solution with its own initial guess
+    if (cycle_type_ == MultigridCycleType::Full_Multigrid && cycles > 0)
+    {
+        PerformFullMultigrid(cmd_buffer, constants);
+        cycles--;
+    }
+    else if (zero_initial_guess_)
     {
-        // Initial relaxation for the finest grid
-        if (relaxation_type_ == VCycleRelaxationType::Poisson_Filter)
+        ClearPressure(cmd_buffer, 0);
+    }
+
+    for (uint32_t i = 0; i < cycles; i++)
+    {
+        if (convergence_control_ && check_between_cycles_ && (i > 0 || cycles < vcycle_iterations_))
         {
-            PerformPoissonFilterRelaxation(cmd_buffer, constants, 0);
+            convergence_control_->Execute(cmd_buffer, constants);
         }
-        else
+
+        switch (cycle_type_)
         {
-            PerformRelaxation(cmd_buffer, constants, 0);
+        case MultigridCycleType::W_Cycle:
+            PerformCycle(cmd_buffer, constants, 0, 2);
+            break;
+        case MultigridCycleType::F_Cycle:
+            PerformFCycle(cmd_buffer, constants, 0);
+            break;
+        default:
+            PerformCycle(cmd_buffer, constants, 0, 1);
+            break;
         }
+    }
+}
 
-        SimulationConstants level_constants = constants;
+void VCyclePressurePass::DispatchLevel(VkCommandBuffer cmd_buffer, uint32_t level, uint32_t width, uint32_t height)
+{
+    // Once the control pass saw the residual drop below the tolerance the arguments are zero and nothing runs
+    if (convergence_control_)
+    {
+        convergence_control_->DispatchLevel(cmd_buffer, level);
+    }
+    else
+    {
+        vkCmdDispatch(cmd_buffer, (width + 15) / 16, (height + 15) / 16, 1);
+    }
+}
 
-        // Restrict residual to coarser grids
-        for (uint32_t level = 0; level < max_levels_ - 1; level++)
-        {
-            MultigridConstants multigrid_constants = CalculateMultigridConstants(level);
-            CalculateResidual(cmd_buffer, multigrid_constants, level);
-            PerformRestriction(cmd_buffer, multigrid_constants, level);
+void VCyclePressurePass::PerformCycle(VkCommandBuffer cmd_buffer, const SimulationConstants &constants,
+                                      uint32_t level, uint32_t coarse_visits)
+{
+    if (level == coarsest_level_)
+    {
+        PerformCoarsestSolve(cmd_buffer, constants);
+        return;
+    }
 
-            level_constants.texture_width = pressure_multigrid_texture_A_[level + 1]->get_image()->get_size().x;
-            level_constants.texture_height = pressure_multigrid_texture_A_[level + 1]->get_image()->get_size().y;
+    const SimulationConstants level_constants = CalculateLevelConstants(constants, level);
+    PerformSmoothing(cmd_buffer, level_constants, level);
 
-            if (relaxation_type_ == VCycleRelaxationType::Poisson_Filter)
-            {
-                PerformPoissonFilterRelaxation(cmd_buffer, level_constants, level + 1);
-            }
-            else
-            {
-                PerformRelaxation(cmd_buffer, level_constants, level + 1);
-            }
-        }
+    // The coarser level solves for a correction starting from zero, driven by the restricted residual
+    MultigridConstants multigrid_constants = CalculateMultigridConstants(level);
+    CalculateResidual(cmd_buffer, multigrid_constants, level);
+    ClearPressure(cmd_buffer, level + 1);
 
-        // Prolong correction back to finer grids
-        for (int32_t level = max_levels_ - 2; level >= 0; level--)
-        {
-            MultigridConstants multigrid_constants = CalculateMultigridConstants(level);
-            PerformProlongation(cmd_buffer, multigrid_constants, level);
+    // One visit per level gives the V shape, two visits the W shape
+    for (uint32_t visit = 0; visit < coarse_visits; visit++)
+    {
+        PerformCycle(cmd_buffer, constants, level + 1, coarse_visits);
+    }
+
+    PerformProlongation(cmd_buffer, multigrid_constants, level);
+    PerformSmoothing(cmd_buffer, level_constants, level);
+}
 
-            level_constants.texture_width = pressure_multigrid_texture_A_[level]->get_image()->get_size().x;
-            level_constants.texture_height = pressure_multigrid_texture_A_[level]->get_image()->get_size().y;
+void VCyclePressurePass::PerformFCycle(VkCommandBuffer cmd_buffer, const SimulationConstants &constants,
+                                       uint32_t level)
+{
+    if (level == coarsest_level_)
+    {
+        PerformCoarsestSolve(cmd_buffer, constants);
+        return;
+    }
 
-            if (relaxation_type_ == VCycleRelaxationType::Poisson_Filter)
-            {
-                PerformPoissonFilterRelaxation(cmd_buffer, level_constants, level);
-            }
-            else
-            {
-                PerformRelaxation(cmd_buffer, level_constants, level);
-            }
-        }
+    const SimulationConstants level_constants = CalculateLevelConstants(constants, level);
+    PerformSmoothing(cmd_buffer, level_constants, level);
+
+    MultigridConstants multigrid_constants = CalculateMultigridConstants(level);
+    CalculateResidual(cmd_buffer, multigrid_constants, level);
+    ClearPressure(cmd_buffer, level + 1);
+
+    // An F-cycle on the coarse correction followed by a V-cycle refining it
+    PerformFCycle(cmd_buffer, constants, level + 1);
+    PerformCycle(cmd_buffer, constants, level + 1, 1);
+
+    PerformProlongation(cmd_buffer, multigrid_constants, level);
+    PerformSmoothing(cmd_buffer, level_constants, level);
+}
+
+void VCyclePressurePass::PerformFullMultigrid(VkCommandBuffer cmd_buffer, const SimulationConstants &constants)
+{
+    // Restrict the right hand side itself, every level then holds the full problem at its resolution
+    for (uint32_t level = 0; level < coarsest_level_; level++)
+    {
+        PerformRestriction(cmd_buffer, CalculateMultigridConstants(level), level);
+    }
+
+    ClearPressure(cmd_buffer, coarsest_level_);
+    PerformCoarsestSolve(cmd_buffer, constants);
+
+    // Interpolate each solution as the initial guess of the next finer level and improve it with one V-cycle
+    for (int32_t level = static_cast<int32_t>(coarsest_level_) - 1; level >= 0; level--)
+    {
+        MultigridConstants multigrid_constants = CalculateMultigridConstants(level);
+        multigrid_constants.replace_fine_values = 1;
+        PerformProlongation(cmd_buffer, multigrid_constants, level);
+
+        PerformCycle(cmd_buffer, constants, level, 1);
     }
 }
 
-MultigridConstants VCyclePressurePass::CalculateMultigridConstants(uint32_t level) const
+SimulationConstants VCyclePressurePass::CalculateLevelConstants(const SimulationConstants &constants,
+                                                                uint32_t level) const
 {
-    MultigridConstants constants;
-    const glm::uvec2 &window_size = app_.target->get_size();
+    SimulationConstants level_constants = constants;
+    level_constants.texture_width = pressure_multigrid_texture_A_[level]->get_image()->get_size().x;
+    level_constants.texture_height = pressure_multigrid_texture_A_[level]->get_image()->get_size().y;
+
+    return level_constants;
+}
 
-    constants.fine_width = std::max(1u, window_size.x / (1 << level));
-    constants.fine_height = std::max(1u, window_size.y / (1 << level));
-    constants.coarse_width = std::max(1u, window_size.x / (1 << (level + 1)));
-    constants.coarse_height = std::max(1u, window_size.y / (1 << (level + 1)));
+MultigridConstants VCyclePressurePass::CalculateMultigridConstants(uint32_t level) const
+{
+    MultigridConstants constants{};
+    const glm::uvec2 fine_size = pressure_multigrid_texture_A_[level]->get_image()->get_size();
+    const glm::uvec2 coarse_size = pressure_multigrid_texture_A_[level + 1]->get_image()->get_size();
+
+    constants.fine_width = static_cast<int>(fine_size.x);
+    constants.fine_height = static_cast<int>(fine_size.y);
+    constants.coarse_width = static_cast<int>(coarse_size.x);
+    constants.coarse_height = static_cast<int>(coarse_size.y);
 
     return constants;
 }
@@ -1,4 +1,5 @@
 #include "VelocityAdvectionPass.hpp"
+#include <cstddef>
 
 namespace FluidSimulation
 {
@@ -10,7 +11,10 @@ VelocityAdvectionPass::VelocityAdvectionPass(lava::engine &app, lava::descriptor
 
     velocity_field_ = resource_manager.GetTexture("velocity_field");
     advected_field_ = resource_manager.GetTexture("advected_velocity_field");
-    obstacle_mask_ = resource_manager.GetTexture("obstacle_mask");
+    predicted_field_ = resource_manager.GetTexture("predicted_velocity_field");
+    obstacle_distance_ = resource_manager.GetTexture("obstacle_distance");
+    tile_buffer_ = resource_manager.GetBuffer("active_tiles");
+    step_time_buffer_ = resource_manager.GetBuffer("step_time");
 
     CreateDescriptorSets();
     CreatePipeline();
@@ -19,6 +23,20 @@ VelocityAdvectionPass::VelocityAdvectionPass(lava::engine &app, lava::descriptor
 
 VelocityAdvectionPass::~VelocityAdvectionPass()
 {
+    for (auto &&[backtrace, pipelines] : backtrace_pipelines_)
+    {
+        pipelines.advection->destroy();
+        pipelines.predictor->destroy();
+        pipelines.correction->destroy();
+    }
+    if (correction_pipeline_layout_)
+    {
+        correction_pipeline_layout_->destroy();
+    }
+    if (correction_descriptor_set_layout_)
+    {
+        correction_descriptor_set_layout_->destroy();
+    }
     if (descriptor_set_layout_)
     {
         descriptor_set_layout_->destroy();
@@ -33,7 +51,11 @@ void VelocityAdvectionPass::CreateDescriptorSets()
     descriptor_set_layout_->add_binding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
                                         VK_SHADER_STAGE_COMPUTE_BIT); // Advected velocity field
     descriptor_set_layout_->add_binding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                        VK_SHADER_STAGE_COMPUTE_BIT); // Obstacle mask
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Obstacle distance
+    descriptor_set_layout_->add_binding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Tile lists
+    descriptor_set_layout_->add_binding(4, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Step time
 
     if (!descriptor_set_layout_->create(app_.device))
     {
@@ -41,8 +63,32 @@ void VelocityAdvectionPass::CreateDescriptorSets()
         throw std::runtime_error("Failed to create velocity advection descriptor set layout");
     }
 
+    correction_descriptor_set_layout_ = lava::descriptor::make();
+    correction_descriptor_set_layout_->add_binding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                   VK_SHADER_STAGE_COMPUTE_BIT); // Velocity field
+    correction_descriptor_set_layout_->add_binding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                   VK_SHADER_STAGE_COMPUTE_BIT); // Advected field, the velocity
+    correction_descriptor_set_layout_->add_binding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                   VK_SHADER_STAGE_COMPUTE_BIT); // Predicted velocity field
+    correction_descriptor_set_layout_->add_binding(3, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                                   VK_SHADER_STAGE_COMPUTE_BIT); // Advected velocity field
+    correction_descriptor_set_layout_->add_binding(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                   VK_SHADER_STAGE_COMPUTE_BIT); // Obstacle distance
+    correction_descriptor_set_layout_->add_binding(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                                   VK_SHADER_STAGE_COMPUTE_BIT); // Tile lists
+    correction_descriptor_set_layout_->add_binding(6, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                                                   VK_SHADER_STAGE_COMPUTE_BIT); // Step time
+
+    if (!correction_descriptor_set_layout_->create(app_.device))
+    {
+        lava::logger()->error("Failed to create velocity correction descriptor set layout");
+        throw std::runtime_error("Failed to create velocity correction descriptor set layout");
+    }
+
     descriptor_set_ = descriptor_set_layout_->allocate(descriptor_pool_->get());
-    if (!descriptor_set_)
+    predictor_descriptor_set_ = descriptor_set_layout_->allocate(descriptor_pool_->get());
+    correction_descriptor_set_ = correction_descriptor_set_layout_->allocate(descriptor_pool_->get());
+    if (!descriptor_set_ || !predictor_descriptor_set_ || !correction_descriptor_set_)
     {
         lava::logger()->error("Failed to allocate velocity advection descriptor set");
         throw std::runtime_error("Failed to allocate velocity advection descriptor set");
@@ -59,36 +105,115 @@ void VelocityAdvectionPass::UpdateDescriptorSets()
                                               .imageView = advected_field_->get_image()->get_view(),
                                               .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
 
-    VkDescriptorImageInfo obstacle_mask_info{.sampler = obstacle_mask_->get_sampler(),
-                                             .imageView = obstacle_mask_->get_image()->get_view(),
-                                             .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    VkDescriptorImageInfo obstacle_distance_info{.sampler = obstacle_distance_->get_sampler(),
+                                                 .imageView = obstacle_distance_->get_image()->get_view(),
+                                                 .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
 
-    std::vector<VkDescriptorImageInfo> image_infos = {velocity_field_info, advected_field_info, obstacle_mask_info};
+    std::vector<VkDescriptorImageInfo> image_infos = {velocity_field_info, advected_field_info, obstacle_distance_info};
 
     std::vector<VkDescriptorType> descriptor_types = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
                                                       VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
                                                       VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER};
 
     ComputePass::UpdateDescriptorSets(descriptor_set_, image_infos, descriptor_types);
+
+    VkDescriptorImageInfo predicted_field_storage_info{.sampler = VK_NULL_HANDLE,
+                                                       .imageView = predicted_field_->get_image()->get_view(),
+                                                       .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+
+    VkDescriptorImageInfo predicted_field_info{.sampler = predicted_field_->get_sampler(),
+                                               .imageView = predicted_field_->get_image()->get_view(),
+                                               .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+
+    ComputePass::UpdateDescriptorSets(predictor_descriptor_set_,
+                                      {velocity_field_info, predicted_field_storage_info, obstacle_distance_info},
+                                      descriptor_types);
+
+    ComputePass::UpdateDescriptorSets(
+        correction_descriptor_set_,
+        {velocity_field_info, velocity_field_info, predicted_field_info, advected_field_info, obstacle_distance_info},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+         VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+         VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER});
+
+    const std::vector<VkDescriptorBufferInfo> buffer_infos = {*tile_buffer_->get_descriptor_info(),
+                                                              *step_time_buffer_->get_descriptor_info()};
+    const std::vector<VkDescriptorType> buffer_types = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                                        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER};
+
+    ComputePass::UpdateDescriptorSets(descriptor_set_, buffer_infos, buffer_types, 3);
+    ComputePass::UpdateDescriptorSets(predictor_descriptor_set_, buffer_infos, buffer_types, 3);
+    ComputePass::UpdateDescriptorSets(correction_descriptor_set_, buffer_infos, buffer_types, 5);
 }
 
 void VelocityAdvectionPass::CreatePipeline()
 {
-    CreateBasePipeline("VelocityAdvection.comp", descriptor_set_layout_, sizeof(SimulationConstants));
+    pipeline_layout_ = CreatePipelineLayout(descriptor_set_layout_, sizeof(SimulationConstants));
+    correction_pipeline_layout_ = CreatePipelineLayout(correction_descriptor_set_layout_, sizeof(SimulationConstants));
+    GetBacktracePipelines(backtrace_);
+}
+
+void VelocityAdvectionPass::SetBacktrace(const BacktraceVariant &backtrace)
+{
+    if (!IsSupportedBacktrace(backtrace))
+    {
+        lava::logger()->error("Unsupported backtrace: integrator {}, {} substeps",
+                              static_cast<int32_t>(backtrace.integrator), backtrace.substeps);
+        throw std::invalid_argument("Unsupported backtrace");
+    }
+
+    GetBacktracePipelines(backtrace);
+    backtrace_ = backtrace;
+}
+
+const VelocityAdvectionPass::AdvectionPipelines &VelocityAdvectionPass::GetBacktracePipelines(
+    const BacktraceVariant &backtrace)
+{
+    auto &pipelines = backtrace_pipelines_[backtrace];
+    if (!pipelines.advection)
+    {
+        const std::vector<VkSpecializationMapEntry> entries = {
+            {0, offsetof(AdvectionSpecialization, kernel_switch), sizeof(VkBool32)},
+            {1, offsetof(AdvectionSpecialization, backtrace) + offsetof(BacktraceVariant, integrator), sizeof(int32_t)},
+            {2, offsetof(AdvectionSpecialization, backtrace) + offsetof(BacktraceVariant, substeps), sizeof(int32_t)}};
+
+        // The switch applies the forces in the plain kernel and selects the velocity field in the corrector
+        const AdvectionSpecialization advection{VK_TRUE, backtrace};
+        const AdvectionSpecialization predictor{VK_FALSE, backtrace};
+
+        pipelines.advection = CreateSpecializedPipeline("VelocityAdvection.comp", pipeline_layout_, entries,
+                                                        lava::c_data(&advection, sizeof(AdvectionSpecialization)));
+        pipelines.predictor = CreateSpecializedPipeline("VelocityAdvection.comp", pipeline_layout_, entries,
+                                                        lava::c_data(&predictor, sizeof(AdvectionSpecialization)));
+        pipelines.correction =
+            CreateSpecializedPipeline("MacCormackCorrection.comp", correction_pipeline_layout_, entries,
+                                      lava::c_data(&advection, sizeof(AdvectionSpecialization)));
+    }
+
+    return pipelines;
+}
+
+// Both lists of active tiles in one dispatch, every tile of the grid while sparse simulation is off
+void VelocityAdvectionPass::DispatchTiles(VkCommandBuffer cmd_buffer)
+{
+    vkCmdDispatchIndirect(cmd_buffer, tile_buffer_->get(), offsetof(TileClassificationHeader, combined_dispatch));
 }
 
 void VelocityAdvectionPass::Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants)
 {
-    velocity_field_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                                                    VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    barriers_.Transition(velocity_field_, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT);
+    barriers_.Transition(obstacle_distance_, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT);
 
-    advected_field_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT,
-                                                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    if (advection_scheme_ == AdvectionScheme::MacCormack)
+    {
+        ExecuteMacCormack(cmd_buffer, constants);
+        return;
+    }
 
-    obstacle_mask_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                                                   VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    barriers_.Transition(advected_field_, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT);
+    barriers_.Flush(cmd_buffer);
 
-    pipeline_->bind(cmd_buffer);
+    backtrace_pipelines_[backtrace_].advection->bind(cmd_buffer);
 
     vkCmdPushConstants(cmd_buffer, pipeline_layout_->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SimulationConstants),
                        &constants);
@@ -96,9 +221,37 @@ void VelocityAdvectionPass::Execute(VkCommandBuffer cmd_buffer, const Simulation
     vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_->get(), 0, 1, &descriptor_set_,
                             0, nullptr);
 
-    uint32_t group_count_x = (constants.texture_width + 15) / 16;
-    uint32_t group_count_y = (constants.texture_height + 15) / 16;
-    vkCmdDispatch(cmd_buffer, group_count_x, group_count_y, 1);
+    DispatchTiles(cmd_buffer);
+}
+
+void VelocityAdvectionPass::ExecuteMacCormack(VkCommandBuffer cmd_buffer, const SimulationConstants &constants)
+{
+    barriers_.Transition(predicted_field_, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT);
+    barriers_.Flush(cmd_buffer);
+
+    backtrace_pipelines_[backtrace_].predictor->bind(cmd_buffer);
+
+    vkCmdPushConstants(cmd_buffer, pipeline_layout_->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SimulationConstants),
+                       &constants);
+
+    vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_->get(), 0, 1,
+                            &predictor_descriptor_set_, 0, nullptr);
+
+    DispatchTiles(cmd_buffer);
+
+    barriers_.Transition(predicted_field_, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT);
+    barriers_.Transition(advected_field_, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT);
+    barriers_.Flush(cmd_buffer);
+
+    backtrace_pipelines_[backtrace_].correction->bind(cmd_buffer);
+
+    vkCmdPushConstants(cmd_buffer, correction_pipeline_layout_->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                       sizeof(SimulationConstants), &constants);
+
+    vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, correction_pipeline_layout_->get(), 0, 1,
+                            &correction_descriptor_set_, 0, nullptr);
+
+    DispatchTiles(cmd_buffer);
 }
 
-} // namespace FluidSimulation
\ No newline at end of file
+} // namespace FluidSimulation
@@ -10,7 +10,8 @@ VelocityUpdatePass::VelocityUpdatePass(lava::engine &app, lava::descriptor::pool
     pressure_field_ = resource_manager.GetTexture("pressure_field_A");
     advected_velocity_field_ = resource_manager.GetTexture("advected_velocity_field");
     velocity_field_ = resource_manager.GetTexture("velocity_field");
-    obstacle_mask_ = resource_manager.GetTexture("obstacle_mask");
+    obstacle_distance_ = resource_manager.GetTexture("obstacle_distance");
+    tile_buffer_ = resource_manager.GetBuffer("active_tiles");
 
     CreateDescriptorSets();
     CreatePipeline();
@@ -19,6 +20,14 @@ VelocityUpdatePass::VelocityUpdatePass(lava::engine &app, lava::descriptor::pool
 
 VelocityUpdatePass::~VelocityUpdatePass()
 {
+    if (interior_pipeline_)
+    {
+        interior_pipeline_->destroy();
+    }
+    if (boundary_pipeline_)
+    {
+        boundary_pipeline_->destroy();
+    }
     if (descriptor_set_layout_)
     {
         descriptor_set_layout_->destroy();
@@ -35,7 +44,9 @@ void VelocityUpdatePass::CreateDescriptorSets()
     descriptor_set_layout_->add_binding(2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
                                         VK_SHADER_STAGE_COMPUTE_BIT); // Fixed velocity field
     descriptor_set_layout_->add_binding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                        VK_SHADER_STAGE_COMPUTE_BIT); // Obstacle mask
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Obstacle distance
+    descriptor_set_layout_->add_binding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                        VK_SHADER_STAGE_COMPUTE_BIT); // Tile lists
 
     if (!descriptor_set_layout_->create(app_.device))
     {
@@ -65,40 +76,42 @@ void VelocityUpdatePass::UpdateDescriptorSets()
                                               .imageView = velocity_field_->get_image()->get_view(),
                                               .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
 
-    VkDescriptorImageInfo obstacle_mask_info{.sampler = obstacle_mask_->get_sampler(),
-                                             .imageView = obstacle_mask_->get_image()->get_view(),
-                                             .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    VkDescriptorImageInfo obstacle_distance_info{.sampler = obstacle_distance_->get_sampler(),
+                                                 .imageView = obstacle_distance_->get_image()->get_view(),
+                                                 .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
 
     std::vector<VkDescriptorImageInfo> image_infos = {pressure_field_info, advected_velocity_info, velocity_field_info,
-                                                      obstacle_mask_info};
+                                                      obstacle_distance_info};
 
     std::vector<VkDescriptorType> descriptor_types = {
         VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
         VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER};
 
     ComputePass::UpdateDescriptorSets(descriptor_set_, image_infos, descriptor_types);
+
+    std::vector<VkDescriptorBufferInfo> buffer_infos = {*tile_buffer_->get_descriptor_info()};
+    std::vector<VkDescriptorType> buffer_types = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER};
+
+    ComputePass::UpdateDescriptorSets(descriptor_set_, buffer_infos, buffer_types,
+                                      static_cast<uint32_t>(image_infos.size()));
 }
 
 void VelocityUpdatePass::CreatePipeline()
 {
     CreateBasePipeline("VelocityUpdate.comp", descriptor_set_layout_, sizeof(SimulationConstants));
+    interior_pipeline_ = CreateTilePipeline("VelocityUpdate.comp", pipeline_layout_, TileClass::Interior);
+    boundary_pipeline_ = CreateTilePipeline("VelocityUpdate.comp", pipeline_layout_, TileClass::Boundary);
 }
 
 void VelocityUpdatePass::Execute(VkCommandBuffer cmd_buffer, const SimulationConstants &constants)
 {
-    pressure_field_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT,
-                                                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    barriers_.Transition(pressure_field_, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT);
+    barriers_.Transition(advected_velocity_field_, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT);
+    barriers_.Transition(velocity_field_, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT);
+    barriers_.Transition(obstacle_distance_, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT);
+    barriers_.Flush(cmd_buffer);
 
-    advected_velocity_field_->get_image()->transition_layout(
-        cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-
-    velocity_field_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT,
-                                                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-
-    obstacle_mask_->get_image()->transition_layout(cmd_buffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                                                   VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-
-    pipeline_->bind(cmd_buffer);
+    (tile_lists_ ? interior_pipeline_ : pipeline_)->bind(cmd_buffer);
 
     vkCmdPushConstants(cmd_buffer, pipeline_layout_->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SimulationConstants),
                        &constants);
@@ -106,6 +119,14 @@ void VelocityUpdatePass::Execute(VkCommandBuffer cmd_buffer, const SimulationCon
     vkCmdBindDescriptorSets(cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_->get(), 0, 1, &descriptor_set_,
                             0, nullptr);
 
+    if (tile_lists_)
+    {
+        tile_lists_->Dispatch(cmd_buffer, TileClass::Interior);
+        boundary_pipeline_->bind(cmd_buffer);
+        tile_lists_->Dispatch(cmd_buffer, TileClass::Boundary);
+        return;
+    }
+
     uint32_t group_count_x = (constants.texture_width + 15) / 16;
     uint32_t group_count_y = (constants.texture_height + 15) / 16;
     vkCmdDispatch(cmd_buffer, group_count_x, group_count_y, 1);
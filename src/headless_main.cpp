@@ -0,0 +1,52 @@
+#include "HeadlessRunner.hpp"
+#include "liblava/lava.hpp"
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+using namespace lava;
+
+int main(int argc, char *argv[])
+{
+    // No window is ever opened, let glfw initialize without a display server when it can
+#ifdef GLFW_PLATFORM_NULL
+    glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#endif
+
+    frame_env env;
+    env.info.app_name = "VkFluidSimulationHeadless";
+    env.cmd_line = {argc, argv};
+    env.info.req_api_version = api_version::v1_3;
+
+    engine app(env);
+    app.headless = true;
+
+    if (!FluidSimulation::HeadlessRunner::CreateComputeDevice(app))
+        return error::create_failed;
+
+    if (!app.setup())
+        return error::not_ready;
+
+    // An invalid configuration still ends through shut_down, so the device is torn down like after any run
+    int run_result = 0;
+    app.add_run_once(
+        [&]()
+        {
+            const auto config = FluidSimulation::HeadlessRunner::ParseConfig(app.get_cmd_line());
+            auto runner = config ? FluidSimulation::HeadlessRunner::Make(app, *config) : nullptr;
+            if (!runner)
+                run_result = error::create_failed;
+            else if (!runner->Run())
+                run_result = error::run_aborted;
+
+            runner.reset();
+
+            app.shut_down();
+            return run_continue;
+        });
+
+    auto result = app.run();
+    if (result != 0)
+        return result;
+
+    return run_result;
+}
@@ -15,9 +15,23 @@ int run(int argc, char *argv[])
     env.info.req_api_version = api_version::v1_3;
 
     engine app(env);
+
+    // The device is created either way, one lacking the simulation's features is rejected once setup returns
+    bool device_features_enabled = false;
+    app.platform.on_create_param = [&device_features_enabled](device::create_param &param)
+    {
+        device_features_enabled = FluidSimulation::Simulation::EnableDeviceFeatures(param);
+
+        // The simulation runs on the graphics queue when the device has no compute queue to spare
+        param.add_queue(VK_QUEUE_COMPUTE_BIT);
+    };
+
     if (!app.setup())
         return error::not_ready;
 
+    if (!device_features_enabled)
+        return error::create_failed;
+
     FluidSimulation::FluidRenderer::s_ptr fluid_renderer = FluidSimulation::FluidRenderer::Make(app);
     auto render_pipeline = fluid_renderer->GetPipeline();
 
@@ -88,6 +102,7 @@ int run(int argc, char *argv[])
 
     int selected_method = static_cast<int>(fluid_renderer->simulation_->GetPressureProjectionMethod());
     int jacobi_iterations = fluid_renderer->simulation_->GetPressureJacobiIterations();
+    int jacobi_sweeps = fluid_renderer->simulation_->GetJacobiSweepsPerDispatch();
 
     app.imgui.layers.add("info",
                          [&]()
@@ -106,7 +121,9 @@ int run(int argc, char *argv[])
 
                              FluidSimulation::PressureProjectionMethod current_method =
                                  fluid_renderer->simulation_->GetPressureProjectionMethod();
-                             const char *methods[] = {"Jacobi", "Poisson Filter", "Multigrid", "Multigrid Poisson"};
+                             const char *methods[] = {"Jacobi", "Poisson Filter", "Multigrid", "Multigrid Poisson",
+                                                      "Multigrid Red-Black", "Multigrid PCG",
+                                                      "Spectral (DCT)",      "Spectral (FFT)"};
 
                              int selected_method = 0;
                              if (current_method == FluidSimulation::PressureProjectionMethod::Jacobi)
@@ -125,6 +142,22 @@ int run(int argc, char *argv[])
                              {
                                  selected_method = 3;
                              }
+                             else if (current_method == FluidSimulation::PressureProjectionMethod::Multigrid_Red_Black)
+                             {
+                                 selected_method = 4;
+                             }
+                             else if (current_method == FluidSimulation::PressureProjectionMethod::Multigrid_PCG)
+                             {
+                                 selected_method = 5;
+                             }
+                             else if (current_method == FluidSimulation::PressureProjectionMethod::Spectral_DCT)
+                             {
+                                 selected_method = 6;
+                             }
+                             else if (current_method == FluidSimulation::PressureProjectionMethod::Spectral_FFT)
+                             {
+                                 selected_method = 7;
+                             }
 
                              if (ImGui::Combo("Pressure Projection", &selected_method, methods, IM_ARRAYSIZE(methods)))
                              {
@@ -143,16 +176,221 @@ int run(int argc, char *argv[])
                                  case 3:
                                      new_method = FluidSimulation::PressureProjectionMethod::Multigrid_Poisson;
                                      break;
+                                 case 4:
+                                     new_method = FluidSimulation::PressureProjectionMethod::Multigrid_Red_Black;
+                                     break;
+                                 case 5:
+                                     new_method = FluidSimulation::PressureProjectionMethod::Multigrid_PCG;
+                                     break;
+                                 case 6:
+                                     new_method = FluidSimulation::PressureProjectionMethod::Spectral_DCT;
+                                     break;
+                                 case 7:
+                                     new_method = FluidSimulation::PressureProjectionMethod::Spectral_FFT;
+                                     break;
                                  }
                                  fluid_renderer->simulation_->SetPressureProjectionMethod(new_method);
                              }
 
                              if (selected_method == 0)
                              {
-                                 if (ImGui::SliderInt("Jacobi Iterations", &jacobi_iterations, 1, 100))
+                                 // Snapped to even counts, the solve ping-pongs and has to end in texture A
+                                 if (ImGui::SliderInt("Jacobi Iterations", &jacobi_iterations, 2, 100))
                                  {
+                                     jacobi_iterations += jacobi_iterations % 2;
                                      fluid_renderer->simulation_->SetPressureJacobiIterations(jacobi_iterations);
                                  }
+                                 if (ImGui::SliderInt("Sweeps per Dispatch", &jacobi_sweeps, 1,
+                                                      FluidSimulation::MAX_JACOBI_SWEEPS_PER_DISPATCH))
+                                 {
+                                     fluid_renderer->simulation_->SetJacobiSweepsPerDispatch(jacobi_sweeps);
+                                 }
+                             }
+
+                             // Applies to the Jacobi solver and to the Jacobi smoother of plain multigrid
+                             if (selected_method == 0 || selected_method == 2)
+                             {
+                                 bool chebyshev = fluid_renderer->simulation_->GetChebyshevAcceleration();
+                                 if (ImGui::Checkbox("Chebyshev Acceleration", &chebyshev))
+                                 {
+                                     fluid_renderer->simulation_->SetChebyshevAcceleration(chebyshev);
+                                 }
+                             }
+                             else if (selected_method == 1 || selected_method == 3)
+                             {
+                                 const bool multigrid = (selected_method == 3);
+                                 FluidSimulation::PoissonFilterVariant filter =
+                                     multigrid ? fluid_renderer->simulation_->GetMultigridPoissonFilter()
+                                               : fluid_renderer->simulation_->GetPoissonFilter();
+
+                                 const char *filter_orders[] = {"1", "2", "3", "4", "5", "6",
+                                                                "7", "8", "10", "16", "24", "32"};
+                                 int order_index = 0;
+                                 for (size_t i = 0; i < FluidSimulation::POISSON_FILTER_ORDERS.size(); i++)
+                                 {
+                                     if (FluidSimulation::POISSON_FILTER_ORDERS[i] == filter.order)
+                                     {
+                                         order_index = static_cast<int>(i);
+                                     }
+                                 }
+
+                                 bool filter_changed = ImGui::Combo("Filter Order", &order_index, filter_orders,
+                                                                    IM_ARRAYSIZE(filter_orders));
+                                 filter_changed |= ImGui::SliderInt("Filter Ranks", &filter.ranks, 1,
+                                                                    FluidSimulation::MAX_POISSON_FILTER_RANKS);
+
+                                 if (filter_changed)
+                                 {
+                                     filter.order = FluidSimulation::POISSON_FILTER_ORDERS[order_index];
+                                     if (multigrid)
+                                     {
+                                         fluid_renderer->simulation_->SetMultigridPoissonFilter(filter);
+                                     }
+                                     else
+                                     {
+                                         fluid_renderer->simulation_->SetPoissonFilter(filter);
+                                     }
+                                 }
+                             }
+                             else if (selected_method == 4)
+                             {
+                                 float relaxation_omega = fluid_renderer->simulation_->GetRelaxationOmega();
+                                 if (ImGui::SliderFloat("SOR Omega", &relaxation_omega, 1.0f, 1.9f))
+                                 {
+                                     fluid_renderer->simulation_->SetRelaxationOmega(relaxation_omega);
+                                 }
+                             }
+                             else if (selected_method == 5)
+                             {
+                                 int cg_iterations =
+                                     static_cast<int>(fluid_renderer->simulation_->GetConjugateGradientIterations());
+                                 if (ImGui::SliderInt("PCG Iterations", &cg_iterations, 1, 32))
+                                 {
+                                     fluid_renderer->simulation_->SetConjugateGradientIterations(cg_iterations);
+                                 }
+                             }
+
+                             float pressure_tolerance = fluid_renderer->simulation_->GetPressureTolerance();
+                             if (ImGui::SliderFloat("Tolerance", &pressure_tolerance, 0.0f, 1e-1f, "%.1e",
+                                                    ImGuiSliderFlags_Logarithmic))
+                             {
+                                 fluid_renderer->simulation_->SetPressureTolerance(pressure_tolerance);
+                             }
+
+                             if (selected_method >= 2 && selected_method <= 4)
+                             {
+                                 const char *cycle_types[] = {"V-Cycle", "W-Cycle", "F-Cycle", "Full Multigrid"};
+                                 int cycle_type =
+                                     static_cast<int>(fluid_renderer->simulation_->GetMultigridCycleType());
+                                 if (ImGui::Combo("Cycle", &cycle_type, cycle_types, IM_ARRAYSIZE(cycle_types)))
+                                 {
+                                     fluid_renderer->simulation_->SetMultigridCycleType(
+                                         static_cast<FluidSimulation::MultigridCycleType>(cycle_type));
+                                 }
+
+                                 int cycles = static_cast<int>(fluid_renderer->simulation_->GetMultigridCycles());
+                                 if (ImGui::SliderInt("Cycles", &cycles, 1, 4))
+                                 {
+                                     fluid_renderer->simulation_->SetMultigridCycles(cycles);
+                                 }
+
+                                 bool bottom_solver = fluid_renderer->simulation_->GetMultigridBottomSolver();
+                                 if (ImGui::Checkbox("Direct Bottom Solve", &bottom_solver))
+                                 {
+                                     fluid_renderer->simulation_->SetMultigridBottomSolver(bottom_solver);
+                                 }
+                             }
+
+                             const char *advection_schemes[] = {"Semi-Lagrangian", "MacCormack"};
+                             int advection_scheme = static_cast<int>(fluid_renderer->simulation_->GetAdvectionScheme());
+                             if (ImGui::Combo("Advection", &advection_scheme, advection_schemes,
+                                              IM_ARRAYSIZE(advection_schemes)))
+                             {
+                                 fluid_renderer->simulation_->SetAdvectionScheme(
+                                     static_cast<FluidSimulation::AdvectionScheme>(advection_scheme));
+                             }
+
+                             FluidSimulation::BacktraceVariant backtrace = fluid_renderer->simulation_->GetBacktrace();
+                             const char *integrators[] = {"Euler", "RK2", "RK3"};
+                             int integrator = static_cast<int>(backtrace.integrator);
+                             bool backtrace_changed = ImGui::Combo("Backtrace", &integrator, integrators,
+                                                                   IM_ARRAYSIZE(integrators));
+                             backtrace_changed |= ImGui::SliderInt("Backtrace Substeps", &backtrace.substeps, 1,
+                                                                   FluidSimulation::MAX_BACKTRACE_SUBSTEPS);
+                             if (backtrace_changed)
+                             {
+                                 backtrace.integrator = static_cast<FluidSimulation::BacktraceIntegrator>(integrator);
+                                 fluid_renderer->simulation_->SetBacktrace(backtrace);
+                             }
+
+                             bool fixed_timestep = fluid_renderer->simulation_->GetFixedTimestep() > 0.0f;
+                             if (ImGui::Checkbox("Fixed Timestep", &fixed_timestep))
+                             {
+                                 fluid_renderer->simulation_->SetFixedTimestep(
+                                     fixed_timestep ? FluidSimulation::DEFAULT_FIXED_TIMESTEP : 0.0f);
+                             }
+
+                             if (fixed_timestep)
+                             {
+                                 int step_rate = static_cast<int>(
+                                     std::lround(1.0f / fluid_renderer->simulation_->GetFixedTimestep()));
+                                 if (ImGui::SliderInt("Steps Per Second", &step_rate, 30, 240))
+                                 {
+                                     fluid_renderer->simulation_->SetFixedTimestep(1.0f /
+                                                                                   static_cast<float>(step_rate));
+                                 }
+
+                                 int max_steps = static_cast<int>(fluid_renderer->simulation_->GetMaxFixedSteps());
+                                 if (ImGui::SliderInt("Max Steps Per Frame", &max_steps, 1,
+                                                      static_cast<int>(FluidSimulation::MAX_FIXED_STEPS_PER_FRAME)))
+                                 {
+                                     fluid_renderer->simulation_->SetMaxFixedSteps(static_cast<uint32_t>(max_steps));
+                                 }
+
+                                 ImGui::Text("steps this frame: %u", fluid_renderer->simulation_->GetFixedSteps());
+                             }
+
+                             bool adaptive_timestep = fluid_renderer->simulation_->GetAdaptiveTimestep();
+                             if (ImGui::Checkbox("Adaptive Timestep", &adaptive_timestep))
+                             {
+                                 fluid_renderer->simulation_->SetAdaptiveTimestep(adaptive_timestep);
+                             }
+
+                             if (adaptive_timestep)
+                             {
+                                 float target_cfl = fluid_renderer->simulation_->GetTargetCFL();
+                                 if (ImGui::SliderFloat("Target CFL", &target_cfl, 0.5f, 8.0f))
+                                 {
+                                     fluid_renderer->simulation_->SetTargetCFL(target_cfl);
+                                 }
+
+                                 int max_substeps = static_cast<int>(fluid_renderer->simulation_->GetMaxSubsteps());
+                                 if (ImGui::SliderInt("Max Substeps", &max_substeps, 1,
+                                                      static_cast<int>(FluidSimulation::MAX_CFL_SUBSTEPS)))
+                                 {
+                                     fluid_renderer->simulation_->SetMaxSubsteps(static_cast<uint32_t>(max_substeps));
+                                 }
+
+                                 ImGui::Text("max |u|: %.3f, steps: %u", fluid_renderer->simulation_->GetMaxVelocity(),
+                                             fluid_renderer->simulation_->GetSubsteps());
+                             }
+
+                             bool tile_classification = fluid_renderer->simulation_->GetTileClassification();
+                             if (ImGui::Checkbox("Tile Classification", &tile_classification))
+                             {
+                                 fluid_renderer->simulation_->SetTileClassification(tile_classification);
+                             }
+
+                             bool sparse_simulation = fluid_renderer->simulation_->GetSparseSimulation();
+                             if (ImGui::Checkbox("Sparse Simulation", &sparse_simulation))
+                             {
+                                 fluid_renderer->simulation_->SetSparseSimulation(sparse_simulation);
+                             }
+
+                             bool step_replay = fluid_renderer->simulation_->GetStepReplay();
+                             if (ImGui::Checkbox("Replay Recorded Steps", &step_replay))
+                             {
+                                 fluid_renderer->simulation_->SetStepReplay(step_replay);
                              }
 
                              static bool reset_simulation = false;